@@ -0,0 +1,948 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HybCompiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <set>
+
+#include <unicode/uchar.h>
+#include <unicode/utf8.h>
+
+namespace minikin {
+
+namespace {
+
+constexpr uint32_t HYB_MAGIC = 0x62ad7968;
+constexpr uint32_t HEADER_SIZE = 6 * 4;
+constexpr uint32_t TRIE_HEADER_SIZE = 6 * 4;
+constexpr uint32_t PATTERN_HEADER_SIZE = 4 * 4;
+
+// The values of the exceptions, which are out of the range of the pattern digits.
+constexpr uint8_t EXCEPTION_DONT_BREAK = 10;
+constexpr uint8_t EXCEPTION_BREAK = 11;
+
+// U+00DF is LATIN SMALL LETTER SHARP S
+// U+1E9E is LATIN CAPITAL LETTER SHARP S
+const std::u32string SHARP_S_TO_DOUBLE = U"\u00dfSS";
+const std::u32string SHARP_S_TO_CAPITAL = U"\u00df\u1e9e";
+
+std::string toUtf8(const std::u32string& str) {
+    std::string out;
+    for (char32_t c : str) {
+        uint8_t buf[U8_MAX_LENGTH];
+        int32_t length = 0;
+        U8_APPEND_UNSAFE(buf, length, c);
+        out.append(reinterpret_cast<const char*>(buf), length);
+    }
+    return out;
+}
+
+// Reads the lines of the UTF-8 file with the surrounding white spaces stripped. The empty lines
+// are skipped.
+bool readLines(const std::string& path, std::vector<std::u32string>* out) {
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (fp == nullptr) {
+        fprintf(stderr, "error opening %s\n", path.c_str());
+        return false;
+    }
+    std::string data;
+    char buf[4096];
+    size_t readSize;
+    while ((readSize = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        data.append(buf, readSize);
+    }
+    fclose(fp);
+
+    std::u32string line;
+    auto flush = [&line, out]() {
+        const auto isSpace = [](char32_t c) { return u_isUWhiteSpace(c); };
+        auto begin = std::find_if_not(line.begin(), line.end(), isSpace);
+        auto end = std::find_if_not(line.rbegin(), line.rend(), isSpace).base();
+        if (begin < end) {
+            out->emplace_back(begin, end);
+        }
+        line.clear();
+    };
+    const int32_t length = static_cast<int32_t>(data.size());
+    int32_t i = 0;
+    while (i < length) {
+        UChar32 c;
+        U8_NEXT(data.data(), i, length, c);
+        if (c < 0) {
+            fprintf(stderr, "%s: invalid UTF-8 at byte %d\n", path.c_str(), i);
+            return false;
+        }
+        if (c == '\n') {
+            flush();
+        } else {
+            line.push_back(c);
+        }
+    }
+    flush();
+    return true;
+}
+
+void appendUint32(std::vector<uint8_t>* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out->push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void alignTo4(std::vector<uint8_t>* out) {
+    out->resize((out->size() + 3) & ~3);
+}
+
+// The number of bits required to represent the numbers up to n inclusive.
+uint32_t numBits(uint32_t n) {
+    uint32_t bits = 0;
+    for (; n != 0; n >>= 1) {
+        bits++;
+    }
+    return bits;
+}
+
+// A list of the free entries in the increasing order, implemented as a doubly linked list. The list
+// grows on demand, i.e. all the entries past the end are free. See Freelist in mk_hyb_file.py.
+class FreeList {
+public:
+    // The cursor for the first call of next.
+    static constexpr int32_t START = -3;
+
+    // Returns the free entry at the cursor and advances the cursor to the next free entry. Grows
+    // the list if the cursor is at the end.
+    int32_t next(int32_t* cursor) {
+        int32_t result = *cursor == START ? mFirst : *cursor;
+        if (result == NONE) {
+            grow();
+            result = mLast;
+        }
+        *cursor = mSucc[result];
+        return result;
+    }
+
+    bool isFree(int32_t index) {
+        while (index >= static_cast<int32_t>(mPred.size())) {
+            grow();
+        }
+        return mPred[index] != USED;
+    }
+
+    void use(int32_t index) {
+        const int32_t pred = mPred[index];
+        const int32_t succ = mSucc[index];
+        if (pred == NONE) {
+            mFirst = succ;
+        } else {
+            mSucc[pred] = succ;
+        }
+        if (succ == NONE) {
+            mLast = pred;
+        } else {
+            mPred[succ] = pred;
+        }
+        mPred[index] = USED;
+    }
+
+private:
+    static constexpr int32_t NONE = -1;
+    // The predecessor of the used entries.
+    static constexpr int32_t USED = -2;
+
+    void grow() {
+        const int32_t index = mPred.size();
+        mPred.push_back(mLast);
+        mSucc.push_back(NONE);
+        if (mLast == NONE) {
+            mFirst = index;
+        } else {
+            mSucc[mLast] = index;
+        }
+        mLast = index;
+    }
+
+    int32_t mFirst = NONE;
+    int32_t mLast = NONE;
+    std::vector<int32_t> mPred;
+    std::vector<int32_t> mSucc;
+};
+
+// Builds the packed trie of the patterns. This follows Hyph in mk_hyb_file.py step by step, so
+// that the output is byte-for-byte identical.
+class TrieBuilder {
+public:
+    explicit TrieBuilder(const std::map<uint32_t, uint32_t>& alphabet)
+            : mAlphabet(alphabet), mNodes(1) {}
+
+    // Adds a pattern, i.e. a word fragment with the numeric codes such as ".ad4der".
+    void addPattern(const std::u32string& pattern);
+
+    // Adds an exception, i.e. a word with the hyphens such as "ta-ble".
+    void addException(const std::u32string& word);
+
+    bool build(std::vector<uint8_t>* out);
+
+private:
+    struct Node {
+        // Maps the characters of the outgoing edges to the child nodes.
+        std::map<uint32_t, uint32_t> children;
+        bool hasValues = false;
+        std::vector<uint8_t> values;
+        uint32_t bfsIndex = 0;
+        // The index of the node in the packed trie.
+        int32_t slot = 0;
+    };
+
+    void addValues(const std::u32string& word, std::vector<uint8_t>&& values);
+
+    // Lists the nodes in the BFS order, with the children sorted by the alphabet values.
+    bool sortNodes();
+
+    // Suffix compression: merges the nodes with the identical subtries.
+    void dedup();
+
+    // Assigns the slots to the unique nodes. Returns the number of the trie entries.
+    uint32_t pack();
+
+    void generateAlphabet(std::vector<uint8_t>* out) const;
+    bool generatePattern(std::map<std::vector<uint8_t>, uint32_t>* patternMap,
+                         std::vector<uint8_t>* out) const;
+    bool generateTrie(uint32_t entryCount,
+                      const std::map<std::vector<uint8_t>, uint32_t>& patternMap,
+                      std::vector<uint8_t>* out) const;
+
+    uint32_t maxAlphabetValue() const;
+
+    const std::map<uint32_t, uint32_t>& mAlphabet;
+    // The nodes in the order of creation. The node 0 is the root.
+    std::vector<Node> mNodes;
+    std::vector<uint32_t> mBfsOrder;
+    // The BFS index of the unique node for each BFS index.
+    std::vector<uint32_t> mDedupIndex;
+    // The unique nodes in the BFS order.
+    std::vector<uint32_t> mUniqueNodes;
+};
+
+void TrieBuilder::addPattern(const std::u32string& pattern) {
+    bool lastWasLetter = false;
+    bool haveSeenNumber = false;
+    std::vector<uint8_t> values;
+    std::u32string word;
+    for (char32_t c : pattern) {
+        if (c >= '0' && c <= '9') {
+            values.push_back(c - '0');
+            lastWasLetter = false;
+            haveSeenNumber = true;
+        } else {
+            word.push_back(c);
+            if (lastWasLetter && haveSeenNumber) {
+                values.push_back(0);
+            }
+            lastWasLetter = true;
+        }
+    }
+    if (lastWasLetter) {
+        values.push_back(0);
+    }
+    addValues(word, std::move(values));
+}
+
+void TrieBuilder::addException(const std::u32string& hyphenatedWord) {
+    std::vector<uint8_t> values;
+    std::u32string word = U".";
+    bool needDontBreak = false;
+    for (char32_t c : hyphenatedWord) {
+        if (c == '-') {
+            values.push_back(EXCEPTION_BREAK);
+            needDontBreak = false;
+        } else {
+            if (needDontBreak) {
+                values.push_back(EXCEPTION_DONT_BREAK);
+            }
+            word.push_back(c);
+            needDontBreak = true;
+        }
+    }
+    word.push_back('.');
+    values.push_back(0);
+    values.push_back(0);
+    addValues(word, std::move(values));
+}
+
+void TrieBuilder::addValues(const std::u32string& word, std::vector<uint8_t>&& values) {
+    uint32_t node = 0;
+    for (char32_t c : word) {
+        auto it = mNodes[node].children.find(c);
+        if (it == mNodes[node].children.end()) {
+            const uint32_t child = mNodes.size();
+            mNodes.emplace_back();
+            mNodes[node].children[c] = child;
+            node = child;
+        } else {
+            node = it->second;
+        }
+    }
+    mNodes[node].hasValues = true;
+    mNodes[node].values = std::move(values);
+}
+
+bool TrieBuilder::sortNodes() {
+    mBfsOrder.assign(1, 0);
+    for (uint32_t i = 0; i < mBfsOrder.size(); ++i) {
+        Node& node = mNodes[mBfsOrder[i]];
+        node.bfsIndex = i;
+        std::map<uint32_t, uint32_t> mapped;
+        for (const auto& [c, child] : node.children) {
+            auto it = mAlphabet.find(c);
+            if (it == mAlphabet.end()) {
+                fprintf(stderr, "U+%04X in the patterns is not in the alphabet\n", c);
+                return false;
+            }
+            if (!mapped.emplace(it->second, child).second) {
+                fprintf(stderr, "duplicate edge for U+%04X\n", c);
+                return false;
+            }
+        }
+        for (const auto& entry : mapped) {
+            mBfsOrder.push_back(entry.second);
+        }
+    }
+    return true;
+}
+
+void TrieBuilder::dedup() {
+    // Each node is represented by its values and its edges to the unique nodes.
+    std::map<std::vector<uint32_t>, uint32_t> uniqueIndices;
+    mDedupIndex.assign(mBfsOrder.size(), 0);
+    mUniqueNodes.clear();
+    for (uint32_t i = mBfsOrder.size(); i-- > 0;) {
+        const Node& node = mNodes[mBfsOrder[i]];
+        std::vector<uint32_t> key(1, node.values.size());
+        key.insert(key.end(), node.values.begin(), node.values.end());
+        for (const auto& [c, child] : node.children) {
+            key.push_back(c);
+            key.push_back(mDedupIndex[mNodes[child].bfsIndex]);
+        }
+        auto [it, inserted] = uniqueIndices.emplace(std::move(key), i);
+        if (inserted) {
+            mUniqueNodes.push_back(mBfsOrder[i]);
+        }
+        mDedupIndex[i] = it->second;
+    }
+    std::reverse(mUniqueNodes.begin(), mUniqueNodes.end());
+}
+
+uint32_t TrieBuilder::pack() {
+    FreeList nodes;
+    FreeList edges;
+    int32_t size = 0;
+    for (uint32_t nodeIndex : mUniqueNodes) {
+        Node& node = mNodes[nodeIndex];
+        std::vector<int32_t> succ;
+        for (const auto& entry : node.children) {
+            succ.push_back(mAlphabet.at(entry.first));
+        }
+        std::sort(succ.begin(), succ.end());
+        int32_t slot;
+        int32_t cursor = FreeList::START;
+        if (succ.empty()) {
+            slot = nodes.next(&cursor);
+        } else {
+            while (true) {
+                slot = edges.next(&cursor) - succ[0];
+                if (slot >= 0 && nodes.isFree(slot) &&
+                    std::all_of(succ.begin(), succ.end(),
+                                [&edges, slot](int32_t s) { return edges.isFree(slot + s); })) {
+                    break;
+                }
+            }
+        }
+        node.slot = slot;
+        nodes.use(slot);
+        size = std::max(size, slot);
+        for (int32_t s : succ) {
+            edges.use(slot + s);
+        }
+    }
+    return size + maxAlphabetValue() + 1;
+}
+
+uint32_t TrieBuilder::maxAlphabetValue() const {
+    uint32_t result = 0;
+    for (const auto& entry : mAlphabet) {
+        result = std::max(result, entry.second);
+    }
+    return result;
+}
+
+void TrieBuilder::generateAlphabet(std::vector<uint8_t>* out) const {
+    std::map<uint32_t, uint32_t> alphabet = mAlphabet;
+    alphabet.erase('.');
+    const uint32_t minCodePoint = alphabet.begin()->first;
+    const uint32_t maxCodePoint = alphabet.rbegin()->first;
+    uint32_t maxValue = 0;
+    for (const auto& entry : alphabet) {
+        maxValue = std::max(maxValue, entry.second);
+    }
+    if (maxCodePoint - minCodePoint < 1024 && maxValue < 256) {
+        // The direct version.
+        appendUint32(out, 0);
+        appendUint32(out, minCodePoint);
+        appendUint32(out, maxCodePoint + 1);
+        const size_t dataOffset = out->size();
+        out->resize(dataOffset + maxCodePoint - minCodePoint + 1, 0);
+        for (const auto& [c, value] : alphabet) {
+            (*out)[dataOffset + c - minCodePoint] = value;
+        }
+    } else {
+        // The general version.
+        appendUint32(out, 1);
+        appendUint32(out, alphabet.size());
+        for (const auto& [c, value] : alphabet) {
+            appendUint32(out, (c << 11) | value);
+        }
+    }
+    alignTo4(out);
+}
+
+bool TrieBuilder::generatePattern(std::map<std::vector<uint8_t>, uint32_t>* patternMap,
+                                  std::vector<uint8_t>* out) const {
+    std::vector<uint32_t> entries(1, 0);
+    patternMap->clear();
+    (*patternMap)[std::vector<uint8_t>()] = 0;
+    std::vector<uint8_t> buf;
+    std::map<std::vector<uint8_t>, uint32_t> bufOffsets;
+    for (const Node& node : mNodes) {
+        if (!node.hasValues || patternMap->count(node.values) != 0) {
+            continue;
+        }
+        const std::vector<uint8_t>& values = node.values;
+        uint32_t shift = 0;
+        while (shift < values.size() && values[values.size() - shift - 1] == 0) {
+            shift++;
+        }
+        const std::vector<uint8_t> raw(values.begin(), values.end() - shift);
+        auto [it, inserted] = bufOffsets.emplace(raw, buf.size());
+        if (inserted) {
+            buf.insert(buf.end(), raw.begin(), raw.end());
+        }
+        if (raw.size() >= (1u << 6) || shift >= (1u << 6) || it->second >= (1u << 20)) {
+            fprintf(stderr, "pattern out of the range of the pattern table\n");
+            return false;
+        }
+        (*patternMap)[values] = entries.size();
+        entries.push_back((raw.size() << 26) | (shift << 20) | it->second);
+    }
+    appendUint32(out, 0);
+    appendUint32(out, entries.size());
+    appendUint32(out, PATTERN_HEADER_SIZE + 4 * entries.size());
+    appendUint32(out, buf.size());
+    for (uint32_t entry : entries) {
+        appendUint32(out, entry);
+    }
+    out->insert(out->end(), buf.begin(), buf.end());
+    return true;
+}
+
+bool TrieBuilder::generateTrie(uint32_t entryCount,
+                               const std::map<std::vector<uint8_t>, uint32_t>& patternMap,
+                               std::vector<uint8_t>* out) const {
+    std::vector<uint32_t> chars(entryCount, 0);
+    std::vector<uint32_t> links(entryCount, 0);
+    std::vector<uint32_t> patterns(entryCount, 0);
+    const uint32_t linkShift = numBits(maxAlphabetValue());
+    const uint32_t charMask = (1u << linkShift) - 1;
+    const uint32_t patternShift = linkShift + numBits(entryCount - 1);
+    if (patternShift >= 32 ||
+        (static_cast<uint64_t>(patternMap.size() - 1) << patternShift) > UINT32_MAX) {
+        fprintf(stderr, "trie entries exceed 32 bits\n");
+        return false;
+    }
+    const uint32_t linkMask = (1u << patternShift) - (1u << linkShift);
+    appendUint32(out, 0);
+    appendUint32(out, charMask);
+    appendUint32(out, linkShift);
+    appendUint32(out, linkMask);
+    appendUint32(out, patternShift);
+    appendUint32(out, entryCount);
+
+    for (uint32_t nodeIndex : mUniqueNodes) {
+        const Node& node = mNodes[nodeIndex];
+        if (node.hasValues) {
+            patterns[node.slot] = patternMap.at(node.values);
+        }
+        for (const auto& [c, child] : node.children) {
+            const uint32_t value = mAlphabet.at(c);
+            const uint32_t linkIndex = node.slot + value;
+            const uint32_t uniqueChild = mBfsOrder[mDedupIndex[mNodes[child].bfsIndex]];
+            chars[linkIndex] = value;
+            links[linkIndex] = mNodes[uniqueChild].slot;
+        }
+    }
+    for (uint32_t i = 0; i < entryCount; ++i) {
+        appendUint32(out, (patterns[i] << patternShift) | (links[i] << linkShift) | chars[i]);
+    }
+    return true;
+}
+
+bool TrieBuilder::build(std::vector<uint8_t>* out) {
+    if (!sortNodes()) {
+        return false;
+    }
+    dedup();
+    const uint32_t entryCount = pack();
+    if (mNodes[0].slot != 0) {
+        // The lookups always start from the entry 0.
+        fprintf(stderr, "the root is not packed at the entry 0, no pattern starts with '.'?\n");
+        return false;
+    }
+    std::vector<uint8_t> alphabet;
+    generateAlphabet(&alphabet);
+    std::map<std::vector<uint8_t>, uint32_t> patternMap;
+    std::vector<uint8_t> pattern;
+    if (!generatePattern(&patternMap, &pattern)) {
+        return false;
+    }
+    std::vector<uint8_t> trie;
+    if (!generateTrie(entryCount, patternMap, &trie)) {
+        return false;
+    }
+
+    const uint32_t alphabetOffset = HEADER_SIZE;
+    const uint32_t trieOffset = alphabetOffset + alphabet.size();
+    const uint32_t patternOffset = trieOffset + trie.size();
+    out->clear();
+    appendUint32(out, HYB_MAGIC);
+    appendUint32(out, 0);
+    appendUint32(out, alphabetOffset);
+    appendUint32(out, trieOffset);
+    appendUint32(out, patternOffset);
+    appendUint32(out, patternOffset + pattern.size());
+    out->insert(out->end(), alphabet.begin(), alphabet.end());
+    out->insert(out->end(), trie.begin(), trie.end());
+    out->insert(out->end(), pattern.begin(), pattern.end());
+    return true;
+}
+
+// Prints the lines only in one of the sets. Returns true if the sets are the same.
+bool compareLines(const char* name, const std::set<std::u32string>& reconstructed,
+                  const std::set<std::u32string>& source) {
+    bool same = true;
+    for (const std::u32string& line : reconstructed) {
+        if (source.count(line) == 0) {
+            printf("'%s' in reconstruction, not in file\n", toUtf8(line).c_str());
+            same = false;
+        }
+    }
+    for (const std::u32string& line : source) {
+        if (reconstructed.count(line) == 0) {
+            printf("'%s' in file, not in reconstruction\n", toUtf8(line).c_str());
+            same = false;
+        }
+    }
+    if (!same) {
+        fprintf(stderr, "%s table not verified\n", name);
+    }
+    return same;
+}
+
+}  // namespace
+
+// static
+bool PatternSource::load(const std::string& patPath, PatternSource* out) {
+    const std::string suffix = ".pat.txt";
+    if (patPath.size() < suffix.size() ||
+        patPath.compare(patPath.size() - suffix.size(), suffix.size(), suffix) != 0) {
+        fprintf(stderr, "%s is not a .pat.txt file\n", patPath.c_str());
+        return false;
+    }
+    const std::string base = patPath.substr(0, patPath.size() - suffix.size());
+    std::vector<std::u32string> chrLines;
+    if (!readLines(patPath, &out->patterns) || !readLines(base + ".chr.txt", &chrLines) ||
+        !readLines(base + ".hyp.txt", &out->exceptions)) {
+        return false;
+    }
+
+    out->alphabet.clear();
+    out->alphabet['.'] = 0;
+    out->letters.clear();
+    for (uint32_t i = 0; i < chrLines.size(); ++i) {
+        std::u32string line = chrLines[i];
+        if (line.size() > 2) {
+            if (line == SHARP_S_TO_DOUBLE) {
+                // Replace with the lowercasing from the capital letter sharp s.
+                line = SHARP_S_TO_CAPITAL;
+            } else {
+                // The lowercase maps to a multi-character uppercase sequence, ignore the
+                // uppercase.
+                line.resize(1);
+            }
+        } else if (line.size() != 2) {
+            fprintf(stderr, "%s.chr.txt:%u: expected 2 chars\n", base.c_str(), i + 1);
+            return false;
+        }
+        for (char32_t c : line) {
+            out->alphabet[c] = i + 1;
+        }
+        out->letters.push_back(line[0]);
+    }
+    return true;
+}
+
+bool compileHyb(const PatternSource& source, std::vector<uint8_t>* out) {
+    TrieBuilder builder(source.alphabet);
+    for (const std::u32string& pattern : source.patterns) {
+        builder.addPattern(pattern);
+    }
+    for (const std::u32string& exception : source.exceptions) {
+        builder.addException(exception);
+    }
+    return builder.build(out);
+}
+
+bool HybFile::open(const uint8_t* data, size_t size) {
+    mData = data;
+    if (data == nullptr || size < HEADER_SIZE) {
+        fprintf(stderr, "too short for a hyb file\n");
+        return false;
+    }
+    if (readUint32(0) != HYB_MAGIC || readUint32(4) != 0) {
+        fprintf(stderr, "not a hyb file or unsupported version\n");
+        return false;
+    }
+    mAlphabetOffset = readUint32(8);
+    mTrieOffset = readUint32(12);
+    mPatternOffset = readUint32(16);
+    mFileSize = readUint32(20);
+    if (mFileSize > size || mAlphabetOffset < HEADER_SIZE || mAlphabetOffset > mTrieOffset ||
+        mTrieOffset > mPatternOffset || mPatternOffset > mFileSize ||
+        (mAlphabetOffset | mTrieOffset | mPatternOffset) % 4 != 0) {
+        fprintf(stderr, "malformed header\n");
+        return false;
+    }
+
+    const uint32_t alphabetSize = mTrieOffset - mAlphabetOffset;
+    if (alphabetSize < 8) {
+        fprintf(stderr, "malformed alphabet table\n");
+        return false;
+    }
+    mAlphabetVersion = readUint32(mAlphabetOffset);
+    mMaxAlphabetValue = 0;
+    if (mAlphabetVersion == 0) {
+        mMinCodePoint = readUint32(mAlphabetOffset + 4);
+        mMaxCodePoint = alphabetSize >= 12 ? readUint32(mAlphabetOffset + 8) : 0;
+        if (alphabetSize < 12 || mMinCodePoint > mMaxCodePoint ||
+            mMaxCodePoint - mMinCodePoint > alphabetSize - 12) {
+            fprintf(stderr, "malformed alphabet table\n");
+            return false;
+        }
+        for (uint32_t i = 0; i < mMaxCodePoint - mMinCodePoint; ++i) {
+            mMaxAlphabetValue =
+                    std::max<uint32_t>(mMaxAlphabetValue, mData[mAlphabetOffset + 12 + i]);
+        }
+    } else if (mAlphabetVersion == 1) {
+        mAlphabetEntryCount = readUint32(mAlphabetOffset + 4);
+        if (mAlphabetEntryCount > (alphabetSize - 8) / 4) {
+            fprintf(stderr, "malformed alphabet table\n");
+            return false;
+        }
+        for (uint32_t i = 0; i < mAlphabetEntryCount; ++i) {
+            mMaxAlphabetValue =
+                    std::max(mMaxAlphabetValue, readUint32(mAlphabetOffset + 8 + i * 4) & 0x7ff);
+        }
+    } else {
+        fprintf(stderr, "unknown alphabet table version %u\n", mAlphabetVersion);
+        return false;
+    }
+
+    const uint32_t trieSize = mPatternOffset - mTrieOffset;
+    if (trieSize < TRIE_HEADER_SIZE) {
+        fprintf(stderr, "malformed trie table\n");
+        return false;
+    }
+    mCharMask = readUint32(mTrieOffset + 4);
+    mLinkShift = readUint32(mTrieOffset + 8);
+    mLinkMask = readUint32(mTrieOffset + 12);
+    mPatternShift = readUint32(mTrieOffset + 16);
+    mTrieEntryCount = readUint32(mTrieOffset + 20);
+    mTrieDataOffset = mTrieOffset + TRIE_HEADER_SIZE;
+    if (mTrieEntryCount == 0 || mTrieEntryCount > (trieSize - TRIE_HEADER_SIZE) / 4 ||
+        mLinkShift >= 32 || mPatternShift >= 32) {
+        fprintf(stderr, "malformed trie table\n");
+        return false;
+    }
+
+    const uint32_t patternSize = mFileSize - mPatternOffset;
+    if (patternSize < PATTERN_HEADER_SIZE) {
+        fprintf(stderr, "malformed pattern table\n");
+        return false;
+    }
+    mPatternEntryCount = readUint32(mPatternOffset + 4);
+    mPatternBufOffset = readUint32(mPatternOffset + 8);
+    mPatternBufSize = readUint32(mPatternOffset + 12);
+    if (mPatternEntryCount > (patternSize - PATTERN_HEADER_SIZE) / 4 ||
+        mPatternBufOffset < PATTERN_HEADER_SIZE + mPatternEntryCount * 4 ||
+        mPatternBufOffset > patternSize || mPatternBufSize > patternSize - mPatternBufOffset) {
+        fprintf(stderr, "malformed pattern table\n");
+        return false;
+    }
+    return true;
+}
+
+uint32_t HybFile::readUint32(uint32_t offset) const {
+    uint32_t value;
+    memcpy(&value, mData + offset, sizeof(value));
+    return value;
+}
+
+uint32_t HybFile::alphabetValue(uint32_t codePoint) const {
+    if (mAlphabetVersion == 0) {
+        if (codePoint < mMinCodePoint || codePoint >= mMaxCodePoint) {
+            return 0;
+        }
+        return mData[mAlphabetOffset + 12 + codePoint - mMinCodePoint];
+    }
+    uint32_t begin = 0;
+    uint32_t end = mAlphabetEntryCount;
+    while (begin < end) {
+        const uint32_t mid = begin + (end - begin) / 2;
+        const uint32_t entry = readUint32(mAlphabetOffset + 8 + mid * 4);
+        if ((entry >> 11) < codePoint) {
+            begin = mid + 1;
+        } else if ((entry >> 11) > codePoint) {
+            end = mid;
+        } else {
+            return entry & 0x7ff;
+        }
+    }
+    return 0;
+}
+
+uint32_t HybFile::follow(uint32_t node, uint32_t value) const {
+    if (value >= mTrieEntryCount - node) {
+        return 0;
+    }
+    const uint32_t entry = trieEntry(node + value);
+    if ((entry & mCharMask) != value) {
+        return 0;
+    }
+    const uint32_t link = (entry & mLinkMask) >> mLinkShift;
+    return link < mTrieEntryCount ? link : 0;
+}
+
+bool HybFile::appendPattern(uint32_t index, std::vector<uint8_t>* out) const {
+    if (index >= mPatternEntryCount) {
+        return false;
+    }
+    const uint32_t entry = readUint32(mPatternOffset + PATTERN_HEADER_SIZE + index * 4);
+    const uint32_t length = entry >> 26;
+    const uint32_t shift = (entry >> 20) & 0x3f;
+    const uint32_t offset = entry & 0xfffff;
+    if (offset > mPatternBufSize || length > mPatternBufSize - offset) {
+        return false;
+    }
+    const uint8_t* buf = mData + mPatternOffset + mPatternBufOffset + offset;
+    out->insert(out->end(), buf, buf + length);
+    out->insert(out->end(), shift, 0);
+    return true;
+}
+
+uint32_t HybFile::countTrieVisits(const std::vector<uint16_t>& word) const {
+    std::vector<uint32_t> codes;
+    codes.push_back(0);
+    for (uint16_t c : word) {
+        const uint32_t value = alphabetValue(c);
+        if (value == 0) {
+            return 0;
+        }
+        codes.push_back(value);
+    }
+    codes.push_back(0);
+    uint32_t visits = 0;
+    for (size_t i = 0; i < codes.size() - 1; ++i) {
+        uint32_t node = 0;
+        for (size_t j = i; j < codes.size(); ++j) {
+            if (codes[j] >= mTrieEntryCount - node) {
+                break;
+            }
+            const uint32_t entry = trieEntry(node + codes[j]);
+            if ((entry & mCharMask) != codes[j]) {
+                break;
+            }
+            node = (entry & mLinkMask) >> mLinkShift;
+            visits++;
+            if (node >= mTrieEntryCount) {
+                break;
+            }
+        }
+    }
+    return visits;
+}
+
+void HybFile::computeStats(TrieStats* out) const {
+    out->alphabetSize = mTrieOffset - mAlphabetOffset;
+    out->trieSize = mPatternOffset - mTrieOffset;
+    out->patternSize = mFileSize - mPatternOffset;
+    out->entryCount = mTrieEntryCount;
+    // The pattern 0 is the empty pattern for the nodes without pattern.
+    out->patternCount = mPatternEntryCount == 0 ? 0 : mPatternEntryCount - 1;
+    out->nodeCount = 0;
+    out->edgeCount = 0;
+    out->fanOutHistogram.clear();
+
+    std::vector<bool> visited(mTrieEntryCount, false);
+    std::vector<bool> used(mTrieEntryCount, false);
+    std::vector<uint32_t> stack(1, 0);
+    visited[0] = true;
+    while (!stack.empty()) {
+        const uint32_t node = stack.back();
+        stack.pop_back();
+        out->nodeCount++;
+        used[node] = true;
+        uint32_t fanOut = 0;
+        for (uint32_t value = 0; value <= mMaxAlphabetValue; ++value) {
+            const uint32_t child = follow(node, value);
+            if (child == 0) {
+                continue;
+            }
+            fanOut++;
+            used[node + value] = true;
+            if (!visited[child]) {
+                visited[child] = true;
+                stack.push_back(child);
+            }
+        }
+        out->edgeCount += fanOut;
+        out->fanOutHistogram[fanOut]++;
+    }
+    out->usedEntryCount = std::count(used.begin(), used.end(), true);
+}
+
+bool HybFile::traverse(uint32_t node, const std::u32string& s, const PatternSource& source,
+                       std::vector<std::u32string>* patterns,
+                       std::vector<std::u32string>* exceptions) const {
+    if (s.size() > 255) {
+        fprintf(stderr, "trie too deep, it may have a cycle\n");
+        return false;
+    }
+    const uint32_t patternIndex = trieEntry(node) >> mPatternShift;
+    if (patternIndex != 0) {
+        std::vector<uint8_t> pattern;
+        if (!appendPattern(patternIndex, &pattern)) {
+            fprintf(stderr, "pattern %u out of the pattern table\n", patternIndex);
+            return false;
+        }
+        std::u32string result;
+        bool isException = false;
+        for (size_t i = 0; i <= s.size(); ++i) {
+            const int64_t patternOffset = i - 1 + pattern.size() - s.size();
+            const uint8_t code = patternOffset < 0 ? 0 : pattern[patternOffset];
+            if (code >= 1 && code <= 9) {
+                result.push_back('0' + code);
+            } else if (code == EXCEPTION_DONT_BREAK) {
+                isException = true;
+            } else if (code == EXCEPTION_BREAK) {
+                result.push_back('-');
+                isException = true;
+            } else if (code != 0) {
+                fprintf(stderr, "unexpected code %u in pattern %u\n", code, patternIndex);
+                return false;
+            }
+            if (i < s.size()) {
+                result.push_back(s[i]);
+            }
+        }
+        if (isException) {
+            if (result.size() < 2 || result.front() != '.' || result.back() != '.') {
+                fprintf(stderr, "expected leading and trailing '.' in exception\n");
+                return false;
+            }
+            exceptions->push_back(result.substr(1, result.size() - 2));
+        } else {
+            patterns->push_back(result);
+        }
+    }
+    for (uint32_t value = 0; value <= mMaxAlphabetValue; ++value) {
+        const uint32_t child = follow(node, value);
+        if (child == 0) {
+            continue;
+        }
+        const char32_t c = value == 0 ? U'.'
+                                      : (value <= source.letters.size() ? source.letters[value - 1]
+                                                                        : U'\ufffd');
+        if (!traverse(child, s + c, source, patterns, exceptions)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool HybFile::verify(const PatternSource& source) const {
+    bool verified = true;
+
+    std::map<uint32_t, uint32_t> alphabet;
+    if (mAlphabetVersion == 0) {
+        for (uint32_t c = mMinCodePoint; c < mMaxCodePoint; ++c) {
+            if (alphabetValue(c) != 0) {
+                alphabet[c] = alphabetValue(c);
+            }
+        }
+    } else {
+        for (uint32_t i = 0; i < mAlphabetEntryCount; ++i) {
+            const uint32_t entry = readUint32(mAlphabetOffset + 8 + i * 4);
+            alphabet[entry >> 11] = entry & 0x7ff;
+        }
+    }
+    std::map<uint32_t, uint32_t> expectedAlphabet = source.alphabet;
+    expectedAlphabet.erase('.');
+    if (alphabet != expectedAlphabet) {
+        for (const auto& [c, value] : alphabet) {
+            auto it = expectedAlphabet.find(c);
+            if (it == expectedAlphabet.end() || it->second != value) {
+                printf("U+%04X maps to %u in reconstruction\n", c, value);
+            }
+        }
+        for (const auto& [c, value] : expectedAlphabet) {
+            auto it = alphabet.find(c);
+            if (it == alphabet.end() || it->second != value) {
+                printf("U+%04X maps to %u in file\n", c, value);
+            }
+        }
+        fprintf(stderr, "alphabet table not verified\n");
+        verified = false;
+    }
+
+    std::vector<std::u32string> patterns;
+    std::vector<std::u32string> exceptions;
+    if (!traverse(0, U"", source, &patterns, &exceptions)) {
+        return false;
+    }
+    std::set<std::u32string> sourcePatterns;
+    for (std::u32string pattern : source.patterns) {
+        pattern.erase(std::remove(pattern.begin(), pattern.end(), U'0'), pattern.end());
+        sourcePatterns.insert(pattern);
+    }
+    verified &= compareLines("pattern", std::set<std::u32string>(patterns.begin(), patterns.end()),
+                             sourcePatterns);
+    verified &= compareLines(
+            "exception", std::set<std::u32string>(exceptions.begin(), exceptions.end()),
+            std::set<std::u32string>(source.exceptions.begin(), source.exceptions.end()));
+    return verified;
+}
+
+}  // namespace minikin
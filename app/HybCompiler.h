@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MINIKIN_HYB_COMPILER_H
+#define MINIKIN_HYB_COMPILER_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace minikin {
+
+// The hyphenation patterns in the TeX format, i.e. the trio of the pat, chr and hyp files.
+struct PatternSource {
+    // Maps the code points to the alphabet values, which are the line numbers in the chr file
+    // starting from 1. '.', the word boundary in the patterns, maps to 0.
+    std::map<uint32_t, uint32_t> alphabet;
+
+    // The first character of each line of the chr file, i.e. the lowercase letter of the alphabet
+    // value of the line number.
+    std::vector<uint32_t> letters;
+
+    // The lines of the pat file, e.g. ".ad4der".
+    std::vector<std::u32string> patterns;
+
+    // The lines of the hyp file, e.g. "ta-ble".
+    std::vector<std::u32string> exceptions;
+
+    // Loads the pat file and the chr and hyp files next to it, e.g. hyph-foo.chr.txt and
+    // hyph-foo.hyp.txt for hyph-foo.pat.txt. Prints the error and returns false on failure.
+    static bool load(const std::string& patPath, PatternSource* out);
+};
+
+// The shape of the packed trie in a hyb file.
+struct TrieStats {
+    // The sizes of the sections, in bytes.
+    uint32_t alphabetSize;
+    uint32_t trieSize;
+    uint32_t patternSize;
+
+    // The number of the trie entries, of the nodes and edges reachable from the root, and of the
+    // entries used by them. A node shares its entry with an edge of the other node if packed well.
+    uint32_t entryCount;
+    uint32_t nodeCount;
+    uint32_t edgeCount;
+    uint32_t usedEntryCount;
+
+    uint32_t patternCount;
+
+    // The number of the nodes by the number of their outgoing edges.
+    std::map<uint32_t, uint32_t> fanOutHistogram;
+};
+
+// Compiles the patterns into a hyb file in the same way as tools/mk_hyb_file.py, so the output is
+// identical. See doc/hyb_file_format.md for the format. Prints the error and returns false on
+// failure.
+bool compileHyb(const PatternSource& source, std::vector<uint8_t>* out);
+
+// A read-only view of a hyb file. The bounds of the tables are checked on opening, so the lookups
+// never read out of the data.
+class HybFile {
+public:
+    // Prints the error and returns false if the data is not a well-formed hyb file. The data must
+    // outlive this instance.
+    bool open(const uint8_t* data, size_t size);
+
+    // Returns the alphabet value of the code point, or 0 if not in the alphabet.
+    uint32_t alphabetValue(uint32_t codePoint) const;
+
+    // Returns the number of the trie nodes visited to hyphenate the word, in the same way as
+    // Hyphenator does without the compiled patterns. Returns 0 if the word has a character out of
+    // the alphabet, as such words are not hyphenated with the patterns.
+    uint32_t countTrieVisits(const std::vector<uint16_t>& word) const;
+
+    void computeStats(TrieStats* out) const;
+
+    // Reconstructs the alphabet, the patterns and the exceptions from the file, and checks that
+    // they are the same as the source regardless of the order of the lines. The explicit zeros in
+    // the source patterns are ignored as they are not stored. Prints the differences and returns
+    // false if not the same.
+    bool verify(const PatternSource& source) const;
+
+private:
+    uint32_t readUint32(uint32_t offset) const;
+    uint32_t trieEntry(uint32_t index) const { return readUint32(mTrieDataOffset + index * 4); }
+
+    // Appends the pattern with the trailing zeros to the out. Returns false if the pattern is out
+    // of the pattern table.
+    bool appendPattern(uint32_t index, std::vector<uint8_t>* out) const;
+
+    // Follows the edge with the alphabet value from the node. Returns 0 if no such edge.
+    uint32_t follow(uint32_t node, uint32_t value) const;
+
+    // Reconstructs the patterns and the exceptions from the node for the string s.
+    bool traverse(uint32_t node, const std::u32string& s, const PatternSource& source,
+                  std::vector<std::u32string>* patterns,
+                  std::vector<std::u32string>* exceptions) const;
+
+    const uint8_t* mData = nullptr;
+    uint32_t mFileSize = 0;
+
+    uint32_t mAlphabetOffset = 0;
+    uint32_t mAlphabetVersion = 0;
+    // The range of the code points for the direct version.
+    uint32_t mMinCodePoint = 0;
+    uint32_t mMaxCodePoint = 0;
+    // The number of the entries for the general version.
+    uint32_t mAlphabetEntryCount = 0;
+    uint32_t mMaxAlphabetValue = 0;
+
+    uint32_t mTrieOffset = 0;
+    uint32_t mTrieDataOffset = 0;
+    uint32_t mCharMask = 0;
+    uint32_t mLinkShift = 0;
+    uint32_t mLinkMask = 0;
+    uint32_t mPatternShift = 0;
+    uint32_t mTrieEntryCount = 0;
+
+    uint32_t mPatternOffset = 0;
+    uint32_t mPatternEntryCount = 0;
+    uint32_t mPatternBufOffset = 0;
+    uint32_t mPatternBufSize = 0;
+};
+
+}  // namespace minikin
+
+#endif  // MINIKIN_HYB_COMPILER_H
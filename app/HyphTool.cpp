@@ -1,64 +1,402 @@
-#include <string.h>
-#include <sys/stat.h>
+// Compiles hyphenation patterns into hyb files and measures the hyphenation with them. Run without
+// arguments for the usage.
+
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
 #include <vector>
 
-#include <utils/Log.h>
+#include <unicode/uchar.h>
+#include <unicode/utf16.h>
+#include <unicode/utf8.h>
 
+#include "minikin/Characters.h"
 #include "minikin/Hyphenator.h"
 
-using minikin::HyphenationType;
-using minikin::Hyphenator;
-
-Hyphenator* loadHybFile(const char* fn, int minPrefix, int minSuffix, const char* language) {
-    struct stat statbuf;
-    int status = stat(fn, &statbuf);
-    if (status < 0) {
-        fprintf(stderr, "error opening %s\n", fn);
-        return nullptr;
-    }
-    size_t size = statbuf.st_size;
-    FILE* f = fopen(fn, "rb");
-    if (f == NULL) {
-        fprintf(stderr, "error opening %s\n", fn);
-        return nullptr;
-    }
-    uint8_t* buf = new uint8_t[size];
-    size_t read_size = fread(buf, 1, size, f);
-    fclose(f);
-    if (read_size < size) {
-        fprintf(stderr, "error reading %s\n", fn);
-        delete[] buf;
-        return nullptr;
-    }
-    return Hyphenator::loadBinary(buf, minPrefix, minSuffix, language);
+#include "HybCompiler.h"
+
+namespace minikin {
+
+namespace {
+
+const char* kUsage =
+        "usage: hyphtool compile hyph-foo.pat.txt hyph-foo.hyb\n"
+        "       hyphtool verify hyph-foo.hyb hyph-foo.pat.txt\n"
+        "       hyphtool stats hyph-foo.hyb\n"
+        "       hyphtool bench [options] [-n iterations] hyph-foo.hyb corpus.txt\n"
+        "       hyphtool hyphenate [options] hyph-foo.hyb word...\n"
+        "\n"
+        "compile converts the pat, chr and hyp files into a hyb file and verifies it, as\n"
+        "tools/mk_hyb_file.py does. The chr and hyp files are found next to the pat file.\n"
+        "bench hyphenates the words of the UTF-8 corpus and reports the words per second with\n"
+        "and without the compiled patterns, and the histogram of the trie nodes visited per word.\n"
+        "\n"
+        "options: -l locale (default en), -p min_prefix (default 2), -s min_suffix (default 3)\n";
+
+struct Options {
+    std::string locale = "en";
+    size_t minPrefix = 2;
+    size_t minSuffix = 3;
+    int iterations = 10;
+};
+
+// Parses the options starting at argv[*index], and advances the index to the first argument
+// which is not an option. Returns false on an unknown option.
+bool parseOptions(int argc, char** argv, int* index, Options* out) {
+    for (; *index + 1 < argc && argv[*index][0] == '-'; *index += 2) {
+        const std::string option = argv[*index];
+        const char* value = argv[*index + 1];
+        if (option == "-l") {
+            out->locale = value;
+        } else if (option == "-p") {
+            out->minPrefix = atoi(value);
+        } else if (option == "-s") {
+            out->minSuffix = atoi(value);
+        } else if (option == "-n") {
+            out->iterations = std::max(atoi(value), 1);
+        } else {
+            fprintf(stderr, "unknown option %s\n", option.c_str());
+            return false;
+        }
+    }
+    return true;
 }
 
-int main(int argc, char** argv) {
-    Hyphenator* hyph = loadHybFile("/tmp/en.hyb", 2, 3, "en");  // should also be configurable
-    std::vector<HyphenationType> result;
+bool readFile(const char* path, std::vector<uint8_t>* out) {
+    FILE* fp = fopen(path, "rb");
+    if (fp == nullptr) {
+        fprintf(stderr, "error opening %s\n", path);
+        return false;
+    }
+    uint8_t buf[4096];
+    size_t readSize;
+    out->clear();
+    while ((readSize = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        out->insert(out->end(), buf, buf + readSize);
+    }
+    const bool failed = ferror(fp);
+    fclose(fp);
+    if (failed) {
+        fprintf(stderr, "error reading %s\n", path);
+    }
+    return !failed;
+}
+
+bool writeFile(const char* path, const std::vector<uint8_t>& data) {
+    FILE* fp = fopen(path, "wb");
+    if (fp == nullptr) {
+        fprintf(stderr, "error opening %s\n", path);
+        return false;
+    }
+    const size_t writeSize = fwrite(data.data(), 1, data.size(), fp);
+    if (fclose(fp) != 0 || writeSize != data.size()) {
+        fprintf(stderr, "error writing %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+// Invalid sequences are replaced with U+FFFD.
+std::vector<uint16_t> utf8ToUtf16(const uint8_t* text, int32_t length) {
+    std::vector<uint16_t> out;
+    int32_t i = 0;
+    while (i < length) {
+        UChar32 c;
+        U8_NEXT(text, i, length, c);
+        if (c < 0) {
+            c = 0xFFFD;
+        }
+        if (U16_LENGTH(c) == 1) {
+            out.push_back(c);
+        } else {
+            out.push_back(U16_LEAD(c));
+            out.push_back(U16_TRAIL(c));
+        }
+    }
+    return out;
+}
+
+void appendUtf8(uint32_t c, std::string* out) {
+    uint8_t buf[U8_MAX_LENGTH];
+    int32_t length = 0;
+    U8_APPEND_UNSAFE(buf, length, c);
+    out->append(reinterpret_cast<const char*>(buf), length);
+}
+
+// The characters of the words in the corpus. The other characters separate the words.
+bool isWordChar(uint32_t c) {
+    return u_isalpha(c) || (U_GET_GC_MASK(c) & U_GC_M_MASK) != 0 || c == CHAR_SOFT_HYPHEN ||
+           c == CHAR_ZWJ;
+}
+
+std::vector<std::vector<uint16_t>> splitWords(const std::vector<uint16_t>& text) {
+    std::vector<std::vector<uint16_t>> words;
     std::vector<uint16_t> word;
-    if (argc < 2) {
-        fprintf(stderr, "usage: hyphtool word\n");
+    size_t i = 0;
+    while (i < text.size()) {
+        const size_t start = i;
+        uint32_t c;
+        U16_NEXT(text.data(), i, text.size(), c);
+        if (isWordChar(c)) {
+            word.insert(word.end(), text.begin() + start, text.begin() + i);
+        } else if (!word.empty()) {
+            words.push_back(std::move(word));
+            word.clear();
+        }
+    }
+    if (!word.empty()) {
+        words.push_back(std::move(word));
+    }
+    return words;
+}
+
+// Prints the histogram with the percentages. The labels are formatted with the keys.
+void printHistogram(const std::vector<std::pair<std::string, uint64_t>>& histogram) {
+    uint64_t total = 0;
+    for (const auto& bucket : histogram) {
+        total += bucket.second;
+    }
+    for (const auto& [label, count] : histogram) {
+        printf("  %12s: %8llu (%5.1f%%)\n", label.c_str(), static_cast<unsigned long long>(count),
+               total == 0 ? 0.0 : 100.0 * count / total);
+    }
+}
+
+void printStats(const HybFile& file) {
+    TrieStats stats;
+    file.computeStats(&stats);
+    printf("alphabet: %u bytes, trie: %u bytes, pattern: %u bytes\n", stats.alphabetSize,
+           stats.trieSize, stats.patternSize);
+    printf("%u patterns, %u trie nodes, %u edges\n", stats.patternCount, stats.nodeCount,
+           stats.edgeCount);
+    printf("%u of %u trie entries used (%.1f%%)\n", stats.usedEntryCount, stats.entryCount,
+           100.0 * stats.usedEntryCount / stats.entryCount);
+    printf("trie nodes by outgoing edges:\n");
+    std::vector<std::pair<std::string, uint64_t>> histogram;
+    for (const auto& [fanOut, count] : stats.fanOutHistogram) {
+        histogram.emplace_back(std::to_string(fanOut), count);
+    }
+    printHistogram(histogram);
+}
+
+int compile(int argc, char** argv) {
+    if (argc != 2) {
+        fputs(kUsage, stderr);
+        return 1;
+    }
+    PatternSource source;
+    if (!PatternSource::load(argv[0], &source)) {
+        return 1;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<uint8_t> hyb;
+    if (!compileHyb(source, &hyb)) {
         return 1;
     }
-    char* asciiword = argv[1];
-    size_t len = strlen(asciiword);
-    for (size_t i = 0; i < len; i++) {
-        uint32_t c = asciiword[i];
-        if (c == '-') {
-            c = 0x00AD;
+    const std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+    if (!writeFile(argv[1], hyb)) {
+        return 1;
+    }
+    printf("compiled %zu patterns and %zu exceptions into %zu bytes in %.1f ms\n",
+           source.patterns.size(), source.exceptions.size(), hyb.size(), elapsed.count());
+    HybFile file;
+    if (!file.open(hyb.data(), hyb.size()) || !file.verify(source)) {
+        return 1;
+    }
+    printStats(file);
+    return 0;
+}
+
+int verify(int argc, char** argv) {
+    if (argc != 2) {
+        fputs(kUsage, stderr);
+        return 1;
+    }
+    std::vector<uint8_t> hyb;
+    PatternSource source;
+    HybFile file;
+    if (!readFile(argv[0], &hyb) || !PatternSource::load(argv[1], &source) ||
+        !file.open(hyb.data(), hyb.size()) || !file.verify(source)) {
+        return 1;
+    }
+    printf("verified %s\n", argv[0]);
+    return 0;
+}
+
+int stats(int argc, char** argv) {
+    if (argc != 1) {
+        fputs(kUsage, stderr);
+        return 1;
+    }
+    std::vector<uint8_t> hyb;
+    HybFile file;
+    if (!readFile(argv[0], &hyb) || !file.open(hyb.data(), hyb.size())) {
+        return 1;
+    }
+    printStats(file);
+    return 0;
+}
+
+int bench(int argc, char** argv) {
+    Options options;
+    int index = 0;
+    if (!parseOptions(argc, argv, &index, &options) || argc - index != 2) {
+        fputs(kUsage, stderr);
+        return 1;
+    }
+    std::vector<uint8_t> hyb;
+    std::vector<uint8_t> corpus;
+    HybFile file;
+    if (!readFile(argv[index], &hyb) || !file.open(hyb.data(), hyb.size()) ||
+        !readFile(argv[index + 1], &corpus)) {
+        return 1;
+    }
+    const std::vector<std::vector<uint16_t>> words =
+            splitWords(utf8ToUtf16(corpus.data(), corpus.size()));
+    if (words.empty()) {
+        fprintf(stderr, "no words in %s\n", argv[index + 1]);
+        return 1;
+    }
+    size_t charCount = 0;
+    size_t maxLength = 0;
+    for (const std::vector<uint16_t>& word : words) {
+        charCount += word.size();
+        maxLength = std::max(maxLength, word.size());
+    }
+    printf("%zu words, %zu chars\n", words.size(), charCount);
+
+    std::vector<HyphenationType> result(maxLength);
+    using Loader = Hyphenator* (*)(const uint8_t*, size_t, size_t, size_t, const std::string&);
+    const std::pair<const char*, Loader> loaders[] = {
+            {"trie", &Hyphenator::loadBinary},
+            {"compiled", &Hyphenator::loadCompiled},
+    };
+    for (const auto& [name, load] : loaders) {
+        std::unique_ptr<Hyphenator> hyphenator(load(hyb.data(), hyb.size(), options.minPrefix,
+                                                    options.minSuffix, options.locale));
+        if (hyphenator == nullptr) {
+            fprintf(stderr, "failed to load %s\n", argv[index]);
+            return 1;
+        }
+        size_t breakCount = 0;
+        for (const std::vector<uint16_t>& word : words) {
+            hyphenator->hyphenate(word, result.data());
+            for (size_t i = 0; i < word.size(); ++i) {
+                breakCount += result[i] != HyphenationType::DONT_BREAK;
+            }
+        }
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < options.iterations; ++i) {
+            for (const std::vector<uint16_t>& word : words) {
+                hyphenator->hyphenate(word, result.data());
+            }
         }
-        // ASCII (or possibly ISO Latin 1), but kinda painful to do utf conversion :(
-        word.push_back(c);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        const double wordCount = static_cast<double>(words.size()) * options.iterations;
+        printf("%s: %.0f words/sec, %.1f ns/word, %zu hyphenation points\n", name,
+               wordCount / elapsed.count(), elapsed.count() * 1e9 / wordCount, breakCount);
     }
-    hyph->hyphenate(word, &result);
-    for (size_t i = 0; i < len; i++) {
-        if (result[i] != HyphenationType::DONT_BREAK) {
-            printf("-");
+
+    // Bucketed by the powers of two, i.e. the bucket i > 0 has [2^(i-1), 2^i).
+    std::vector<uint64_t> buckets;
+    uint64_t visitCount = 0;
+    for (const std::vector<uint16_t>& word : words) {
+        const uint32_t visits = file.countTrieVisits(word);
+        visitCount += visits;
+        size_t bucket = 0;
+        for (uint32_t v = visits; v != 0; v >>= 1) {
+            bucket++;
+        }
+        if (bucket >= buckets.size()) {
+            buckets.resize(bucket + 1, 0);
         }
-        printf("%c", word[i]);
+        buckets[bucket]++;
     }
-    printf("\n");
+    printf("trie nodes visited per word, %.1f on average:\n",
+           static_cast<double>(visitCount) / words.size());
+    std::vector<std::pair<std::string, uint64_t>> histogram;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        const std::string label = i == 0 ? "0"
+                                         : std::to_string(1u << (i - 1)) + "-" +
+                                                   std::to_string((1u << i) - 1);
+        histogram.emplace_back(label, buckets[i]);
+    }
+    printHistogram(histogram);
     return 0;
 }
+
+int hyphenate(int argc, char** argv) {
+    Options options;
+    int index = 0;
+    if (!parseOptions(argc, argv, &index, &options) || argc - index < 2) {
+        fputs(kUsage, stderr);
+        return 1;
+    }
+    std::vector<uint8_t> hyb;
+    HybFile file;
+    if (!readFile(argv[index], &hyb) || !file.open(hyb.data(), hyb.size())) {
+        return 1;
+    }
+    std::unique_ptr<Hyphenator> hyphenator(Hyphenator::loadBinary(
+            hyb.data(), hyb.size(), options.minPrefix, options.minSuffix, options.locale));
+    if (hyphenator == nullptr) {
+        fprintf(stderr, "failed to load %s\n", argv[index]);
+        return 1;
+    }
+    std::vector<HyphenationType> result;
+    for (int i = index + 1; i < argc; ++i) {
+        std::vector<uint16_t> word =
+                utf8ToUtf16(reinterpret_cast<const uint8_t*>(argv[i]), strlen(argv[i]));
+        for (uint16_t& c : word) {
+            if (c == '-') {
+                c = CHAR_SOFT_HYPHEN;
+            }
+        }
+        hyphenator->hyphenate(word, &result);
+        std::string out;
+        size_t j = 0;
+        while (j < word.size()) {
+            if (result[j] != HyphenationType::DONT_BREAK) {
+                out.push_back('-');
+            }
+            uint32_t c;
+            U16_NEXT(word.data(), j, word.size(), c);
+            // The soft hyphens show up as the breaks.
+            if (c != CHAR_SOFT_HYPHEN) {
+                appendUtf8(c, &out);
+            }
+        }
+        printf("%s\n", out.c_str());
+    }
+    return 0;
+}
+
+}  // namespace
+
+}  // namespace minikin
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fputs(minikin::kUsage, stderr);
+        return 1;
+    }
+    const std::string command = argv[1];
+    if (command == "compile") {
+        return minikin::compile(argc - 2, argv + 2);
+    } else if (command == "verify") {
+        return minikin::verify(argc - 2, argv + 2);
+    } else if (command == "stats") {
+        return minikin::stats(argc - 2, argv + 2);
+    } else if (command == "bench") {
+        return minikin::bench(argc - 2, argv + 2);
+    } else if (command == "hyphenate") {
+        return minikin::hyphenate(argc - 2, argv + 2);
+    }
+    fputs(minikin::kUsage, stderr);
+    return 1;
+}
@@ -51,6 +51,10 @@ public:
         return minWidth;
     }
 
+    bool isConstant() const override {
+        return mIndents.empty() && (mFirstLineCount <= 0 || mFirstWidth == mRestWidth);
+    }
+
 private:
     float get(const std::vector<float>& vec, size_t lineNo) const {
         if (vec.empty()) {
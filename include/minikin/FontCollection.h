@@ -17,11 +17,15 @@
 #ifndef MINIKIN_FONT_COLLECTION_H
 #define MINIKIN_FONT_COLLECTION_H
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "minikin/FontFamily.h"
+#include "minikin/Macros.h"
 #include "minikin/MinikinFont.h"
 #include "minikin/U16StringPiece.h"
 
@@ -68,10 +72,22 @@ public:
 
     uint32_t getId() const;
 
+    // Returns the number of hits and misses of the per-character font family resolution cache.
+    // Only for testing and debugging.
+    uint32_t getFamilyCacheHitCount() const { return mFamilyCacheHitCount; }
+    uint32_t getFamilyCacheMissCount() const { return mFamilyCacheMissCount; }
+
 private:
     static const int kLogCharsPerPage = 8;
     static const int kPageMask = (1 << kLogCharsPerPage) - 1;
 
+    // The number of entries of the font family resolution cache. Must be a power of two.
+    static const int kLogFamilyCacheSize = 8;
+    static const uint32_t kFamilyCacheSize = 1 << kLogFamilyCacheSize;
+
+    // The number of slots of the locale matching score index. Must be a power of two.
+    static const uint32_t kLocaleMatchingScoreSlotCount = 16;
+
     // mFamilyVec holds the indices of the mFamilies and mRanges holds the range of indices of
     // mFamilyVec. The maximum number of pages is 0x10FF (U+10FFFF >> 8). The maximum number of
     // the fonts is 0xFF. Thus, technically the maximum length of mFamilyVec is 0x10EE01
@@ -89,7 +105,12 @@ private:
                                                         uint32_t localeListId,
                                                         FamilyVariant variant) const;
 
+    // Returns the index of mFamilies for the character without using the cache.
+    uint32_t getFamilyIndexForChar(uint32_t ch, uint32_t vs, uint32_t localeListId,
+                                   FamilyVariant variant) const;
+
     uint32_t calcFamilyScore(uint32_t ch, uint32_t vs, FamilyVariant variant, uint32_t localeListId,
+                             uint32_t localeScore,
                              const std::shared_ptr<FontFamily>& fontFamily) const;
 
     uint32_t calcCoverageScore(uint32_t ch, uint32_t vs, uint32_t localeListId,
@@ -98,6 +119,11 @@ private:
     static uint32_t calcLocaleMatchingScore(uint32_t userLocaleListId,
                                             const FontFamily& fontFamily);
 
+    // Returns the locale matching scores of all the families in mFamilies for the given user
+    // locale list. The scores are calculated on the first call for each locale list, and the
+    // lookups of the recently used locale lists don't take a lock.
+    const uint32_t* getLocaleMatchingScores(uint32_t userLocaleListId) const;
+
     static uint32_t calcVariantMatchingScore(FamilyVariant variant, const FontFamily& fontFamily);
 
     // unique id for this font collection (suitable for cache key)
@@ -124,6 +150,30 @@ private:
 
     // Set of supported axes in this collection.
     std::unordered_set<AxisTag> mSupportedAxes;
+
+    // A direct mapped cache of getFamilyForChar results. Each entry packs the code point, the
+    // variation selector, the locale list ID, the family variant and the resolved family index
+    // into a single word, so that the entries can be read and written without a lock.
+    std::unique_ptr<std::atomic<uint64_t>[]> mFamilyCache;
+    mutable std::atomic<uint32_t> mFamilyCacheHitCount;
+    mutable std::atomic<uint32_t> mFamilyCacheMissCount;
+
+    // The locale matching scores of all the families in mFamilies for a user locale list.
+    struct LocaleMatchingScores {
+        uint32_t localeListId;
+        std::vector<uint32_t> scores;
+    };
+
+    // A map from the user locale list ID to its locale matching scores. The entries are never
+    // modified or removed once inserted, so that the pointers published to
+    // mLocaleMatchingScoreSlots stay valid.
+    mutable std::unordered_map<uint32_t, std::unique_ptr<LocaleMatchingScores>>
+            mLocaleMatchingScores GUARDED_BY(mLocaleMatchingScoresMutex);
+    mutable std::mutex mLocaleMatchingScoresMutex;
+
+    // A direct mapped index into mLocaleMatchingScores by the locale list ID, so that the scores
+    // of the recently used locale lists are found without a lock.
+    std::unique_ptr<std::atomic<const LocaleMatchingScores*>[]> mLocaleMatchingScoreSlots;
 };
 
 }  // namespace minikin
@@ -21,6 +21,7 @@
 #ifndef MINIKIN_HYPHENATOR_H
 #define MINIKIN_HYPHENATOR_H
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -37,6 +38,26 @@ class Hyphenator;
 void addHyphenator(const std::string& localeStr, const Hyphenator* hyphenator);
 void addHyphenatorAlias(const std::string& fromLocaleStr, const std::string& toLocaleStr);
 
+// Registers the hyphenator of the hyb file at the path without reading the file. The file is
+// mapped on the first lookup of the locale or its aliases, so a process which never hyphenates the
+// locale never touches the patterns. The patterns are read in place from the shared mapping, see
+// Hyphenator::loadBinary, unless compile is true, in which case they are compiled on loading into
+// the faster but private heap form, see Hyphenator::loadCompiled. If the path is a hyphenation
+// bundle, the entry with the same locale string is used with the given minPrefix and minSuffix. If
+// the file can't be loaded, only the soft hyphens are processed for the locale.
+void addHyphenatorFromFile(const std::string& localeStr, const std::string& path,
+                           size_t minPrefix, size_t minSuffix, bool compile = false);
+
+// Registers the hyphenators and the aliases in the hyphenation bundle file, which packs the
+// patterns of multiple locales. See doc/hyb_file_format.md for the format. The file is mapped once
+// and never unmapped. Returns false if the file can't be mapped or is malformed, in which case
+// nothing is registered.
+bool addHyphenatorBundle(const std::string& path);
+
+// Same as above, but for the bundle data in memory. The data must be 4-byte aligned and must never
+// be released.
+bool addHyphenatorBundle(const uint8_t* data, size_t size);
+
 enum class HyphenationType : uint8_t {
     // Note: There are implicit assumptions scattered in the code that DONT_BREAK is 0.
 
@@ -176,7 +197,8 @@ public:
     // the vector is a "hyphenation type" for a potential hyphenation that can be applied at the
     // corresponding code unit offset in the word.
     //
-    // out must have at least the length of the word capacity.
+    // out must have at least the length of the word capacity. Its previous contents don't matter,
+    // so the same buffer can be reused for the words.
     //
     // Example: word is "hyphen", result is the following, corresponding to "hy-phen":
     // [DONT_BREAK, DONT_BREAK, BREAK_AND_INSERT_HYPHEN, DONT_BREAK, DONT_BREAK, DONT_BREAK]
@@ -190,6 +212,15 @@ public:
         return hyphenate(word, out->data());
     }
 
+    // Compute the hyphenation of all the words in a text at once, e.g. of a paragraph. The result
+    // of each word is stored at the same offsets as the word in the text, i.e. this is the same as
+    // calling hyphenate(text.substr(word), out + word.getStart()) for each word, but shares the
+    // buffers and the setup across the words. The entries out of the words are left untouched.
+    //
+    // out must have at least the length of the text, and the words must not overlap.
+    void hyphenate(const U16StringPiece& text, const std::vector<Range>& words,
+                   HyphenationType* out) const;
+
     // Returns true if the codepoint is like U+2010 HYPHEN in line breaking and usage: a character
     // immediately after which line breaks are allowed, but words containing it should not be
     // automatically hyphenated.
@@ -205,6 +236,28 @@ public:
     static Hyphenator* loadBinary(const uint8_t* patternData, size_t minPrefix, size_t minSuffix,
                                   const std::string& locale);
 
+    // Same as loadBinary, but for pattern data of the given size from an untrusted source, e.g.
+    // a downloaded file mapped as is. The header offsets and every table entry the lookups may
+    // reach are checked once here, so that hyphenation never reads out of the data. Returns
+    // nullptr if the data is not a well-formed hyb file of at most patternSize bytes, or is not
+    // 4-byte aligned.
+    static Hyphenator* loadBinary(const uint8_t* patternData, size_t patternSize,
+                                  size_t minPrefix, size_t minSuffix, const std::string& locale);
+
+    // Same as loadBinary, but also compiles the patterns into a faster form at load time. The
+    // alphabet is indexed directly by the code unit, and the patterns are matched by an
+    // Aho-Corasick automaton in a single pass over the word instead of a trie walk from each
+    // position. The compiled form takes up to several hundred KB of heap memory per locale, so
+    // use this only for the locales which are actually hyphenated.
+    static Hyphenator* loadCompiled(const uint8_t* patternData, size_t minPrefix,
+                                    size_t minSuffix, const std::string& locale);
+
+    // Same as loadCompiled, with the checks of the loadBinary for pattern data of the given size.
+    static Hyphenator* loadCompiled(const uint8_t* patternData, size_t patternSize,
+                                    size_t minPrefix, size_t minSuffix, const std::string& locale);
+
+    ~Hyphenator();
+
 private:
     enum class HyphenationLocale : uint8_t {
         OTHER = 0,
@@ -217,6 +270,11 @@ private:
     Hyphenator(const uint8_t* patternData, size_t minPrefix, size_t minSuffix,
                HyphenationLocale hyphenLocale);
 
+    // Same as hyphenate, using the alpha_codes buffer of MAX_HYPHENATED_SIZE entries. The longer
+    // words allocate a buffer.
+    void hyphenateWord(const U16StringPiece& word, uint16_t* alpha_codes,
+                       HyphenationType* out) const;
+
     // apply various hyphenation rules including hard and soft hyphens, ignoring patterns
     void hyphenateWithNoPatterns(const U16StringPiece& word, HyphenationType* out) const;
 
@@ -230,15 +288,19 @@ private:
     void hyphenateFromCodes(const uint16_t* codes, size_t len, HyphenationType hyphenValue,
                             HyphenationType* out) const;
 
-    // See also LONGEST_HYPHENATED_WORD in LineBreaker.cpp. Here the constant is used so
-    // that temporary buffers can be stack-allocated without waste, which is a slightly
-    // different use case. It measures UTF-16 code units.
+    // See also LONGEST_HYPHENATED_WORD in LineBreakerUtil.cpp. Here the constant is used so
+    // that temporary buffers for the usual words can be stack-allocated without waste, which is a
+    // slightly different use case. It measures UTF-16 code units.
     static const size_t MAX_HYPHENATED_SIZE = 64;
 
     const uint8_t* mPatternData;
     const size_t mMinPrefix, mMinSuffix;
     const HyphenationLocale mHyphenationLocale;
 
+    // The compiled patterns, or nullptr if not compiled. See loadCompiled.
+    struct CompiledPatterns;
+    std::unique_ptr<const CompiledPatterns> mCompiled;
+
     // accessors for binary data
     const Header* getHeader() const { return reinterpret_cast<const Header*>(mPatternData); }
 };
@@ -80,6 +80,16 @@ public:
                              const MinikinPaint& paint, StartHyphenEdit startHyphen,
                              EndHyphenEdit endHyphen, float* advances);
 
+    // Measures multiple ranges of the same text with the same paint. The result is the same as
+    // calling measureText for each range without hyphen edits, but the bidi analysis is skipped
+    // for LTR only text and the layout cache is accessed in batches.
+    // The total advance of ranges[i] is stored in totalAdvances[i]. When advances is not null,
+    // the per-character advances of the ranges are stored in the array in the order of ranges,
+    // i.e. the array must have the sum of the lengths of the ranges.
+    static void measureTextBatch(const U16StringPiece& str, const std::vector<Range>& ranges,
+                                 Bidi bidiFlags, const MinikinPaint& paint, float* totalAdvances,
+                                 float* advances);
+
     const std::vector<float>& advances() const { return mAdvances; }
 
     // public accessors
@@ -19,7 +19,9 @@
 
 #include "minikin/LayoutCore.h"
 
+#include <algorithm>
 #include <mutex>
+#include <vector>
 
 #include <utils/LruCache.h>
 
@@ -124,6 +126,13 @@ private:
     }
 };
 
+// A single request for LayoutCache::getOrCreateBatch.
+struct LayoutCacheRequest {
+    U16StringPiece text;
+    Range range;
+    bool dir;
+};
+
 class LayoutCache : private android::OnEntryRemoved<LayoutCacheKey, LayoutPiece*> {
 public:
     void clear() {
@@ -162,6 +171,81 @@ public:
         }
     }
 
+    // Looks up or creates the layout pieces for all the requests with the same paint. Unlike
+    // calling getOrCreate for each request, the cache lookups and insertions are done with a
+    // single lock acquisition per chunk of requests. The callback is called with the index of the
+    // request, the layout piece and the paint. The callback may be called in any order.
+    // Do not use LayoutCache inside the callback function, otherwise dead-lock may happen.
+    template <typename F>
+    void getOrCreateBatch(const std::vector<LayoutCacheRequest>& requests,
+                          const MinikinPaint& paint, F& f) {
+        if (paint.skipCache()) {
+            for (size_t i = 0; i < requests.size(); ++i) {
+                const LayoutCacheRequest& req = requests[i];
+                f(i, LayoutPiece(req.text, req.range, req.dir, paint, StartHyphenEdit::NO_EDIT,
+                                 EndHyphenEdit::NO_EDIT),
+                  paint);
+            }
+            return;
+        }
+        std::vector<size_t> misses;
+        for (size_t chunkStart = 0; chunkStart < requests.size(); chunkStart += kBatchChunkSize) {
+            const size_t chunkEnd = std::min(chunkStart + kBatchChunkSize, requests.size());
+            misses.clear();
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                for (size_t i = chunkStart; i < chunkEnd; ++i) {
+                    const LayoutCacheRequest& req = requests[i];
+                    if (req.range.getLength() >= LENGTH_LIMIT_CACHE) {
+                        misses.push_back(i);
+                        continue;
+                    }
+                    mRequestCount++;
+                    LayoutCacheKey key(req.text, req.range, paint, req.dir,
+                                       StartHyphenEdit::NO_EDIT, EndHyphenEdit::NO_EDIT);
+                    LayoutPiece* layout = mCache.get(key);
+                    if (layout != nullptr) {
+                        mCacheHitCount++;
+                        f(i, *layout, paint);
+                    } else {
+                        misses.push_back(i);
+                    }
+                }
+            }
+            if (misses.empty()) {
+                continue;
+            }
+
+            // Doing text layout takes long time, so releases the mutex during doing layout.
+            std::vector<std::unique_ptr<LayoutPiece>> created;
+            created.reserve(misses.size());
+            for (size_t i : misses) {
+                const LayoutCacheRequest& req = requests[i];
+                created.push_back(std::make_unique<LayoutPiece>(req.text, req.range, req.dir,
+                                                                paint, StartHyphenEdit::NO_EDIT,
+                                                                EndHyphenEdit::NO_EDIT));
+                f(i, *created.back(), paint);
+            }
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            for (size_t j = 0; j < misses.size(); ++j) {
+                const LayoutCacheRequest& req = requests[misses[j]];
+                if (req.range.getLength() >= LENGTH_LIMIT_CACHE) {
+                    continue;
+                }
+                LayoutCacheKey key(req.text, req.range, paint, req.dir, StartHyphenEdit::NO_EDIT,
+                                   EndHyphenEdit::NO_EDIT);
+                key.copyText();
+                if (mCache.put(key, created[j].get())) {
+                    created[j].release();
+                } else {
+                    // The same piece may appear more than once in a batch.
+                    key.freeText();
+                }
+            }
+        }
+    }
+
     void dumpStats(int fd) {
         std::lock_guard<std::mutex> lock(mMutex);
 #ifdef _WIN32
@@ -216,6 +300,9 @@ private:
     // number of strings
     static const size_t kMaxEntries = 5000;
 
+    // The number of requests processed under a single lock acquisition in getOrCreateBatch.
+    static const size_t kBatchChunkSize = 64;
+
     std::mutex mMutex;
 };
 
@@ -23,6 +23,7 @@
 #define MINIKIN_LINE_BREAKER_H
 
 #include <deque>
+#include <memory>
 #include <vector>
 
 #include "minikin/FontCollection.h"
@@ -83,14 +84,43 @@ public:
 
     // Called to find out the minimum line width. This mut not return negative values.
     virtual float getMin() const = 0;
+
+    // Returns true if getAt returns the same value for all lines. The line breaker uses a faster
+    // algorithm for such widths.
+    virtual bool isConstant() const { return false; }
+};
+
+// A line in the line breaking result.
+struct LineRecord {
+    LineRecord(int breakPoint, float width, float ascent, float descent, int flags)
+            : breakPoint(breakPoint),
+              width(width),
+              ascent(ascent),
+              descent(descent),
+              flags(flags) {}
+
+    // The offset of the line end.
+    int breakPoint;
+
+    // The width of the line.
+    float width;
+
+    // The extent of the line.
+    float ascent;
+    float descent;
+
+    // The hyphen edits of the line, and whether the line has a tab character.
+    int flags;
 };
 
 struct LineBreakResult {
 public:
     LineBreakResult() = default;
 
+    // Converts the line records into the parallel vectors below.
+    explicit LineBreakResult(const std::vector<LineRecord>& lines);
+
     // Following five vectors have the same length.
-    // TODO: Introduce individual line info struct if copy cost in JNI is negligible.
     std::vector<int> breakPoints;
     std::vector<float> widths;
     std::vector<float> ascents;
@@ -100,23 +130,139 @@ public:
     LineBreakResult(LineBreakResult&&) = default;
     LineBreakResult& operator=(LineBreakResult&&) = default;
 
-    void reverse() {
-        std::reverse(breakPoints.begin(), breakPoints.end());
-        std::reverse(widths.begin(), widths.end());
-        std::reverse(ascents.begin(), ascents.end());
-        std::reverse(descents.begin(), descents.end());
-        std::reverse(flags.begin(), flags.end());
-    }
-
 private:
     MINIKIN_PREVENT_COPY_AND_ASSIGN(LineBreakResult);
 };
 
+// Breaks the paragraph into lines. The lines are built as the records of breakIntoLineRecords and
+// then copied into the parallel vectors of LineBreakResult, so the new callers should use
+// breakIntoLineRecords, which saves the copy and the five allocations.
 LineBreakResult breakIntoLines(const U16StringPiece& textBuffer, BreakStrategy strategy,
                                HyphenationFrequency frequency, bool justified,
                                const MeasuredText& measuredText, const LineWidth& lineWidth,
                                const TabStops& tabStops);
 
+// Keeps the line breaking state of a paragraph for the next breakIntoLines call with it, e.g.
+// after the line width changes or the text is edited. Keep this alongside the MeasuredText.
+//
+// The word breaking and the hyphenation are skipped if the text and the measurement are unchanged,
+// so only the line break optimization runs again on resize. After a local edit, the optimization
+// resumes from the first changed break candidate if the widths of the preceding lines are
+// unchanged. The cached state is checked against the inputs, so a stale cache only costs the
+// check. The cache must not be used by multiple threads at the same time.
+class LineBreakerCache {
+public:
+    LineBreakerCache();
+    ~LineBreakerCache();
+
+    // Discards the cached state.
+    void clear();
+
+private:
+    friend std::vector<LineRecord> breakLineOptimal(const U16StringPiece& textBuf,
+                                                    const MeasuredText& measured,
+                                                    const LineWidth& lineWidthLimits,
+                                                    BreakStrategy strategy,
+                                                    HyphenationFrequency frequency, bool justified,
+                                                    LineBreakerCache* cache, uint32_t maxLines,
+                                                    bool computeLineInfo);
+
+    struct State;
+    std::unique_ptr<State> mState;
+
+    MINIKIN_PREVENT_COPY_AND_ASSIGN(LineBreakerCache);
+};
+
+// Same as the breakIntoLines above, but reuses and updates the cache for the optimal strategies.
+// The cache is not used for the greedy strategy.
+LineBreakResult breakIntoLines(const U16StringPiece& textBuffer, BreakStrategy strategy,
+                               HyphenationFrequency frequency, bool justified,
+                               const MeasuredText& measuredText, const LineWidth& lineWidth,
+                               const TabStops& tabStops, LineBreakerCache* cache);
+
+// Same as breakIntoLines above, but returns a record for each line in the line order. This is the
+// allocation-saving path, which avoids building the five parallel vectors of LineBreakResult. The
+// cache may be null.
+std::vector<LineRecord> breakIntoLineRecords(const U16StringPiece& textBuffer,
+                                             BreakStrategy strategy, HyphenationFrequency frequency,
+                                             bool justified, const MeasuredText& measuredText,
+                                             const LineWidth& lineWidth, const TabStops& tabStops,
+                                             LineBreakerCache* cache);
+
+// Same as breakIntoLineRecords above, but returns the first maxLines lines only, e.g. for
+// ellipsizing. Only the break points and the widths of the lines are computed, and the extents and
+// the flags are left zero. The greedy strategy stops breaking after maxLines lines. The optimal
+// strategies still need to optimize the whole paragraph, but skip the following lines.
+std::vector<LineRecord> breakIntoFirstLines(const U16StringPiece& textBuffer,
+                                            BreakStrategy strategy, HyphenationFrequency frequency,
+                                            bool justified, const MeasuredText& measuredText,
+                                            const LineWidth& lineWidth, const TabStops& tabStops,
+                                            uint32_t maxLines);
+
+// Returns the number of lines breakIntoLines produces, e.g. for checking whether the text fits in
+// some number of lines. The extents and the flags of the lines are not computed.
+uint32_t countLines(const U16StringPiece& textBuffer, BreakStrategy strategy,
+                    HyphenationFrequency frequency, bool justified,
+                    const MeasuredText& measuredText, const LineWidth& lineWidth,
+                    const TabStops& tabStops);
+
+// Breaks a paragraph into lines with an optimal strategy, consuming the text in windows instead of
+// measuring and breaking the whole paragraph at once. A line is committed once no break candidate
+// after it can change it, and the candidates before it are discarded, so the memory usage is
+// bounded by a few lines plus the window size rather than the paragraph length.
+//
+// Each window is measured on its own and must end at a word break, e.g. after the spaces
+// following a word, so that the words and their hyphenation are the same as in the whole
+// paragraph. The windows must not contain tab characters. The line penalty is the maximum over the
+// runs fed so far instead of the whole paragraph, so the lines may differ from breakIntoLines if
+// the later runs have a larger text size.
+class StreamingLineBreaker {
+public:
+    // The lineWidth must outlive this object. The strategy must not be BreakStrategy::Greedy.
+    StreamingLineBreaker(const LineWidth& lineWidth, BreakStrategy strategy,
+                         HyphenationFrequency frequency, bool justified);
+    ~StreamingLineBreaker();
+
+    // Appends the next window of the paragraph. The measured text is for the window only and is
+    // not referred after this call. This commits the lines that the window can no longer change.
+    void feed(const U16StringPiece& window, const MeasuredText& measuredText);
+
+    // Commits the remaining lines. Call this once after the last window. The breaker can then be
+    // fed the next paragraph.
+    void finish();
+
+    // Returns the lines committed since the last call in the line order. The break points are the
+    // offsets in the whole paragraph.
+    std::vector<LineRecord> takeLines();
+
+    // Returns the size of the retained break candidates and lines in bytes.
+    size_t getMemoryUsage() const;
+
+private:
+    struct State;
+    std::unique_ptr<State> mState;
+
+    MINIKIN_PREVENT_COPY_AND_ASSIGN(StreamingLineBreaker);
+};
+
+// A paragraph to be broken by breakParagraphsIntoLines. The referred objects must outlive the call.
+struct LineBreakParagraph {
+    U16StringPiece text;
+    const MeasuredText* measuredText;
+    const LineWidth* lineWidth;
+    const TabStops* tabStops;
+};
+
+// Breaks each paragraph into lines as breakIntoLines does, using up to threadCount threads
+// including the calling thread. If threadCount is 0, the number of hardware threads is used.
+// Fewer threads are used for short texts, which are broken on the calling thread only, since
+// starting a thread costs more than breaking them. Each call starts its own threads and joins them
+// before returning, i.e. no thread is kept across the calls. The results are returned in the same
+// order as the paragraphs.
+std::vector<LineBreakResult> breakParagraphsIntoLines(
+        const std::vector<LineBreakParagraph>& paragraphs, BreakStrategy strategy,
+        HyphenationFrequency frequency, bool justified, uint32_t threadCount);
+
 }  // namespace minikin
 
 #endif  // MINIKIN_LINE_BREAKER_H
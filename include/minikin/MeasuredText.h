@@ -24,12 +24,57 @@
 #include "minikin/Layout.h"
 #include "minikin/LayoutPieces.h"
 #include "minikin/Macros.h"
+#include "minikin/MinikinExtent.h"
 #include "minikin/MinikinFont.h"
 #include "minikin/Range.h"
 #include "minikin/U16StringPiece.h"
 
 namespace minikin {
 
+// The vertical extents of the layout pieces, e.g. words, in the text.
+//
+// The pieces are recorded while measuring the text. Then the union of the extents of consecutive
+// pieces can be retrieved in O(log n) from a segment tree, without looking up the layout of each
+// piece again.
+class PieceExtents {
+public:
+    // Records the extent of the piece. The pieces can be added in any order but must not overlap.
+    void add(const Range& range, const MinikinExtent& extent) {
+        if (!range.isEmpty()) {
+            mPendingPieces.emplace_back(range, extent);
+        }
+    }
+
+    // Builds the segment tree from the added pieces. The table is available only if the pieces
+    // cover the whole text without gaps.
+    void build(uint32_t textLength);
+
+    bool isAvailable() const { return !mTree.empty(); }
+
+    // Returns the index of the piece containing the offset. The table must be available and the
+    // offset must be inside the text.
+    uint32_t findPiece(uint32_t offset) const;
+
+    // Returns the range of the piece at the index.
+    Range getRange(uint32_t index) const { return Range(mStarts[index], mStarts[index + 1]); }
+
+    // Returns the union of the extents of the pieces in [from, to).
+    MinikinExtent getExtent(uint32_t from, uint32_t to) const;
+
+    uint32_t getMemoryUsage() const {
+        return sizeof(uint32_t) * mStarts.size() + sizeof(MinikinExtent) * mTree.size();
+    }
+
+private:
+    std::vector<std::pair<Range, MinikinExtent>> mPendingPieces;
+
+    // The start offsets of the pieces, followed by the text length.
+    std::vector<uint32_t> mStarts;
+
+    // The bottom-up segment tree. The leaves are stored at [size, 2 * size) for size pieces.
+    std::vector<MinikinExtent> mTree;
+};
+
 class Run {
 public:
     Run(const Range& range) : mRange(range) {}
@@ -48,6 +93,14 @@ public:
     virtual void getMetrics(const U16StringPiece& text, std::vector<float>* advances,
                             LayoutPieces* precomputed, LayoutPieces* outPieces) const = 0;
 
+    // Same as getMetrics, and also adds the extents of the pieces to outExtents. The default
+    // implementation adds nothing, which is still supported but makes the extent queries slower.
+    virtual void getMetricsWithExtents(const U16StringPiece& text, std::vector<float>* advances,
+                                       LayoutPieces* precomputed, LayoutPieces* outPieces,
+                                       PieceExtents* /* outExtents */) const {
+        getMetrics(text, advances, precomputed, outPieces);
+    }
+
     virtual std::pair<float, MinikinRect> getBounds(const U16StringPiece& text, const Range& range,
                                                     const LayoutPieces& pieces) const = 0;
     virtual MinikinExtent getExtent(const U16StringPiece& text, const Range& range,
@@ -75,6 +128,14 @@ public:
         return 0.0;
     }
 
+    // Measures the pieces of the context range split at the hyphenation point: the piece before
+    // the point with the end hyphen edit, and the piece after the point with the start hyphen
+    // edit. Returns the widths of the two pieces.
+    virtual std::pair<float, float> measureHyphenPieces(const U16StringPiece& text,
+                                                        const Range& contextRange,
+                                                        uint32_t offset, HyphenationType hyph,
+                                                        LayoutPieces* pieces) const;
+
     inline const Range& getRange() const { return mRange; }
 
 protected:
@@ -93,6 +154,10 @@ public:
     void getMetrics(const U16StringPiece& text, std::vector<float>* advances,
                     LayoutPieces* precomputed, LayoutPieces* outPieces) const override;
 
+    void getMetricsWithExtents(const U16StringPiece& text, std::vector<float>* advances,
+                               LayoutPieces* precomputed, LayoutPieces* outPieces,
+                               PieceExtents* outExtents) const override;
+
     std::pair<float, MinikinRect> getBounds(const U16StringPiece& text, const Range& range,
                                             const LayoutPieces& pieces) const override;
 
@@ -110,6 +175,12 @@ public:
                              StartHyphenEdit startHyphen, EndHyphenEdit endHyphen,
                              LayoutPieces* pieces) const override;
 
+    // Looks up the widths in HyphenPieceCache if the layout pieces are not needed.
+    std::pair<float, float> measureHyphenPieces(const U16StringPiece& text,
+                                                const Range& contextRange, uint32_t offset,
+                                                HyphenationType hyph,
+                                                LayoutPieces* pieces) const override;
+
 private:
     MinikinPaint mPaint;
     const bool mIsRtl;
@@ -130,6 +201,13 @@ public:
         // TODO: Get the extents information from the caller.
     }
 
+    void getMetricsWithExtents(const U16StringPiece& text, std::vector<float>* advances,
+                               LayoutPieces* precomputed, LayoutPieces* outPieces,
+                               PieceExtents* outExtents) const override {
+        getMetrics(text, advances, precomputed, outPieces);
+        outExtents->add(mRange, MinikinExtent());
+    }
+
     std::pair<float, MinikinRect> getBounds(const U16StringPiece& /* text */,
                                             const Range& /* range */,
                                             const LayoutPieces& /* pieces */) const override {
@@ -171,6 +249,22 @@ struct HyphenBreak {
             : offset(offset), type(type), first(first), second(second) {}
 };
 
+// Represents a word break point found by the word breaker while measuring the text.
+struct WordBreakPoint {
+    // The break offset.
+    uint32_t offset;
+
+    // The word preceding the break point, without the surrounding punctuation. Used for the
+    // hyphenation.
+    Range wordRange;
+
+    // The penalty of breaking here. Non zero inside email addresses and URLs.
+    int badness;
+
+    WordBreakPoint(uint32_t offset, const Range& wordRange, int badness)
+            : offset(offset), wordRange(wordRange), badness(badness) {}
+};
+
 class MeasuredText {
 public:
     // Character widths.
@@ -179,6 +273,10 @@ public:
     // Hyphenation points.
     std::vector<HyphenBreak> hyphenBreaks;
 
+    // Word break points in the order the line breakers visit them. Recorded while measuring, so
+    // the line breakers don't need to run the word breaker again.
+    std::vector<WordBreakPoint> wordBreaks;
+
     // The style information.
     std::vector<std::unique_ptr<Run>> runs;
 
@@ -186,9 +284,13 @@ public:
     // TODO: Stop assigning width/extents if layout pieces are available for reducing memory impact.
     LayoutPieces layoutPieces;
 
+    // The extents of the pieces for computing line extents.
+    PieceExtents pieceExtents;
+
     uint32_t getMemoryUsage() const {
         return sizeof(float) * widths.size() + sizeof(HyphenBreak) * hyphenBreaks.size() +
-               layoutPieces.getMemoryUsage();
+               sizeof(WordBreakPoint) * wordBreaks.size() + layoutPieces.getMemoryUsage() +
+               pieceExtents.getMemoryUsage();
     }
 
     Layout buildLayout(const U16StringPiece& textBuf, const Range& range, const Range& contextRange,
@@ -206,13 +308,17 @@ private:
     friend class MeasuredTextBuilder;
 
     void measure(const U16StringPiece& textBuf, bool computeHyphenation, bool computeLayout,
-                 MeasuredText* hint);
+                 bool approximateHyphenPieceWidths, MeasuredText* hint);
+
+    // Computes the extent of the range from the runs, without using pieceExtents.
+    MinikinExtent computeExtent(const U16StringPiece& textBuf, const Range& range) const;
 
     // Use MeasuredTextBuilder instead.
     MeasuredText(const U16StringPiece& textBuf, std::vector<std::unique_ptr<Run>>&& runs,
-                 bool computeHyphenation, bool computeLayout, MeasuredText* hint)
+                 bool computeHyphenation, bool computeLayout, bool approximateHyphenPieceWidths,
+                 MeasuredText* hint)
             : widths(textBuf.size()), runs(std::move(runs)) {
-        measure(textBuf, computeHyphenation, computeLayout, hint);
+        measure(textBuf, computeHyphenation, computeLayout, approximateHyphenPieceWidths, hint);
     }
 };
 
@@ -234,17 +340,29 @@ public:
         mRuns.emplace_back(std::make_unique<T>(std::forward<Args>(args)...));
     }
 
+    // If true, most of the hyphenation points are not measured. The widths of the pieces around
+    // the point are approximated by the character advances plus the advance of the hyphen, which
+    // is taken from the first point measured in each run. This ignores the kerning and ligatures
+    // across the point, so use this only for the fonts without them, or where a slightly off
+    // line width is acceptable. Only the left-to-right points which append a hyphen are
+    // approximated, and never when the full layout is computed.
+    void setApproximateHyphenPieceWidths(bool approximate) {
+        mApproximateHyphenPieceWidths = approximate;
+    }
+
     std::unique_ptr<MeasuredText> build(const U16StringPiece& textBuf, bool computeHyphenation,
                                         bool computeLayout, MeasuredText* hint) {
         // Unable to use make_unique here since make_unique is not a friend of MeasuredText.
-        return std::unique_ptr<MeasuredText>(new MeasuredText(
-                textBuf, std::move(mRuns), computeHyphenation, computeLayout, hint));
+        return std::unique_ptr<MeasuredText>(
+                new MeasuredText(textBuf, std::move(mRuns), computeHyphenation, computeLayout,
+                                 mApproximateHyphenPieceWidths, hint));
     }
 
     MINIKIN_PREVENT_COPY_ASSIGN_AND_MOVE(MeasuredTextBuilder);
 
 private:
     std::vector<std::unique_ptr<Run>> mRuns;
+    bool mApproximateHyphenPieceWidths = false;
 };
 
 }  // namespace minikin
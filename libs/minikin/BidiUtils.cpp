@@ -19,6 +19,7 @@
 #include "BidiUtils.h"
 
 #include <algorithm>
+#include <cstring>
 
 #include <unicode/ubidi.h>
 #include <unicode/utf16.h>
@@ -49,6 +50,79 @@ static inline UBiDiLevel bidiToUBidiLevel(Bidi bidi) {
     }
 }
 
+namespace {
+
+// All the code units below this value have the bidi class of L, EN, ES, ET, CS, NSM, BN, B, S, WS
+// or ON, and none of them is an explicit directional formatting character.
+constexpr uint16_t FIRST_BIDI_SENSITIVE_CHAR = 0x0590;  // The start of the Hebrew block.
+
+// Returns true if the code unit may be a character with the bidi class of R, AL or AN, or an
+// explicit directional formatting character. Unassigned code points in the RTL blocks are also
+// included since their default bidi class is R or AL.
+inline bool isBidiSensitive(uint16_t c) {
+    if (c < FIRST_BIDI_SENSITIVE_CHAR) {
+        return false;
+    }
+    return c <= 0x08FF                      // Hebrew .. Arabic Extended-A
+           || (0x200E <= c && c <= 0x200F)  // LRM, RLM
+           || (0x202A <= c && c <= 0x202E)  // LRE, RLE, PDF, LRO, RLO
+           || (0x2066 <= c && c <= 0x2069)  // LRI, RLI, FSI, PDI
+           || (0xD802 <= c && c <= 0xD803)  // High surrogates for U+10800 .. U+10FFF
+           || (0xD83A <= c && c <= 0xD83B)  // High surrogates for U+1E800 .. U+1EFFF
+           || (0xFB1D <= c && c <= 0xFDFF)  // Hebrew and Arabic presentation forms
+           || (0xFE70 <= c && c <= 0xFEFE);  // Arabic presentation forms-B
+}
+
+// Checks four code units at once. Returns true if any of the packed code units is greater than or
+// equal to FIRST_BIDI_SENSITIVE_CHAR.
+inline bool mayHaveBidiSensitiveChar(uint64_t fourChars) {
+    constexpr uint64_t kHighBits = 0x8000800080008000ULL;
+    constexpr uint64_t kLowBits = 0x7FFF7FFF7FFF7FFFULL;
+    constexpr uint64_t kThreshold = 0x8000 - FIRST_BIDI_SENSITIVE_CHAR;
+    constexpr uint64_t kThresholds =
+            kThreshold | (kThreshold << 16) | (kThreshold << 32) | (kThreshold << 48);
+    // Adding the threshold to the lower 15 bits never carries into the next lane, and sets the
+    // highest bit of the lane if the lane is greater than or equal to FIRST_BIDI_SENSITIVE_CHAR.
+    // The lanes which already have the highest bit are caught by or-ing the original value.
+    return (((fourChars & kLowBits) + kThresholds) | fourChars) & kHighBits;
+}
+
+}  // namespace
+
+bool isLtrOnlyText(const U16StringPiece& textBuf, Bidi bidiFlags) {
+    if (bidiFlags == Bidi::FORCE_LTR) {
+        return true;
+    }
+    if (bidiFlags != Bidi::LTR && bidiFlags != Bidi::DEFAULT_LTR) {
+        // With RTL paragraph direction, neutral characters at the edge of the text may be resolved
+        // to RTL even if the text doesn't have any RTL characters.
+        return false;
+    }
+    const uint16_t* chars = textBuf.data();
+    const size_t size = textBuf.size();
+    size_t i = 0;
+    // Most of the text is Latin only, so skip the blocks of four code units which are all below
+    // FIRST_BIDI_SENSITIVE_CHAR, and look into the each code unit only if needed.
+    for (; i + 4 <= size; i += 4) {
+        uint64_t fourChars;
+        memcpy(&fourChars, chars + i, sizeof(fourChars));
+        if (!mayHaveBidiSensitiveChar(fourChars)) {
+            continue;
+        }
+        for (size_t j = i; j < i + 4; ++j) {
+            if (isBidiSensitive(chars[j])) {
+                return false;
+            }
+        }
+    }
+    for (; i < size; ++i) {
+        if (isBidiSensitive(chars[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
 BidiText::RunInfo BidiText::getRunInfoAt(uint32_t runOffset) const {
     MINIKIN_ASSERT(runOffset < mRunCount, "Out of range access. %d/%d", runOffset, mRunCount);
     if (mRunCount == 1) {
@@ -78,6 +152,11 @@ BidiText::BidiText(const U16StringPiece& textBuf, const Range& range, Bidi bidiF
         // force single run.
         return;
     }
+    if (isLtrOnlyText(textBuf, bidiFlags)) {
+        // No need to run the bidi algorithm since the whole text is resolved to a single LTR run.
+        mIsRtl = false;
+        return;
+    }
 
     mBidi.reset(ubidi_open());
     if (!mBidi) {
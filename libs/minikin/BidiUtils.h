@@ -36,6 +36,13 @@ struct UBiDiDeleter {
 
 using UBiDiUniquePtr = std::unique_ptr<UBiDi, UBiDiDeleter>;
 
+// Returns true if the text is guaranteed to be resolved to a single LTR run with the given bidi
+// flags, without running the Unicode Bidirectional Algorithm. This is true if the paragraph
+// direction is LTR and the text doesn't have any RTL characters or explicit directional
+// formatting characters. This may return false even for some LTR only text, e.g. text with
+// unassigned code points in RTL blocks.
+bool isLtrOnlyText(const U16StringPiece& textBuf, Bidi bidiFlags);
+
 // A helper class for iterating the bidi run transitions.
 class BidiText {
 public:
@@ -43,13 +43,15 @@ const uint32_t TEXT_STYLE_VS = 0xFE0E;
 
 static std::atomic<uint32_t> gNextCollectionId = {0};
 
-FontCollection::FontCollection(std::shared_ptr<FontFamily>&& typeface) : mMaxChar(0) {
+FontCollection::FontCollection(std::shared_ptr<FontFamily>&& typeface)
+        : mMaxChar(0), mFamilyCacheHitCount(0), mFamilyCacheMissCount(0) {
     std::vector<std::shared_ptr<FontFamily>> typefaces;
     typefaces.push_back(typeface);
     init(typefaces);
 }
 
-FontCollection::FontCollection(const vector<std::shared_ptr<FontFamily>>& typefaces) : mMaxChar(0) {
+FontCollection::FontCollection(const vector<std::shared_ptr<FontFamily>>& typefaces)
+        : mMaxChar(0), mFamilyCacheHitCount(0), mFamilyCacheMissCount(0) {
     init(typefaces);
 }
 
@@ -101,6 +103,16 @@ void FontCollection::init(const vector<std::shared_ptr<FontFamily>>& typefaces)
     // See the comment in Range for more details.
     LOG_ALWAYS_FATAL_IF(mFamilyVec.size() >= 0xFFFF,
                         "Exceeded the maximum indexable cmap coverage.");
+
+    mFamilyCache.reset(new std::atomic<uint64_t>[kFamilyCacheSize]);
+    for (uint32_t i = 0; i < kFamilyCacheSize; ++i) {
+        mFamilyCache[i].store(0, std::memory_order_relaxed);
+    }
+    mLocaleMatchingScoreSlots.reset(
+            new std::atomic<const LocaleMatchingScores*>[kLocaleMatchingScoreSlotCount]);
+    for (uint32_t i = 0; i < kLocaleMatchingScoreSlotCount; ++i) {
+        mLocaleMatchingScoreSlots[i].store(nullptr, std::memory_order_relaxed);
+    }
 }
 
 // Special scores for the font fallback.
@@ -124,7 +136,7 @@ const uint32_t kFirstFontScore = UINT32_MAX;
 //  - kFirstFontScore: When the font is the first font family in the collection and it supports the
 //    given character or variation sequence.
 uint32_t FontCollection::calcFamilyScore(uint32_t ch, uint32_t vs, FamilyVariant variant,
-                                         uint32_t localeListId,
+                                         uint32_t localeListId, uint32_t localeScore,
                                          const std::shared_ptr<FontFamily>& fontFamily) const {
     const uint32_t coverageScore = calcCoverageScore(ch, vs, localeListId, fontFamily);
     if (coverageScore == kFirstFontScore || coverageScore == kUnsupportedFontScore) {
@@ -132,7 +144,6 @@ uint32_t FontCollection::calcFamilyScore(uint32_t ch, uint32_t vs, FamilyVariant
         return coverageScore;
     }
 
-    const uint32_t localeScore = calcLocaleMatchingScore(localeListId, *fontFamily);
     const uint32_t variantScore = calcVariantMatchingScore(variant, *fontFamily);
 
     // Subscores are encoded into 31 bits representation to meet the subscore priority.
@@ -225,6 +236,30 @@ uint32_t FontCollection::calcLocaleMatchingScore(uint32_t userLocaleListId,
     return score;
 }
 
+const uint32_t* FontCollection::getLocaleMatchingScores(uint32_t userLocaleListId) const {
+    // The locale list IDs are assigned sequentially, so the low bits are enough for the slot.
+    std::atomic<const LocaleMatchingScores*>& slot =
+            mLocaleMatchingScoreSlots[userLocaleListId & (kLocaleMatchingScoreSlotCount - 1)];
+    const LocaleMatchingScores* published = slot.load(std::memory_order_acquire);
+    if (published != nullptr && published->localeListId == userLocaleListId) {
+        return published->scores.data();
+    }
+
+    std::lock_guard<std::mutex> lock(mLocaleMatchingScoresMutex);
+    std::unique_ptr<LocaleMatchingScores>& entry = mLocaleMatchingScores[userLocaleListId];
+    if (entry == nullptr) {
+        entry.reset(new LocaleMatchingScores());
+        entry->localeListId = userLocaleListId;
+        entry->scores.resize(mFamilies.size());
+        for (size_t i = 0; i < mFamilies.size(); ++i) {
+            entry->scores[i] = calcLocaleMatchingScore(userLocaleListId, *mFamilies[i]);
+        }
+    }
+    // Replacing the other locale list in the slot is fine since its entry is still alive.
+    slot.store(entry.get(), std::memory_order_release);
+    return entry->scores.data();
+}
+
 // Calculates a font score based on variant ("compact" or "elegant") matching.
 //  - Returns 1 if the font doesn't have variant or the variant matches with the text style.
 //  - No score if the font has a variant but it doesn't match with the text style.
@@ -244,6 +279,36 @@ uint32_t FontCollection::calcVariantMatchingScore(FamilyVariant variant,
     return 0;
 }
 
+// The layout of the font family resolution cache entry.
+//   bits  0-20: code point
+//   bits 21-29: variation selector index + 1, or 0 if no variation selector.
+//   bits 30-31: family variant
+//   bits 32-55: locale list ID
+//   bits 56-63: family index + 1, or 0 if the entry is empty.
+constexpr uint32_t kFamilyCacheMaxLocaleListId = (1u << 24) - 1;
+constexpr uint64_t kFamilyCacheKeyMask = (1ull << 56) - 1;
+constexpr int kFamilyCacheValueShift = 56;
+
+// Packs the arguments of getFamilyForChar into the key part of the cache entry. Returns false if
+// the arguments can not be packed.
+static inline bool packFamilyCacheKey(uint32_t ch, uint32_t vs, uint32_t localeListId,
+                                      FamilyVariant variant, uint64_t* outKey) {
+    uint32_t vsKey = 0;
+    if (vs != 0) {
+        const uint16_t vsIndex = getVsIndex(vs);
+        if (vsIndex == INVALID_VS_INDEX) {
+            return false;
+        }
+        vsKey = vsIndex + 1;
+    }
+    if (localeListId > kFamilyCacheMaxLocaleListId) {
+        return false;
+    }
+    *outKey = static_cast<uint64_t>(ch) | (static_cast<uint64_t>(vsKey) << 21) |
+              (static_cast<uint64_t>(variant) << 30) | (static_cast<uint64_t>(localeListId) << 32);
+    return true;
+}
+
 // Implement heuristic for choosing best-match font. Here are the rules:
 // 1. If first font in the collection has the character, it wins.
 // 2. Calculate a score for the font family. See comments in calcFamilyScore for the detail.
@@ -256,22 +321,48 @@ const std::shared_ptr<FontFamily>& FontCollection::getFamilyForChar(uint32_t ch,
         return mFamilies[0];
     }
 
+    uint64_t key;
+    if (!packFamilyCacheKey(ch, vs, localeListId, variant, &key)) {
+        return mFamilies[getFamilyIndexForChar(ch, vs, localeListId, variant)];
+    }
+    // Fibonacci hashing for picking up the slot.
+    const uint32_t slot = (key * 0x9E3779B97F4A7C15ull) >> (64 - kLogFamilyCacheSize);
+    const uint64_t entry = mFamilyCache[slot].load(std::memory_order_relaxed);
+    if ((entry & kFamilyCacheKeyMask) == key && (entry >> kFamilyCacheValueShift) != 0) {
+        mFamilyCacheHitCount.fetch_add(1, std::memory_order_relaxed);
+        return mFamilies[(entry >> kFamilyCacheValueShift) - 1];
+    }
+    mFamilyCacheMissCount.fetch_add(1, std::memory_order_relaxed);
+    const uint32_t familyIndex = getFamilyIndexForChar(ch, vs, localeListId, variant);
+    const uint64_t value = static_cast<uint64_t>(familyIndex + 1) << kFamilyCacheValueShift;
+    mFamilyCache[slot].store(key | value, std::memory_order_relaxed);
+    return mFamilies[familyIndex];
+}
+
+uint32_t FontCollection::getFamilyIndexForChar(uint32_t ch, uint32_t vs, uint32_t localeListId,
+                                               FamilyVariant variant) const {
+    if (ch >= mMaxChar) {
+        return 0;
+    }
+
     Range range = mRanges[ch >> kLogCharsPerPage];
 
     if (vs != 0) {
         range = {0, static_cast<uint16_t>(mFamilies.size())};
     }
 
+    const uint32_t* localeScores = getLocaleMatchingScores(localeListId);
     int bestFamilyIndex = -1;
     uint32_t bestScore = kUnsupportedFontScore;
     for (size_t i = range.start; i < range.end; i++) {
-        const std::shared_ptr<FontFamily>& family =
-                vs == 0 ? mFamilies[mFamilyVec[i]] : mFamilies[i];
-        const uint32_t score = calcFamilyScore(ch, vs, variant, localeListId, family);
+        const uint32_t familyIndex = vs == 0 ? mFamilyVec[i] : i;
+        const std::shared_ptr<FontFamily>& family = mFamilies[familyIndex];
+        const uint32_t score = calcFamilyScore(ch, vs, variant, localeListId,
+                                               localeScores[familyIndex], family);
         if (score == kFirstFontScore) {
             // If the first font family supports the given character or variation sequence, always
             // use it.
-            return family;
+            return familyIndex;
         }
         if (score > bestScore) {
             bestScore = score;
@@ -287,12 +378,12 @@ const std::shared_ptr<FontFamily>& FontCollection::getFamilyForChar(uint32_t ch,
             if (U_SUCCESS(errorCode) && len > 0) {
                 int off = 0;
                 U16_NEXT_UNSAFE(decomposed, off, ch);
-                return getFamilyForChar(ch, vs, localeListId, variant);
+                return getFamilyIndexForChar(ch, vs, localeListId, variant);
             }
         }
-        return mFamilies[0];
+        return 0;
     }
-    return vs == 0 ? mFamilies[mFamilyVec[bestFamilyIndex]] : mFamilies[bestFamilyIndex];
+    return vs == 0 ? mFamilyVec[bestFamilyIndex] : bestFamilyIndex;
 }
 
 // Characters where we want to continue using existing font run for (or stick to the next run if
@@ -16,6 +16,12 @@
 
 #define LOG_TAG "GreedyLineBreak"
 
+#include "GreedyLineBreaker.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
 #include "minikin/Characters.h"
 #include "minikin/LineBreaker.h"
 #include "minikin/MeasuredText.h"
@@ -26,7 +32,6 @@
 #include "LineBreakerUtil.h"
 #include "Locale.h"
 #include "LocaleListCache.h"
-#include "WordBreaker.h"
 
 namespace minikin {
 
@@ -40,17 +45,23 @@ public:
     // destructed.
     GreedyLineBreaker(const U16StringPiece& textBuf, const MeasuredText& measured,
                       const LineWidth& lineWidthLimits, const TabStops& tabStops,
-                      bool enableHyphenation)
+                      bool enableHyphenation, uint32_t maxLines, bool computeLineInfo)
             : mLineWidthLimit(lineWidthLimits.getAt(0)),
               mTextBuf(textBuf),
               mMeasuredText(measured),
               mLineWidthLimits(lineWidthLimits),
               mTabStops(tabStops),
-              mEnableHyphenation(enableHyphenation) {}
+              mEnableHyphenation(enableHyphenation),
+              mMaxLines(maxLines),
+              mComputeLineInfo(computeLineInfo) {}
 
     void process();
 
-    LineBreakResult getResult() const;
+    std::vector<LineRecord> getResult() const;
+
+    uint32_t getLineCount() const {
+        return std::min(static_cast<uint32_t>(mBreakPoints.size()), mMaxLines);
+    }
 
 private:
     struct BreakPoint {
@@ -78,7 +89,7 @@ private:
     void updateLineWidth(uint16_t c, float width);
 
     // Break line if current line exceeds the line limit.
-    void processLineBreak(uint32_t offset, WordBreaker* breaker, bool doHyphenation);
+    void processLineBreak(const WordBreakPoint& wordBreak, bool doHyphenation);
 
     // Try to break with previous word boundary.
     // Returns false if unable to break by word boundary.
@@ -89,7 +100,7 @@ private:
     //
     // This method keeps hyphenation until the line width after line break meets the line width
     // limit.
-    bool tryLineBreakWithHyphenation(const Range& range, WordBreaker* breaker);
+    bool tryLineBreakWithHyphenation(const Range& range, const Range& targetRange);
 
     // Do line break with each characters.
     //
@@ -115,12 +126,17 @@ private:
     // The hyphenator currently used.
     const Hyphenator* mHyphenator = nullptr;
 
+    // Buffers reused across words.
+    LineBreakScratch mScratch;
+
     // Input parameters.
     const U16StringPiece& mTextBuf;
     const MeasuredText& mMeasuredText;
     const LineWidth& mLineWidthLimits;
     const TabStops& mTabStops;
     bool mEnableHyphenation;
+    uint32_t mMaxLines;
+    bool mComputeLineInfo;
 
     // The result of line breaking.
     std::vector<BreakPoint> mBreakPoints;
@@ -160,7 +176,7 @@ bool GreedyLineBreaker::tryLineBreakWithWordBreak() {
     return true;
 }
 
-bool GreedyLineBreaker::tryLineBreakWithHyphenation(const Range& range, WordBreaker* breaker) {
+bool GreedyLineBreaker::tryLineBreakWithHyphenation(const Range& range, const Range& targetRange) {
     if (!mEnableHyphenation || mHyphenator == nullptr) {
         return false;
     }
@@ -176,13 +192,12 @@ bool GreedyLineBreaker::tryLineBreakWithHyphenation(const Range& range, WordBrea
         return false;  // The target range may lay on multiple run. Unable to hyphenate.
     }
 
-    const Range targetRange = breaker->wordRange();
     if (!range.contains(targetRange)) {
         return false;
     }
 
-    const std::vector<HyphenationType> hyphenResult =
-            hyphenate(mTextBuf.substr(targetRange), *mHyphenator);
+    const std::vector<HyphenationType>& hyphenResult = mScratch.hyphenation;
+    hyphenate(mTextBuf.substr(targetRange), *mHyphenator, &mScratch.hyphenation);
     Range contextRange = range;
     uint32_t prevOffset = NOWHERE;
     float prevWidth = 0;
@@ -294,13 +309,13 @@ void GreedyLineBreaker::updateLineWidth(uint16_t c, float width) {
     }
 }
 
-void GreedyLineBreaker::processLineBreak(uint32_t offset, WordBreaker* breaker,
-                                         bool doHyphenation) {
+void GreedyLineBreaker::processLineBreak(const WordBreakPoint& wordBreak, bool doHyphenation) {
+    const uint32_t offset = wordBreak.offset;
     while (mLineWidth > mLineWidthLimit) {
         const Range lineRange(getPrevLineBreakOffset(), offset);  // The range we need to address.
         if (tryLineBreakWithWordBreak()) {
             continue;  // The word in the new line may still be too long for the line limit.
-        } else if (doHyphenation && tryLineBreakWithHyphenation(lineRange, breaker)) {
+        } else if (doHyphenation && tryLineBreakWithHyphenation(lineRange, wordBreak.wordRange)) {
             continue;  // TODO: we may be able to return here.
         } else {
             if (doLineBreakWithGraphemeBounds(lineRange)) {
@@ -310,7 +325,7 @@ void GreedyLineBreaker::processLineBreak(uint32_t offset, WordBreaker* breaker,
     }
 
     // There is still spaces, remember current word break point as a candidate and wait next word.
-    const bool isInEmailOrUrl = breaker->breakBadness() != 0;
+    const bool isInEmailOrUrl = wordBreak.badness != 0;
     if (mPrevWordBoundsOffset == NOWHERE || mIsPrevWordBreakIsInEmailOrUrl | !isInEmailOrUrl) {
         mPrevWordBoundsOffset = offset;
         mLineWidthAtPrevWordBoundary = mLineWidth;
@@ -320,33 +335,43 @@ void GreedyLineBreaker::processLineBreak(uint32_t offset, WordBreaker* breaker,
 }
 
 void GreedyLineBreaker::process() {
-    WordBreaker wordBreaker;
-    wordBreaker.setText(mTextBuf.data(), mTextBuf.size());
+    // Reserve the break points for the estimated line count, assuming that the lines are as wide as
+    // the first line.
+    if (mLineWidthLimit > 0) {
+        const double totalWidth = std::accumulate(mMeasuredText.widths.begin(),
+                                                  mMeasuredText.widths.end(), 0.0);
+        const double lineCount = std::min(totalWidth / mLineWidthLimit, double(mTextBuf.size()));
+        mBreakPoints.reserve(std::min(lineCount, double(mMaxLines)) + 1);
+    }
+
+    // The word break points are recorded while measuring the text.
+    const std::vector<WordBreakPoint>& wordBreaks = mMeasuredText.wordBreaks;
+    auto nextWordBreak = wordBreaks.begin();
 
-    // Following two will be initialized after the first iteration.
+    // Will be initialized after the first iteration.
     uint32_t localeListId = LocaleListCache::kInvalidListId;
-    uint32_t nextWordBoundaryOffset = 0;
     for (const auto& run : mMeasuredText.runs) {
         const Range range = run->getRange();
 
         // Update locale if necessary.
         uint32_t newLocaleListId = run->getLocaleListId();
         if (localeListId != newLocaleListId) {
-            Locale locale = getEffectiveLocale(newLocaleListId);
-            nextWordBoundaryOffset = wordBreaker.followingWithLocale(locale, range.getStart());
-            mHyphenator = HyphenatorMap::lookup(locale);
+            mHyphenator = HyphenatorMap::lookup(getEffectiveLocale(newLocaleListId));
             localeListId = newLocaleListId;
         }
 
         for (uint32_t i = range.getStart(); i < range.getEnd(); ++i) {
             updateLineWidth(mTextBuf[i], mMeasuredText.widths[i]);
 
-            if ((i + 1) == nextWordBoundaryOffset) {
+            if (nextWordBreak != wordBreaks.end() && (i + 1) == nextWordBreak->offset) {
                 // Only process line break at word boundary and the run can break into some pieces.
-                if (run->canBreak() || nextWordBoundaryOffset == range.getEnd()) {
-                    processLineBreak(i + 1, &wordBreaker, run->canBreak());
+                if (run->canBreak() || nextWordBreak->offset == range.getEnd()) {
+                    processLineBreak(*nextWordBreak, run->canBreak());
+                    if (mBreakPoints.size() >= mMaxLines) {
+                        return;  // The following lines are not needed.
+                    }
                 }
-                nextWordBoundaryOffset = wordBreaker.next();
+                ++nextWordBreak;
             }
         }
     }
@@ -358,12 +383,20 @@ void GreedyLineBreaker::process() {
     }
 }
 
-LineBreakResult GreedyLineBreaker::getResult() const {
+std::vector<LineRecord> GreedyLineBreaker::getResult() const {
     constexpr int TAB_BIT = 1 << 29;  // Must be the same in StaticLayout.java
 
-    LineBreakResult out;
+    const uint32_t lineCount = getLineCount();
+    std::vector<LineRecord> out;
+    out.reserve(lineCount);
     uint32_t prevBreakOffset = 0;
-    for (const auto& breakPoint : mBreakPoints) {
+    for (uint32_t lineIndex = 0; lineIndex < lineCount; ++lineIndex) {
+        const BreakPoint& breakPoint = mBreakPoints[lineIndex];
+        if (!mComputeLineInfo) {
+            out.emplace_back(breakPoint.offset, breakPoint.lineWidth, 0.0f, 0.0f, 0);
+            continue;
+        }
+
         // TODO: compute these during line breaking if these takes longer time.
         bool hasTabChar = false;
         for (uint32_t i = prevBreakOffset; i < breakPoint.offset; ++i) {
@@ -372,11 +405,8 @@ LineBreakResult GreedyLineBreaker::getResult() const {
 
         MinikinExtent extent =
                 mMeasuredText.getExtent(mTextBuf, Range(prevBreakOffset, breakPoint.offset));
-        out.breakPoints.push_back(breakPoint.offset);
-        out.widths.push_back(breakPoint.lineWidth);
-        out.ascents.push_back(extent.ascent);
-        out.descents.push_back(extent.descent);
-        out.flags.push_back((hasTabChar ? TAB_BIT : 0) | static_cast<int>(breakPoint.hyphenEdit));
+        out.emplace_back(breakPoint.offset, breakPoint.lineWidth, extent.ascent, extent.descent,
+                         (hasTabChar ? TAB_BIT : 0) | static_cast<int>(breakPoint.hyphenEdit));
 
         prevBreakOffset = breakPoint.offset;
     }
@@ -385,15 +415,39 @@ LineBreakResult GreedyLineBreaker::getResult() const {
 
 }  // namespace
 
-LineBreakResult breakLineGreedy(const U16StringPiece& textBuf, const MeasuredText& measured,
-                                const LineWidth& lineWidthLimits, const TabStops& tabStops,
-                                bool enableHyphenation) {
-    if (textBuf.size() == 0) {
-        return LineBreakResult();
+std::vector<LineRecord> breakLineGreedy(const U16StringPiece& textBuf,
+                                        const MeasuredText& measured,
+                                        const LineWidth& lineWidthLimits, const TabStops& tabStops,
+                                        bool enableHyphenation) {
+    return breakLineGreedy(textBuf, measured, lineWidthLimits, tabStops, enableHyphenation,
+                           std::numeric_limits<uint32_t>::max(), true /* compute line info */);
+}
+
+std::vector<LineRecord> breakLineGreedy(const U16StringPiece& textBuf,
+                                        const MeasuredText& measured,
+                                        const LineWidth& lineWidthLimits, const TabStops& tabStops,
+                                        bool enableHyphenation, uint32_t maxLines,
+                                        bool computeLineInfo) {
+    if (textBuf.size() == 0 || maxLines == 0) {
+        return std::vector<LineRecord>();
     }
-    GreedyLineBreaker lineBreaker(textBuf, measured, lineWidthLimits, tabStops, enableHyphenation);
+    GreedyLineBreaker lineBreaker(textBuf, measured, lineWidthLimits, tabStops, enableHyphenation,
+                                  maxLines, computeLineInfo);
     lineBreaker.process();
     return lineBreaker.getResult();
 }
 
+uint32_t countLinesGreedy(const U16StringPiece& textBuf, const MeasuredText& measured,
+                          const LineWidth& lineWidthLimits, const TabStops& tabStops,
+                          bool enableHyphenation) {
+    if (textBuf.size() == 0) {
+        return 0;
+    }
+    GreedyLineBreaker lineBreaker(textBuf, measured, lineWidthLimits, tabStops, enableHyphenation,
+                                  std::numeric_limits<uint32_t>::max(),
+                                  false /* compute line info */);
+    lineBreaker.process();
+    return lineBreaker.getLineCount();
+}
+
 }  // namespace minikin
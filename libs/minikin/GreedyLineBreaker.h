@@ -25,9 +25,23 @@
 
 namespace minikin {
 
-LineBreakResult breakLineGreedy(const U16StringPiece& textBuf, const MeasuredText& measured,
-                                const LineWidth& lineWidthLimits, const TabStops& tabStops,
-                                bool enableHyphenation);
+std::vector<LineRecord> breakLineGreedy(const U16StringPiece& textBuf,
+                                        const MeasuredText& measured,
+                                        const LineWidth& lineWidthLimits, const TabStops& tabStops,
+                                        bool enableHyphenation);
+
+// Same as above, but produces the first maxLines lines only. If computeLineInfo is false, the
+// extents and the flags of the lines are not computed and left zero.
+std::vector<LineRecord> breakLineGreedy(const U16StringPiece& textBuf,
+                                        const MeasuredText& measured,
+                                        const LineWidth& lineWidthLimits, const TabStops& tabStops,
+                                        bool enableHyphenation, uint32_t maxLines,
+                                        bool computeLineInfo);
+
+// Returns the number of lines breakLineGreedy produces, without building the lines.
+uint32_t countLinesGreedy(const U16StringPiece& textBuf, const MeasuredText& measured,
+                          const LineWidth& lineWidthLimits, const TabStops& tabStops,
+                          bool enableHyphenation);
 
 }  // namespace minikin
 
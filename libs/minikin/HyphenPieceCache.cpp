@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "Minikin"
+
+#include "HyphenPieceCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace minikin {
+
+HyphenPieceCache::HyphenPieceCache(uint32_t maxEntries)
+        : mCache(maxEntries), mRequestCount(0), mCacheHitCount(0) {
+    mCache.setOnEntryRemovedListener(this);
+}
+
+bool HyphenPieceCache::get(const U16StringPiece& word, uint32_t offset, HyphenationType type,
+                           const MinikinPaint& paint, bool isRtl, HyphenPieceWidths* out) {
+    HyphenPieceCacheKey key(word, offset, type, paint, isRtl);
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRequestCount++;
+    const HyphenPieceWidths* widths = mCache.get(key);
+    if (widths == nullptr) {
+        return false;
+    }
+    mCacheHitCount++;
+    *out = *widths;
+    return true;
+}
+
+void HyphenPieceCache::put(const U16StringPiece& word, uint32_t offset, HyphenationType type,
+                           const MinikinPaint& paint, bool isRtl,
+                           const HyphenPieceWidths& widths) {
+    HyphenPieceCacheKey key(word, offset, type, paint, isRtl);
+    std::unique_ptr<HyphenPieceWidths> copied(new HyphenPieceWidths(widths));
+    key.copyText();
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mCache.put(key, copied.get())) {
+        copied.release();
+    } else {
+        // The same point has been measured in the other thread.
+        key.freeText();
+    }
+}
+
+void HyphenPieceCache::clear() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mCache.clear();
+}
+
+uint32_t HyphenPieceCache::getCacheSize() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mCache.size();
+}
+
+void HyphenPieceCache::dumpStats(int fd) {
+    char buffer[256];
+    int length;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        const float ratio = (mRequestCount == 0) ? 0 : mCacheHitCount / (float)mRequestCount;
+        length = snprintf(buffer, sizeof(buffer),
+                          "\nHyphen Piece Cache Info:\n  Usage: %zu/%zu entries\n"
+                          "  Hit ratio: %u/%u (%f)\n",
+                          mCache.size(), kMaxEntries, mCacheHitCount, mRequestCount, ratio);
+    }
+    if (length <= 0) {
+        return;
+    }
+    const size_t size = std::min(static_cast<size_t>(length), sizeof(buffer) - 1);
+#ifdef _WIN32
+    _write(fd, buffer, size);
+#else
+    if (write(fd, buffer, size) < 0) {
+        // Nothing to do for the failure of dumping stats.
+    }
+#endif
+}
+
+void HyphenPieceCache::operator()(HyphenPieceCacheKey& key, HyphenPieceWidths*& value) {
+    key.freeText();
+    delete value;
+}
+
+}  // namespace minikin
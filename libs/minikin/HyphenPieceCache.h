@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MINIKIN_HYPHEN_PIECE_CACHE_H
+#define MINIKIN_HYPHEN_PIECE_CACHE_H
+
+#include <cstring>
+#include <mutex>
+
+#include <utils/LruCache.h>
+
+#include "minikin/FontCollection.h"
+#include "minikin/Hasher.h"
+#include "minikin/Hyphenator.h"
+#include "minikin/Macros.h"
+#include "minikin/MinikinPaint.h"
+#include "minikin/U16StringPiece.h"
+
+namespace minikin {
+
+class HyphenPieceCacheKey {
+public:
+    HyphenPieceCacheKey(const U16StringPiece& word, uint32_t offset, HyphenationType type,
+                        const MinikinPaint& paint, bool isRtl)
+            : mChars(word.data()),
+              mNchars(word.size()),
+              mOffset(offset),
+              mId(paint.font->getId()),
+              mStyle(paint.fontStyle),
+              mSize(paint.size),
+              mScaleX(paint.scaleX),
+              mSkewX(paint.skewX),
+              mLetterSpacing(paint.letterSpacing),
+              mWordSpacing(paint.wordSpacing),
+              mFontFlags(paint.fontFlags),
+              mLocaleListId(paint.localeListId),
+              mFamilyVariant(paint.familyVariant),
+              mType(type),
+              mIsRtl(isRtl),
+              mHash(computeHash()) {}
+
+    bool operator==(const HyphenPieceCacheKey& o) const {
+        return mId == o.mId && mOffset == o.mOffset && mStyle == o.mStyle && mSize == o.mSize &&
+               mScaleX == o.mScaleX && mSkewX == o.mSkewX && mLetterSpacing == o.mLetterSpacing &&
+               mWordSpacing == o.mWordSpacing && mFontFlags == o.mFontFlags &&
+               mLocaleListId == o.mLocaleListId && mFamilyVariant == o.mFamilyVariant &&
+               mType == o.mType && mIsRtl == o.mIsRtl && mNchars == o.mNchars &&
+               !memcmp(mChars, o.mChars, mNchars * sizeof(uint16_t));
+    }
+
+    android::hash_t hash() const { return mHash; }
+
+    void copyText() {
+        uint16_t* charsCopy = new uint16_t[mNchars];
+        memcpy(charsCopy, mChars, mNchars * sizeof(uint16_t));
+        mChars = charsCopy;
+    }
+    void freeText() {
+        delete[] mChars;
+        mChars = nullptr;
+    }
+
+private:
+    const uint16_t* mChars;
+    size_t mNchars;
+    uint32_t mOffset;
+    uint32_t mId;  // for the font collection
+    FontStyle mStyle;
+    float mSize;
+    float mScaleX;
+    float mSkewX;
+    float mLetterSpacing;
+    float mWordSpacing;
+    int32_t mFontFlags;
+    uint32_t mLocaleListId;
+    FamilyVariant mFamilyVariant;
+    HyphenationType mType;
+    bool mIsRtl;
+    // Note: any fields added to MinikinPaint must also be reflected here.
+    android::hash_t mHash;
+
+    android::hash_t computeHash() const {
+        return Hasher()
+                .update(mId)
+                .update(mOffset)
+                .update(mStyle.identifier())
+                .update(mSize)
+                .update(mScaleX)
+                .update(mSkewX)
+                .update(mLetterSpacing)
+                .update(mWordSpacing)
+                .update(mFontFlags)
+                .update(mLocaleListId)
+                .update(static_cast<uint8_t>(mFamilyVariant))
+                .update(static_cast<uint8_t>(mType))
+                .update(mIsRtl)
+                .updateShorts(mChars, mNchars)
+                .hash();
+    }
+};
+
+// The widths of the pieces around a hyphenation point.
+struct HyphenPieceWidths {
+    // The width of the piece before the point, with the end hyphen edit.
+    float first;
+
+    // The width of the piece after the point, with the start hyphen edit.
+    float second;
+};
+
+// A cache of the hyphen piece widths by the word, the paint, the break offset in the word and the
+// hyphenation type.
+//
+// Each hyphenation point is measured as two pieces, each going through the bidi, the layout
+// splitter and the layout cache, and the pieces with the hyphen edits are rarely in the layout
+// cache. The same words are hyphenated again and again, so this keeps both widths of a point.
+class HyphenPieceCache : private android::OnEntryRemoved<HyphenPieceCacheKey, HyphenPieceWidths*> {
+public:
+    static HyphenPieceCache& getInstance() {
+        static HyphenPieceCache cache(kMaxEntries);
+        return cache;
+    }
+
+    // Returns true and fills the out if the widths of the point are in the cache.
+    bool get(const U16StringPiece& word, uint32_t offset, HyphenationType type,
+             const MinikinPaint& paint, bool isRtl, HyphenPieceWidths* out);
+
+    void put(const U16StringPiece& word, uint32_t offset, HyphenationType type,
+             const MinikinPaint& paint, bool isRtl, const HyphenPieceWidths& widths);
+
+    // Returns true if the widths of the points in the word with the paint can be cached.
+    static bool canCache(const U16StringPiece& word, const MinikinPaint& paint) {
+        return word.size() <= kLengthLimit && !paint.skipCache();
+    }
+
+    void clear();
+
+    void dumpStats(int fd);
+
+    // Words longer than this are measured without cache.
+    static const uint32_t kLengthLimit = 128;
+
+protected:
+    explicit HyphenPieceCache(uint32_t maxEntries);
+
+    uint32_t getCacheSize();
+
+private:
+    // callback for OnEntryRemoved
+    void operator()(HyphenPieceCacheKey& key, HyphenPieceWidths*& value);
+
+    android::LruCache<HyphenPieceCacheKey, HyphenPieceWidths*> mCache GUARDED_BY(mMutex);
+
+    uint32_t mRequestCount GUARDED_BY(mMutex);
+    uint32_t mCacheHitCount GUARDED_BY(mMutex);
+
+    static const size_t kMaxEntries = 5000;
+
+    std::mutex mMutex;
+
+    MINIKIN_PREVENT_COPY_AND_ASSIGN(HyphenPieceCache);
+};
+
+inline android::hash_t hash_type(const HyphenPieceCacheKey& key) {
+    return key.hash();
+}
+
+}  // namespace minikin
+
+#endif  // MINIKIN_HYPHEN_PIECE_CACHE_H
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "Minikin"
+
+#include "HyphenationCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace minikin {
+
+HyphenationCache::HyphenationCache(uint32_t maxEntries)
+        : mCache(maxEntries), mRequestCount(0), mCacheHitCount(0) {
+    mCache.setOnEntryRemovedListener(this);
+}
+
+void HyphenationCache::hyphenate(const Hyphenator& hyphenator, const U16StringPiece& word,
+                                 HyphenationType* out) {
+    if (word.size() > kLengthLimit) {
+        hyphenator.hyphenate(word, out);
+        return;
+    }
+    HyphenationCacheKey key(&hyphenator, word);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRequestCount++;
+        const HyphenationType* result = mCache.get(key);
+        if (result != nullptr) {
+            mCacheHitCount++;
+            std::copy(result, result + word.size(), out);
+            return;
+        }
+    }
+    // Releases the mutex during hyphenation as the other threads may hyphenate the other words.
+    hyphenator.hyphenate(word, out);
+    std::unique_ptr<HyphenationType[]> copied(new HyphenationType[word.size()]);
+    std::copy(out, out + word.size(), copied.get());
+    key.copyText();
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mCache.put(key, copied.get())) {
+            copied.release();
+        } else {
+            // The same word has been hyphenated in the other thread.
+            key.freeText();
+        }
+    }
+}
+
+void HyphenationCache::hyphenate(const Hyphenator& hyphenator, const U16StringPiece& text,
+                                 const std::vector<Range>& words, HyphenationType* out) {
+    std::vector<Range> missedWords;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const Range& word : words) {
+            if (word.getLength() > kLengthLimit) {
+                missedWords.push_back(word);
+                continue;
+            }
+            mRequestCount++;
+            const HyphenationType* result =
+                    mCache.get(HyphenationCacheKey(&hyphenator, text.substr(word)));
+            if (result == nullptr) {
+                missedWords.push_back(word);
+                continue;
+            }
+            mCacheHitCount++;
+            std::copy(result, result + word.getLength(), out + word.getStart());
+        }
+    }
+    if (missedWords.empty()) {
+        return;
+    }
+    // Releases the mutex during hyphenation as the other threads may hyphenate the other words.
+    hyphenator.hyphenate(text, missedWords, out);
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (const Range& word : missedWords) {
+        if (word.getLength() > kLengthLimit) {
+            continue;
+        }
+        HyphenationCacheKey key(&hyphenator, text.substr(word));
+        std::unique_ptr<HyphenationType[]> copied(new HyphenationType[word.getLength()]);
+        std::copy(out + word.getStart(), out + word.getEnd(), copied.get());
+        key.copyText();
+        if (mCache.put(key, copied.get())) {
+            copied.release();
+        } else {
+            // The same word has been hyphenated in the other thread, or earlier in the text.
+            key.freeText();
+        }
+    }
+}
+
+void HyphenationCache::clear() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mCache.clear();
+}
+
+uint32_t HyphenationCache::getCacheSize() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mCache.size();
+}
+
+void HyphenationCache::dumpStats(int fd) {
+    char buffer[256];
+    int length;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        const float ratio = (mRequestCount == 0) ? 0 : mCacheHitCount / (float)mRequestCount;
+        length = snprintf(buffer, sizeof(buffer),
+                          "\nHyphenation Cache Info:\n  Usage: %zu/%zu entries\n"
+                          "  Hit ratio: %u/%u (%f)\n",
+                          mCache.size(), kMaxEntries, mCacheHitCount, mRequestCount, ratio);
+    }
+    if (length <= 0) {
+        return;
+    }
+    const size_t size = std::min(static_cast<size_t>(length), sizeof(buffer) - 1);
+#ifdef _WIN32
+    _write(fd, buffer, size);
+#else
+    if (write(fd, buffer, size) < 0) {
+        // Nothing to do for the failure of dumping stats.
+    }
+#endif
+}
+
+void HyphenationCache::operator()(HyphenationCacheKey& key, HyphenationType*& value) {
+    key.freeText();
+    delete[] value;
+}
+
+}  // namespace minikin
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MINIKIN_HYPHENATION_CACHE_H
+#define MINIKIN_HYPHENATION_CACHE_H
+
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include <utils/LruCache.h>
+
+#include "minikin/Hasher.h"
+#include "minikin/Hyphenator.h"
+#include "minikin/Macros.h"
+#include "minikin/Range.h"
+#include "minikin/U16StringPiece.h"
+
+namespace minikin {
+
+class HyphenationCacheKey {
+public:
+    HyphenationCacheKey(const Hyphenator* hyphenator, const U16StringPiece& word)
+            : mChars(word.data()),
+              mNchars(word.size()),
+              mHyphenator(hyphenator),
+              mHash(computeHash()) {}
+
+    bool operator==(const HyphenationCacheKey& o) const {
+        return mHyphenator == o.mHyphenator && mNchars == o.mNchars &&
+               !memcmp(mChars, o.mChars, mNchars * sizeof(uint16_t));
+    }
+
+    android::hash_t hash() const { return mHash; }
+
+    void copyText() {
+        uint16_t* charsCopy = new uint16_t[mNchars];
+        memcpy(charsCopy, mChars, mNchars * sizeof(uint16_t));
+        mChars = charsCopy;
+    }
+    void freeText() {
+        delete[] mChars;
+        mChars = nullptr;
+    }
+
+private:
+    const uint16_t* mChars;
+    size_t mNchars;
+    const Hyphenator* mHyphenator;
+    android::hash_t mHash;
+
+    android::hash_t computeHash() const {
+        const uint64_t hyphenator = reinterpret_cast<uintptr_t>(mHyphenator);
+        return Hasher()
+                .update(static_cast<uint32_t>(hyphenator))
+                .update(static_cast<uint32_t>(hyphenator >> 32))
+                .updateShorts(mChars, mNchars)
+                .hash();
+    }
+};
+
+// A cache of the Hyphenator::hyphenate results by the hyphenator and the word.
+//
+// The words of a natural language text are repeated a lot, and the same paragraphs are measured
+// again and again, so most of the words are hyphenated only once. The hyphenators are never
+// released in Android, so the cache is keyed by the hyphenator pointer.
+class HyphenationCache : private android::OnEntryRemoved<HyphenationCacheKey, HyphenationType*> {
+public:
+    static HyphenationCache& getInstance() {
+        static HyphenationCache cache(kMaxEntries);
+        return cache;
+    }
+
+    // Same as hyphenator.hyphenate(word, out). The out must have the length of the word.
+    void hyphenate(const Hyphenator& hyphenator, const U16StringPiece& word, HyphenationType* out);
+
+    // Same as hyphenator.hyphenate(text, words, out). The words are looked up and stored with a
+    // single lock each, and the missed words are hyphenated by a single call.
+    void hyphenate(const Hyphenator& hyphenator, const U16StringPiece& text,
+                   const std::vector<Range>& words, HyphenationType* out);
+
+    void clear();
+
+    void dumpStats(int fd);
+
+    // Words longer than this are hyphenated without cache. Same as LONGEST_HYPHENATED_WORD in
+    // LineBreakerUtil.cpp, so that every word which can be hyphenated can be cached.
+    static const uint32_t kLengthLimit = 128;
+
+protected:
+    explicit HyphenationCache(uint32_t maxEntries);
+
+    uint32_t getCacheSize();
+
+private:
+    // callback for OnEntryRemoved
+    void operator()(HyphenationCacheKey& key, HyphenationType*& value);
+
+    // The hyphenation of a word is stored as an array of the word length.
+    android::LruCache<HyphenationCacheKey, HyphenationType*> mCache GUARDED_BY(mMutex);
+
+    uint32_t mRequestCount GUARDED_BY(mMutex);
+    uint32_t mCacheHitCount GUARDED_BY(mMutex);
+
+    static const size_t kMaxEntries = 10000;
+
+    std::mutex mMutex;
+
+    MINIKIN_PREVENT_COPY_AND_ASSIGN(HyphenationCache);
+};
+
+inline android::hash_t hash_type(const HyphenationCacheKey& key) {
+    return key.hash();
+}
+
+}  // namespace minikin
+
+#endif  // MINIKIN_HYPHENATION_CACHE_H
@@ -14,13 +14,17 @@
  * limitations under the License.
  */
 
+#define LOG_TAG "Minikin"
+
 #include "minikin/Hyphenator.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include <log/log.h>
 #include <unicode/uchar.h>
 #include <unicode/uscript.h>
 
@@ -96,6 +100,172 @@ struct Header {
     }
 };
 
+static constexpr uint32_t HYB_MAGIC = 0x62ad7968;
+
+// Returns true if the table of the given size at the offset is within the file.
+static bool isTableInFile(uint32_t offset, uint64_t tableSize, uint32_t fileSize) {
+    return offset % 4 == 0 && offset <= fileSize && tableSize <= fileSize - offset;
+}
+
+// Returns true if the data is a well-formed hyb file of at most size bytes, i.e. none of the
+// lookups of Hyphenator and CompiledPatterns reads out of the data whatever the words are.
+static bool isValidPatternData(const uint8_t* data, size_t size) {
+    if (reinterpret_cast<uintptr_t>(data) % 4 != 0 || size < sizeof(Header)) {
+        return false;
+    }
+    const Header* header = reinterpret_cast<const Header*>(data);
+    if (header->magic != HYB_MAGIC || header->version != 0 || header->file_size > size ||
+        header->file_size < sizeof(Header)) {
+        return false;
+    }
+    const uint32_t fileSize = header->file_size;
+
+    // The alphabet values are the codes read at trie nodes, so the trie must have room for the
+    // largest one after every node.
+    uint32_t maxCode = 0;
+    if (!isTableInFile(header->alphabet_offset, sizeof(uint32_t), fileSize)) {
+        return false;
+    }
+    const uint32_t alphabetVersion = header->alphabetVersion();
+    if (alphabetVersion == 0) {
+        const AlphabetTable0* alphabet = header->alphabetTable0();
+        if (!isTableInFile(header->alphabet_offset, offsetof(AlphabetTable0, data), fileSize) ||
+            alphabet->max_codepoint < alphabet->min_codepoint ||
+            !isTableInFile(header->alphabet_offset,
+                           offsetof(AlphabetTable0, data) +
+                                   static_cast<uint64_t>(alphabet->max_codepoint -
+                                                         alphabet->min_codepoint),
+                           fileSize)) {
+            return false;
+        }
+        const uint32_t codeCount = alphabet->max_codepoint - alphabet->min_codepoint;
+        for (uint32_t i = 0; i < codeCount; i++) {
+            maxCode = std::max<uint32_t>(maxCode, alphabet->data[i]);
+        }
+    } else if (alphabetVersion == 1) {
+        const AlphabetTable1* alphabet = header->alphabetTable1();
+        if (!isTableInFile(header->alphabet_offset, offsetof(AlphabetTable1, data), fileSize) ||
+            !isTableInFile(header->alphabet_offset,
+                           offsetof(AlphabetTable1, data) +
+                                   static_cast<uint64_t>(alphabet->n_entries) * sizeof(uint32_t),
+                           fileSize)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < alphabet->n_entries; i++) {
+            maxCode = std::max(maxCode, AlphabetTable1::value(alphabet->data[i]));
+        }
+    } else {
+        return false;
+    }
+
+    const Trie* trie = header->trieTable();
+    if (!isTableInFile(header->trie_offset, offsetof(Trie, data), fileSize) ||
+        !isTableInFile(header->trie_offset,
+                       offsetof(Trie, data) +
+                               static_cast<uint64_t>(trie->n_entries) * sizeof(uint32_t),
+                       fileSize) ||
+        trie->link_shift >= 32 || trie->pattern_shift >= 32 || maxCode >= trie->n_entries) {
+        return false;
+    }
+
+    const Pattern* pattern = header->patternTable();
+    if (!isTableInFile(header->pattern_offset, offsetof(Pattern, data), fileSize) ||
+        !isTableInFile(header->pattern_offset,
+                       offsetof(Pattern, data) +
+                               static_cast<uint64_t>(pattern->n_entries) * sizeof(uint32_t),
+                       fileSize) ||
+        pattern->pattern_offset > fileSize - header->pattern_offset ||
+        pattern->pattern_size > fileSize - header->pattern_offset - pattern->pattern_offset) {
+        return false;
+    }
+    for (uint32_t i = 0; i < pattern->n_entries; i++) {
+        const uint32_t entry = pattern->data[i];
+        if ((entry & 0xfffff) + Pattern::len(entry) > pattern->pattern_size) {
+            return false;
+        }
+    }
+
+    // Any entry may be read as an edge, and then the link is a node.
+    for (uint32_t i = 0; i < trie->n_entries; i++) {
+        const uint32_t entry = trie->data[i];
+        const uint32_t link = (entry & trie->link_mask) >> trie->link_shift;
+        const uint32_t patternIndex = entry >> trie->pattern_shift;
+        if (static_cast<uint64_t>(link) + maxCode >= trie->n_entries ||
+            (patternIndex != 0 && patternIndex >= pattern->n_entries)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The compiled form of the patterns. See Hyphenator::loadCompiled.
+struct Hyphenator::CompiledPatterns {
+    // A node of the Aho-Corasick automaton, for a prefix of the patterns. The node 0 is the root.
+    struct Node {
+        // The range of the node's outgoing edges in the edges array.
+        uint32_t edgeBegin;
+        uint32_t edgeEnd;
+        // The node for the longest proper suffix of the node's string.
+        uint32_t failure;
+        // The values of all the patterns matching at the node, i.e. of the node's string and its
+        // suffixes, combined with point-wise max. Same as a pattern table entry, the valuesLen
+        // values followed by valuesShift zeros end at the end of the match.
+        uint32_t valuesOffset;
+        uint8_t valuesLen;
+        uint8_t valuesShift;
+    };
+
+    struct Edge {
+        uint16_t code;
+        uint32_t target;
+    };
+
+    // Each alphabet entry is (the hyphenation type based on the script << 11) | the code, or 0
+    // if the character is not in the alphabet. The entries are stored in pages of 256 code units.
+    // The pages without any character in the alphabet refer to the page 0, which is empty.
+    static const uint32_t CODE_BITS = 11;
+    static const uint16_t CODE_MASK = (1 << CODE_BITS) - 1;
+    uint16_t pageIndex[256];
+    std::vector<uint16_t> pages;
+
+    // The limit of the nodes, about ten times as many as the largest patterns expand to. A
+    // malformed trie, e.g. with a cycle, may expand without end, so it is left uncompiled.
+    static const uint32_t MAX_NODES = 1 << 20;
+
+    // The limit of the dense transitions, which is 256KB.
+    static const uint32_t MAX_DENSE_TRANSITIONS = 1 << 16;
+    // The full transitions of the first denseNodeCount nodes, i.e. the nodes near the root, indexed
+    // by node * alphabetSize + code. The failure links of the other nodes end up in these nodes.
+    uint32_t alphabetSize;
+    uint32_t denseNodeCount;
+    std::vector<uint32_t> denseTransitions;
+    std::vector<Node> nodes;
+    std::vector<Edge> edges;
+    std::vector<uint8_t> values;
+
+    // Returns nullptr if the trie expands to more than MAX_NODES nodes.
+    static std::unique_ptr<CompiledPatterns> build(const Header* header);
+
+    // Same as Hyphenator::alphabetLookup.
+    HyphenationType alphabetLookup(uint16_t* alpha_codes, const U16StringPiece& word) const;
+
+    // Returns the node after reading the code at the node.
+    uint32_t next(uint32_t node, uint16_t code) const {
+        while (node >= denseNodeCount) {
+            for (uint32_t i = nodes[node].edgeBegin; i < nodes[node].edgeEnd; i++) {
+                if (edges[i].code == code) {
+                    return edges[i].target;
+                }
+            }
+            node = nodes[node].failure;
+        }
+        return denseTransitions[node * alphabetSize + code];
+    }
+
+private:
+    void addToAlphabet(uint16_t c, uint16_t code);
+};
+
 // static
 Hyphenator* Hyphenator::loadBinary(const uint8_t* patternData, size_t minPrefix, size_t minSuffix,
                                    const std::string& locale) {
@@ -110,6 +280,37 @@ Hyphenator* Hyphenator::loadBinary(const uint8_t* patternData, size_t minPrefix,
     return new Hyphenator(patternData, minPrefix, minSuffix, hyphenLocale);
 }
 
+// static
+Hyphenator* Hyphenator::loadBinary(const uint8_t* patternData, size_t patternSize,
+                                   size_t minPrefix, size_t minSuffix, const std::string& locale) {
+    if (!isValidPatternData(patternData, patternSize)) {
+        ALOGE("Malformed hyphenation pattern data for %s", locale.c_str());
+        return nullptr;
+    }
+    return loadBinary(patternData, minPrefix, minSuffix, locale);
+}
+
+// static
+Hyphenator* Hyphenator::loadCompiled(const uint8_t* patternData, size_t minPrefix,
+                                     size_t minSuffix, const std::string& locale) {
+    Hyphenator* hyphenator = loadBinary(patternData, minPrefix, minSuffix, locale);
+    if (patternData != nullptr) {
+        hyphenator->mCompiled = CompiledPatterns::build(hyphenator->getHeader());
+    }
+    return hyphenator;
+}
+
+// static
+Hyphenator* Hyphenator::loadCompiled(const uint8_t* patternData, size_t patternSize,
+                                     size_t minPrefix, size_t minSuffix,
+                                     const std::string& locale) {
+    if (!isValidPatternData(patternData, patternSize)) {
+        ALOGE("Malformed hyphenation pattern data for %s", locale.c_str());
+        return nullptr;
+    }
+    return loadCompiled(patternData, minPrefix, minSuffix, locale);
+}
+
 Hyphenator::Hyphenator(const uint8_t* patternData, size_t minPrefix, size_t minSuffix,
                        HyphenationLocale hyphenLocale)
         : mPatternData(patternData),
@@ -117,14 +318,40 @@ Hyphenator::Hyphenator(const uint8_t* patternData, size_t minPrefix, size_t minS
           mMinSuffix(minSuffix),
           mHyphenationLocale(hyphenLocale) {}
 
+Hyphenator::~Hyphenator() {}
+
 void Hyphenator::hyphenate(const U16StringPiece& word, HyphenationType* out) const {
+    uint16_t alpha_codes[MAX_HYPHENATED_SIZE];
+    hyphenateWord(word, alpha_codes, out);
+}
+
+void Hyphenator::hyphenate(const U16StringPiece& text, const std::vector<Range>& words,
+                           HyphenationType* out) const {
+    uint16_t alpha_codes[MAX_HYPHENATED_SIZE];
+    for (const Range& word : words) {
+        hyphenateWord(text.substr(word), alpha_codes, out + word.getStart());
+    }
+}
+
+void Hyphenator::hyphenateWord(const U16StringPiece& word, uint16_t* alpha_codes,
+                               HyphenationType* out) const {
     const size_t len = word.size();
     const size_t paddedLen = len + 2;  // start and stop code each count for 1
-    if (mPatternData != nullptr && len >= mMinPrefix + mMinSuffix &&
-        paddedLen <= MAX_HYPHENATED_SIZE) {
-        uint16_t alpha_codes[MAX_HYPHENATED_SIZE];
-        const HyphenationType hyphenValue = alphabetLookup(alpha_codes, word);
+    if (mPatternData != nullptr && len >= mMinPrefix + mMinSuffix) {
+        // The words longer than the stack buffer, e.g. compound words and chemical names, take a
+        // heap buffer instead.
+        std::unique_ptr<uint16_t[]> heapCodes;
+        if (paddedLen > MAX_HYPHENATED_SIZE) {
+            heapCodes.reset(new uint16_t[paddedLen]);
+            alpha_codes = heapCodes.get();
+        }
+        const HyphenationType hyphenValue = mCompiled != nullptr
+                                                    ? mCompiled->alphabetLookup(alpha_codes, word)
+                                                    : alphabetLookup(alpha_codes, word);
         if (hyphenValue != HyphenationType::DONT_BREAK) {
+            // The pattern matching accumulates the hyphenation numbers in the out, so start from 0
+            // rather than from whatever the caller's buffer holds.
+            std::fill(out, out + len, HyphenationType::DONT_BREAK);
             hyphenateFromCodes(alpha_codes, paddedLen, hyphenValue, out);
             return;
         }
@@ -244,6 +471,165 @@ static inline HyphenationType getHyphTypeForArabic(const U16StringPiece& word, s
     return HyphenationType::BREAK_AND_INSERT_HYPHEN;
 }
 
+HyphenationType Hyphenator::CompiledPatterns::alphabetLookup(uint16_t* alpha_codes,
+                                                             const U16StringPiece& word) const {
+    HyphenationType result = HyphenationType::BREAK_AND_INSERT_HYPHEN;
+    alpha_codes[0] = 0;  // word start
+    for (size_t i = 0; i < word.size(); i++) {
+        const uint16_t c = word[i];
+        const uint16_t entry = pages[pageIndex[c >> 8] * 256 + (c & 0xff)];
+        if (entry == 0) {
+            return HyphenationType::DONT_BREAK;
+        }
+        if (result == HyphenationType::BREAK_AND_INSERT_HYPHEN) {
+            result = static_cast<HyphenationType>(entry >> CODE_BITS);
+        }
+        alpha_codes[i + 1] = entry & CODE_MASK;
+    }
+    alpha_codes[word.size() + 1] = 0;  // word termination
+    return result;
+}
+
+void Hyphenator::CompiledPatterns::addToAlphabet(uint16_t c, uint16_t code) {
+    uint16_t& page = pageIndex[c >> 8];
+    if (page == 0) {
+        page = pages.size() / 256;
+        pages.resize(pages.size() + 256, 0);
+    }
+    pages[page * 256 + (c & 0xff)] =
+            (static_cast<uint16_t>(hyphenationTypeBasedOnScript(c)) << CODE_BITS) | code;
+}
+
+// static
+std::unique_ptr<Hyphenator::CompiledPatterns> Hyphenator::CompiledPatterns::build(
+        const Header* header) {
+    static_assert(static_cast<uint16_t>(HyphenationType::BREAK_AND_DONT_INSERT_HYPHEN) <
+                          (1 << (16 - CODE_BITS)),
+                  "The hyphenation type must fit in the alphabet entry.");
+    std::unique_ptr<CompiledPatterns> compiled(new CompiledPatterns());
+    std::fill(std::begin(compiled->pageIndex), std::end(compiled->pageIndex), 0);
+    compiled->pages.resize(256, 0);
+    uint32_t alphabetSize = 1;  // The code 0 is for the word start and end.
+    const uint32_t alphabetVersion = header->alphabetVersion();
+    if (alphabetVersion == 0) {
+        const AlphabetTable0* alphabet = header->alphabetTable0();
+        for (uint32_t c = alphabet->min_codepoint; c < alphabet->max_codepoint && c <= 0xFFFF;
+             c++) {
+            const uint8_t code = alphabet->data[c - alphabet->min_codepoint];
+            if (code != 0) {
+                compiled->addToAlphabet(c, code);
+                alphabetSize = std::max(alphabetSize, code + 1u);
+            }
+        }
+    } else if (alphabetVersion == 1) {
+        const AlphabetTable1* alphabet = header->alphabetTable1();
+        for (uint32_t i = 0; i < alphabet->n_entries; i++) {
+            const uint32_t c = AlphabetTable1::codepoint(alphabet->data[i]);
+            const uint32_t code = AlphabetTable1::value(alphabet->data[i]);
+            if (c <= 0xFFFF && code != 0) {
+                compiled->addToAlphabet(c, code);
+                alphabetSize = std::max(alphabetSize, code + 1);
+            }
+        }
+    }
+
+    // Expand the suffix compressed trie into a tree in the breadth first order, so that the
+    // failure of a node always precedes the node.
+    const Trie* trie = header->trieTable();
+    std::vector<Node>& nodes = compiled->nodes;
+    std::vector<Edge>& edges = compiled->edges;
+    std::vector<uint32_t> trieNodes = {0};  // The trie node of each tree node.
+    std::vector<uint32_t> patternIndices = {0};
+    nodes.push_back(Node());
+    for (uint32_t n = 0; n < nodes.size(); n++) {
+        const uint32_t trieNode = trieNodes[n];
+        nodes[n].edgeBegin = edges.size();
+        for (uint32_t c = 0; c < alphabetSize && trieNode + c < trie->n_entries; c++) {
+            const uint32_t entry = trie->data[trieNode + c];
+            const uint32_t child = (entry & trie->link_mask) >> trie->link_shift;
+            // An empty slot reads as an edge for the code 0 to the root, which is not an edge.
+            if ((entry & trie->char_mask) != c || child == 0 || child >= trie->n_entries) {
+                continue;
+            }
+            if (nodes.size() >= MAX_NODES) {
+                return nullptr;
+            }
+            edges.push_back({static_cast<uint16_t>(c), static_cast<uint32_t>(nodes.size())});
+            nodes.push_back(Node());
+            trieNodes.push_back(child);
+            patternIndices.push_back(trie->data[child] >> trie->pattern_shift);
+        }
+        nodes[n].edgeEnd = edges.size();
+    }
+
+    // Start with the root only in the dense transitions, which is all the failure links need.
+    // Every node precedes its children, so the transitions of a node come from the ones of its
+    // failure, which has been filled.
+    compiled->alphabetSize = alphabetSize;
+    compiled->denseNodeCount = 1;
+    std::vector<uint32_t>& denseTransitions = compiled->denseTransitions;
+    denseTransitions.resize(alphabetSize, 0);
+    for (uint32_t i = nodes[0].edgeBegin; i < nodes[0].edgeEnd; i++) {
+        denseTransitions[edges[i].code] = edges[i].target;
+    }
+    for (uint32_t n = 0; n < nodes.size(); n++) {
+        for (uint32_t i = nodes[n].edgeBegin; i < nodes[n].edgeEnd; i++) {
+            Node& child = nodes[edges[i].target];
+            child.failure = n == 0 ? 0 : compiled->next(nodes[n].failure, edges[i].code);
+        }
+    }
+    const uint32_t denseNodeCount = std::max<uint32_t>(
+            1, std::min<size_t>(nodes.size(), MAX_DENSE_TRANSITIONS / alphabetSize));
+    denseTransitions.resize(denseNodeCount * alphabetSize);
+    for (uint32_t n = 1; n < denseNodeCount; n++) {
+        uint32_t* transitions = &denseTransitions[n * alphabetSize];
+        std::copy_n(&denseTransitions[nodes[n].failure * alphabetSize], alphabetSize, transitions);
+        for (uint32_t i = nodes[n].edgeBegin; i < nodes[n].edgeEnd; i++) {
+            transitions[edges[i].code] = edges[i].target;
+        }
+    }
+    compiled->denseNodeCount = denseNodeCount;
+
+    // Combine the values of the node's pattern into the values of the failure, which precedes the
+    // node and has the values of all the shorter suffixes.
+    const Pattern* pattern = header->patternTable();
+    std::vector<uint8_t>& values = compiled->values;
+    for (uint32_t n = 1; n < nodes.size(); n++) {
+        Node& node = nodes[n];
+        const Node& failure = nodes[node.failure];
+        if (patternIndices[n] == 0) {
+            node.valuesOffset = failure.valuesOffset;
+            node.valuesLen = failure.valuesLen;
+            node.valuesShift = failure.valuesShift;
+            continue;
+        }
+        const uint32_t entry = pattern->data[patternIndices[n]];
+        const uint32_t len = Pattern::len(entry);
+        const uint32_t shift = Pattern::shift(entry);
+        const uint32_t start =
+                std::max<uint32_t>(len + shift, failure.valuesLen + failure.valuesShift);
+        const uint32_t combinedShift = failure.valuesLen == 0
+                                               ? shift
+                                               : std::min<uint32_t>(shift, failure.valuesShift);
+        node.valuesOffset = values.size();
+        node.valuesLen = start - combinedShift;
+        node.valuesShift = combinedShift;
+        values.resize(values.size() + node.valuesLen, 0);
+        // Take the pointers after the resize, which may move the values.
+        uint8_t* combined = &values[node.valuesOffset];
+        const uint8_t* failureValues = &values[failure.valuesOffset];
+        for (uint32_t i = 0; i < failure.valuesLen; i++) {
+            combined[start - failure.valuesLen - failure.valuesShift + i] = failureValues[i];
+        }
+        const uint8_t* patternValues = pattern->buf(entry);
+        for (uint32_t i = 0; i < len; i++) {
+            uint8_t* value = &combined[start - len - shift + i];
+            *value = std::max(*value, patternValues[i]);
+        }
+    }
+    return compiled;
+}
+
 // Use various recommendations of UAX #14 Unicode Line Breaking Algorithm for hyphenating words
 // that didn't match patterns, especially words that contain hyphens or soft hyphens (See sections
 // 5.3, Use of Hyphen, and 5.4, Use of Soft Hyphen).
@@ -354,38 +740,55 @@ void Hyphenator::hyphenateFromCodes(const uint16_t* codes, size_t len, Hyphenati
     uint8_t* buffer = reinterpret_cast<uint8_t*>(out);
 
     const Header* header = getHeader();
-    const Trie* trie = header->trieTable();
     const Pattern* pattern = header->patternTable();
-    uint32_t char_mask = trie->char_mask;
-    uint32_t link_shift = trie->link_shift;
-    uint32_t link_mask = trie->link_mask;
-    uint32_t pattern_shift = trie->pattern_shift;
     size_t maxOffset = len - mMinSuffix - 1;
-    for (size_t i = 0; i < len - 1; i++) {
-        uint32_t node = 0;  // index into Trie table
-        for (size_t j = i; j < len; j++) {
-            uint16_t c = codes[j];
-            uint32_t entry = trie->data[node + c];
-            if ((entry & char_mask) == c) {
-                node = (entry & link_mask) >> link_shift;
-            } else {
-                break;
+    // The pattern has pat_len values followed by pat_shift zeros. This is the pattern for the
+    // substring ending at j we just matched, which we combine (via point-wise max) into the buffer
+    // vector.
+    auto applyPattern = [this, maxOffset, buffer](const uint8_t* pat_buf, int pat_len,
+                                                  int pat_shift, size_t j) {
+        int offset = j + 1 - (pat_len + pat_shift);
+        // offset is the index within buffer that lines up with the start of pat_buf
+        int start = std::max((int)mMinPrefix - offset, 0);
+        int end = std::min(pat_len, (int)maxOffset - offset);
+        for (int k = start; k < end; k++) {
+            buffer[offset + k] = std::max(buffer[offset + k], pat_buf[k]);
+        }
+    };
+    if (mCompiled != nullptr) {
+        // All the matches ending at j come out at once in a single pass over the codes.
+        uint32_t node = 0;
+        for (size_t j = 0; j < len; j++) {
+            node = mCompiled->next(node, codes[j]);
+            const CompiledPatterns::Node& matched = mCompiled->nodes[node];
+            if (matched.valuesLen != 0) {
+                applyPattern(&mCompiled->values[matched.valuesOffset], matched.valuesLen,
+                             matched.valuesShift, j);
             }
-            uint32_t pat_ix = trie->data[node] >> pattern_shift;
-            // pat_ix contains a 3-tuple of length, shift (number of trailing zeros), and an offset
-            // into the buf pool. This is the pattern for the substring (i..j) we just matched,
-            // which we combine (via point-wise max) into the buffer vector.
-            if (pat_ix != 0) {
-                uint32_t pat_entry = pattern->data[pat_ix];
-                int pat_len = Pattern::len(pat_entry);
-                int pat_shift = Pattern::shift(pat_entry);
-                const uint8_t* pat_buf = pattern->buf(pat_entry);
-                int offset = j + 1 - (pat_len + pat_shift);
-                // offset is the index within buffer that lines up with the start of pat_buf
-                int start = std::max((int)mMinPrefix - offset, 0);
-                int end = std::min(pat_len, (int)maxOffset - offset);
-                for (int k = start; k < end; k++) {
-                    buffer[offset + k] = std::max(buffer[offset + k], pat_buf[k]);
+        }
+    } else {
+        const Trie* trie = header->trieTable();
+        uint32_t char_mask = trie->char_mask;
+        uint32_t link_shift = trie->link_shift;
+        uint32_t link_mask = trie->link_mask;
+        uint32_t pattern_shift = trie->pattern_shift;
+        for (size_t i = 0; i < len - 1; i++) {
+            uint32_t node = 0;  // index into Trie table
+            for (size_t j = i; j < len; j++) {
+                uint16_t c = codes[j];
+                uint32_t entry = trie->data[node + c];
+                if ((entry & char_mask) == c) {
+                    node = (entry & link_mask) >> link_shift;
+                } else {
+                    break;
+                }
+                uint32_t pat_ix = trie->data[node] >> pattern_shift;
+                // pat_ix contains a 3-tuple of length, shift (number of trailing zeros), and an
+                // offset into the buf pool.
+                if (pat_ix != 0) {
+                    uint32_t pat_entry = pattern->data[pat_ix];
+                    applyPattern(pattern->buf(pat_entry), Pattern::len(pat_entry),
+                                 Pattern::shift(pat_entry), j);
                 }
             }
         }
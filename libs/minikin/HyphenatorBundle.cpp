@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "Minikin"
+
+#include "HyphenatorBundle.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+#ifdef _WIN32
+#include <memory>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <log/log.h>
+
+namespace minikin {
+
+namespace {
+
+constexpr uint32_t BUNDLE_MAGIC = 0x62ad7962;
+constexpr uint32_t HYB_MAGIC = 0x62ad7968;
+
+struct BundleHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t n_entries;
+    uint32_t n_aliases;
+    uint32_t string_offset;
+    uint32_t file_size;
+};
+
+struct BundleEntry {
+    uint32_t locale_offset;
+    uint32_t hyb_offset;
+    uint32_t hyb_size;
+    uint32_t min_prefix;
+    uint32_t min_suffix;
+};
+
+struct BundleAlias {
+    uint32_t from_offset;
+    uint32_t to_offset;
+};
+
+// The beginning of the hyb file header. See Hyphenator.cpp for the whole header.
+struct HybHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t alphabet_offset;
+    uint32_t trie_offset;
+    uint32_t pattern_offset;
+    uint32_t file_size;
+};
+
+// Reads the NUL-terminated string at the offset in the string pool. Returns false if the string
+// is not terminated in the pool.
+bool readString(const uint8_t* data, uint32_t stringOffset, uint32_t fileSize, uint32_t offset,
+                std::string* out) {
+    if (offset >= fileSize - stringOffset) {
+        return false;
+    }
+    const char* str = reinterpret_cast<const char*>(data + stringOffset + offset);
+    const void* end = memchr(str, '\0', fileSize - stringOffset - offset);
+    if (end == nullptr) {
+        return false;
+    }
+    out->assign(str, static_cast<const char*>(end));
+    return !out->empty();
+}
+
+// Maps the whole file without looking up the mapped files.
+const uint8_t* mapFileUncached(const std::string& path, size_t* size) {
+#ifdef _WIN32
+    // No mmap on Windows host, read the file into a buffer instead.
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (fp == nullptr) {
+        ALOGE("Failed to open %s", path.c_str());
+        return nullptr;
+    }
+    fseek(fp, 0, SEEK_END);
+    const long fileSize = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (fileSize <= 0) {
+        fclose(fp);
+        return nullptr;
+    }
+    std::unique_ptr<uint8_t[]> buffer(new uint8_t[fileSize]);
+    const size_t readSize = fread(buffer.get(), 1, fileSize, fp);
+    fclose(fp);
+    if (readSize != static_cast<size_t>(fileSize)) {
+        return nullptr;
+    }
+    *size = fileSize;
+    return buffer.release();
+#else
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        ALOGE("Failed to open %s", path.c_str());
+        return nullptr;
+    }
+    struct stat st = {};
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return nullptr;
+    }
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        ALOGE("Failed to mmap %s", path.c_str());
+        return nullptr;
+    }
+    *size = st.st_size;
+    return static_cast<const uint8_t*>(addr);
+#endif
+}
+
+}  // namespace
+
+// static
+bool HyphenatorBundle::isBundle(const uint8_t* data, size_t size) {
+    return size >= sizeof(BundleHeader) &&
+           reinterpret_cast<const BundleHeader*>(data)->magic == BUNDLE_MAGIC;
+}
+
+// static
+bool HyphenatorBundle::parse(const uint8_t* data, size_t size, HyphenatorBundle* out) {
+    if (data == nullptr || size < sizeof(BundleHeader)) {
+        return false;
+    }
+    // The headers and the hyb sections are read in place, so they must be aligned.
+    if (reinterpret_cast<uintptr_t>(data) % alignof(BundleHeader) != 0) {
+        return false;
+    }
+    const BundleHeader* header = reinterpret_cast<const BundleHeader*>(data);
+    if (header->magic != BUNDLE_MAGIC || header->version != 0 || header->file_size > size) {
+        return false;
+    }
+    const uint32_t fileSize = header->file_size;
+    const uint64_t tablesEnd = sizeof(BundleHeader) +
+                               static_cast<uint64_t>(header->n_entries) * sizeof(BundleEntry) +
+                               static_cast<uint64_t>(header->n_aliases) * sizeof(BundleAlias);
+    if (tablesEnd > header->string_offset || header->string_offset > fileSize) {
+        return false;
+    }
+    const uint32_t stringOffset = header->string_offset;
+
+    const BundleEntry* entries = reinterpret_cast<const BundleEntry*>(header + 1);
+    out->entries.resize(header->n_entries);
+    for (uint32_t i = 0; i < header->n_entries; ++i) {
+        const BundleEntry& entry = entries[i];
+        Entry* result = &out->entries[i];
+        if (!readString(data, stringOffset, fileSize, entry.locale_offset, &result->locale)) {
+            return false;
+        }
+        // Check the offset before subtracting it from the file size, so that it doesn't wrap.
+        if (entry.hyb_offset % 4 != 0 || entry.hyb_offset < stringOffset ||
+            entry.hyb_offset > fileSize || entry.hyb_size < sizeof(HybHeader) ||
+            entry.hyb_size > fileSize - entry.hyb_offset) {
+            return false;
+        }
+        const HybHeader* hyb = reinterpret_cast<const HybHeader*>(data + entry.hyb_offset);
+        if (hyb->magic != HYB_MAGIC || hyb->file_size > entry.hyb_size) {
+            return false;
+        }
+        result->patternData = data + entry.hyb_offset;
+        result->patternSize = entry.hyb_size;
+        result->minPrefix = entry.min_prefix;
+        result->minSuffix = entry.min_suffix;
+    }
+
+    const BundleAlias* aliases = reinterpret_cast<const BundleAlias*>(entries + header->n_entries);
+    out->aliases.resize(header->n_aliases);
+    for (uint32_t i = 0; i < header->n_aliases; ++i) {
+        Alias* result = &out->aliases[i];
+        if (!readString(data, stringOffset, fileSize, aliases[i].from_offset,
+                        &result->fromLocale) ||
+            !readString(data, stringOffset, fileSize, aliases[i].to_offset, &result->toLocale)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// static
+const uint8_t* HyphenatorBundle::mapFile(const std::string& path, size_t* size) {
+    static std::mutex mutex;
+    static std::map<std::string, std::pair<const uint8_t*, size_t>> mappedFiles;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = mappedFiles.find(path);
+    if (it != mappedFiles.end()) {
+        *size = it->second.second;
+        return it->second.first;
+    }
+    const uint8_t* data = mapFileUncached(path, size);
+    if (data != nullptr) {
+        mappedFiles[path] = std::make_pair(data, *size);
+    }
+    return data;
+}
+
+}  // namespace minikin
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MINIKIN_HYPHENATOR_BUNDLE_H
+#define MINIKIN_HYPHENATOR_BUNDLE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace minikin {
+
+// The contents of a hyphenation bundle file, which packs the hyb files of multiple locales into a
+// single file. See doc/hyb_file_format.md for the format.
+struct HyphenatorBundle {
+    struct Entry {
+        std::string locale;
+        // Points to the hyb file in the bundle data.
+        const uint8_t* patternData;
+        size_t patternSize;
+        uint32_t minPrefix;
+        uint32_t minSuffix;
+    };
+
+    struct Alias {
+        std::string fromLocale;
+        std::string toLocale;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<Alias> aliases;
+
+    // Returns true if the data starts with the bundle header rather than the hyb file header.
+    static bool isBundle(const uint8_t* data, size_t size);
+
+    // Parses the bundle data. The entries point into the data, so the data must outlive the
+    // hyphenators loaded from them. Returns false if the data is not a well-formed bundle or not
+    // 4-byte aligned.
+    static bool parse(const uint8_t* data, size_t size, HyphenatorBundle* out);
+
+    // Maps the whole file read-only and returns the address, or nullptr on failure. The mapping
+    // is never released since the hyphenators are never released. The same path is mapped only
+    // once, e.g. for the locales loaded from the same bundle.
+    static const uint8_t* mapFile(const std::string& path, size_t* size);
+};
+
+}  // namespace minikin
+
+#endif  // MINIKIN_HYPHENATOR_BUNDLE_H
@@ -16,6 +16,10 @@
 
 #include "HyphenatorMap.h"
 
+#include <algorithm>
+
+#include "HyphenationCache.h"
+#include "HyphenatorBundle.h"
 #include "LocaleListCache.h"
 #include "MinikinInternal.h"
 
@@ -31,7 +35,7 @@ constexpr int DEFAULT_MIN_PREFIX = 2;
 constexpr int DEFAULT_MAX_PREFIX = 2;
 }  // namespace
 
-// Following two function's implementations are here since Hyphenator.cpp can't include
+// Following functions' implementations are here since Hyphenator.cpp can't include
 // HyphenatorMap.h due to harfbuzz dependency on the host binary.
 void addHyphenator(const std::string& localeStr, const Hyphenator* hyphenator) {
     HyphenatorMap::add(localeStr, hyphenator);
@@ -41,88 +45,236 @@ void addHyphenatorAlias(const std::string& fromLocaleStr, const std::string& toL
     HyphenatorMap::addAlias(fromLocaleStr, toLocaleStr);
 }
 
+void addHyphenatorFromFile(const std::string& localeStr, const std::string& path,
+                           size_t minPrefix, size_t minSuffix, bool compile) {
+    HyphenatorMap::addFromFile(localeStr, path, minPrefix, minSuffix, compile);
+}
+
+bool addHyphenatorBundle(const std::string& path) {
+    size_t size = 0;
+    const uint8_t* data = HyphenatorBundle::mapFile(path, &size);
+    if (data == nullptr) {
+        return false;
+    }
+    return addHyphenatorBundle(data, size);
+}
+
+bool addHyphenatorBundle(const uint8_t* data, size_t size) {
+    HyphenatorBundle bundle;
+    if (!HyphenatorBundle::parse(data, size, &bundle)) {
+        ALOGE("Malformed hyphenation bundle.");
+        return false;
+    }
+    // The bundle may have been downloaded, so check all the entries before registering any.
+    std::vector<std::unique_ptr<Hyphenator>> hyphenators;
+    for (const HyphenatorBundle::Entry& entry : bundle.entries) {
+        hyphenators.emplace_back(Hyphenator::loadBinary(entry.patternData, entry.patternSize,
+                                                        entry.minPrefix, entry.minSuffix,
+                                                        entry.locale));
+        if (hyphenators.back() == nullptr) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < hyphenators.size(); ++i) {
+        HyphenatorMap::add(bundle.entries[i].locale, hyphenators[i].release());
+    }
+    // The aliases are registered after all the entries since they may refer to any of them.
+    for (const HyphenatorBundle::Alias& alias : bundle.aliases) {
+        HyphenatorMap::addAlias(alias.fromLocale, alias.toLocale);
+    }
+    return true;
+}
+
 HyphenatorMap::HyphenatorMap()
         : mSoftHyphenOnlyHyphenator(
-                  Hyphenator::loadBinary(nullptr, DEFAULT_MIN_PREFIX, DEFAULT_MAX_PREFIX, "")) {}
+                  Hyphenator::loadBinary(nullptr, DEFAULT_MIN_PREFIX, DEFAULT_MAX_PREFIX, "")) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSnapshots.emplace_back(new Snapshot());
+    mSnapshot.store(mSnapshots.back().get(), std::memory_order_release);
+    for (std::atomic<const FallbackEntry*>& slot : mFallbackSlots) {
+        slot.store(nullptr, std::memory_order_relaxed);
+    }
+}
 
 void HyphenatorMap::addInternal(const std::string& localeStr, const Hyphenator* hyphenator) {
     const Locale locale(localeStr);
     std::lock_guard<std::mutex> lock(mMutex);
-    // Overwrite even if there is already a fallback entry.
-    mMap[locale.getIdentifier()] = hyphenator;
+    putEntry(locale.getIdentifier(), {hyphenator, nullptr});
+}
+
+void HyphenatorMap::addFromFileInternal(const std::string& localeStr, const std::string& path,
+                                        size_t minPrefix, size_t minSuffix, bool compile) {
+    const Locale locale(localeStr);
+    std::unique_ptr<LazyHyphenator> lazyHyphenator(
+            new LazyHyphenator(localeStr, path, minPrefix, minSuffix, compile));
+    std::lock_guard<std::mutex> lock(mMutex);
+    putEntry(locale.getIdentifier(), {nullptr, lazyHyphenator.get()});
+    mLazyHyphenators.push_back(std::move(lazyHyphenator));
 }
 
 void HyphenatorMap::clearInternal() {
     std::lock_guard<std::mutex> lock(mMutex);
-    mMap.clear();
+    // This is test only, so no lookup is running in the other threads.
+    mSnapshots.clear();
+    mSnapshots.emplace_back(new Snapshot());
+    mSnapshot.store(mSnapshots.back().get(), std::memory_order_release);
+    for (std::atomic<const FallbackEntry*>& slot : mFallbackSlots) {
+        slot.store(nullptr, std::memory_order_relaxed);
+    }
+    mFallbackEntries.clear();
+    mReplacedFallbackEntries.clear();
+    mLazyHyphenators.clear();
+    // The removed hyphenators may be released, and the new ones may have the same addresses.
+    HyphenationCache::getInstance().clear();
 }
 void HyphenatorMap::addAliasInternal(const std::string& fromLocaleStr,
                                      const std::string& toLocaleStr) {
     const Locale fromLocale(fromLocaleStr);
     const Locale toLocale(toLocaleStr);
     std::lock_guard<std::mutex> lock(mMutex);
-    auto it = mMap.find(toLocale.getIdentifier());
-    if (it == mMap.end()) {
+    const Entry* target = mSnapshot.load(std::memory_order_relaxed)->find(toLocale.getIdentifier());
+    if (target == nullptr) {
         ALOGE("Target Hyphenator not found.");
         return;
     }
-    // Overwrite even if there is already a fallback entry.
-    mMap[fromLocale.getIdentifier()] = it->second;
+    putEntry(fromLocale.getIdentifier(), *target);
 }
 
 const Hyphenator* HyphenatorMap::lookupInternal(const Locale& locale) {
+    const Entry entry = lookupEntry(locale);
+    if (entry.lazyHyphenator != nullptr) {
+        // Loaded without holding the lock, so that the lookups of the other locales don't wait for
+        // the file.
+        return entry.lazyHyphenator->get(mSoftHyphenOnlyHyphenator);
+    }
+    return entry.hyphenator;
+}
+
+HyphenatorMap::Entry HyphenatorMap::lookupEntry(const Locale& locale) {
     const uint64_t id = locale.getIdentifier();
-    std::lock_guard<std::mutex> lock(mMutex);
-    const Hyphenator* result = lookupByIdentifier(id);
+    const Snapshot* snapshot = mSnapshot.load(std::memory_order_acquire);
+    const Entry* result = snapshot->find(id);
     if (result != nullptr) {
-        return result;  // Found with exact match.
+        return *result;  // Found with exact match.
+    }
+    std::atomic<const FallbackEntry*>& slot = mFallbackSlots[getFallbackSlotIndex(id)];
+    const FallbackEntry* cached = slot.load(std::memory_order_acquire);
+    if (cached != nullptr && cached->id == id && cached->snapshot == snapshot) {
+        return cached->entry;  // Fallen back by the previous lookup.
     }
 
     // First, try with dropping emoji extensions.
-    result = lookupBySubtag(locale, LANGUAGE | REGION | SCRIPT | VARIANT);
-    if (result != nullptr) {
-        goto insert_result_and_return;
+    result = snapshot->findBySubtag(locale, LANGUAGE | REGION | SCRIPT | VARIANT);
+    if (result == nullptr) {
+        // If not found, try with dropping script.
+        result = snapshot->findBySubtag(locale, LANGUAGE | REGION | VARIANT);
     }
-    // If not found, try with dropping script.
-    result = lookupBySubtag(locale, LANGUAGE | REGION | VARIANT);
-    if (result != nullptr) {
-        goto insert_result_and_return;
+    if (result == nullptr) {
+        // If not found, try with dropping script and region code.
+        result = snapshot->findBySubtag(locale, LANGUAGE | VARIANT);
     }
-    // If not found, try with dropping script and region code.
-    result = lookupBySubtag(locale, LANGUAGE | VARIANT);
-    if (result != nullptr) {
-        goto insert_result_and_return;
+    if (result == nullptr) {
+        // If not found, try only with language code.
+        result = snapshot->findBySubtag(locale, LANGUAGE);
     }
-    // If not found, try only with language code.
-    result = lookupBySubtag(locale, LANGUAGE);
-    if (result != nullptr) {
-        goto insert_result_and_return;
+    if (result == nullptr) {
+        // Still not found, try only with script.
+        result = snapshot->findBySubtag(locale, SCRIPT);
     }
-    // Still not found, try only with script.
-    result = lookupBySubtag(locale, SCRIPT);
-    if (result != nullptr) {
-        goto insert_result_and_return;
+    // If not found, use soft hyphen only hyphenator.
+    const Entry entry = result != nullptr ? *result : Entry{mSoftHyphenOnlyHyphenator, nullptr};
+
+    // Cache the result, so that the next lookup of the locale doesn't fall back again.
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (snapshot != mSnapshot.load(std::memory_order_relaxed)) {
+        return entry;  // Registered in the meantime. The next lookup caches the new result.
+    }
+    auto it = mFallbackEntries.find(id);
+    if (it == mFallbackEntries.end()) {
+        if (mFallbackEntries.size() >= kMaxFallbackEntryCount) {
+            return entry;  // Too many locales to cache.
+        }
+        it = mFallbackEntries.emplace(id, nullptr).first;
+    }
+    if (it->second == nullptr || it->second->snapshot != snapshot) {
+        if (it->second != nullptr) {
+            // Cached for a replaced snapshot. The other threads may still read it.
+            mReplacedFallbackEntries.push_back(std::move(it->second));
+        }
+        it->second.reset(new FallbackEntry{snapshot, id, entry});
     }
+    // Otherwise, the cached entry is reused after a colliding locale took the slot.
+    slot.store(it->second.get(), std::memory_order_release);
+    return entry;
+}
 
-    // If not found, use soft hyphen only hyphenator.
-    result = mSoftHyphenOnlyHyphenator;
+void HyphenatorMap::putEntry(uint64_t id, const Entry& entry) {
+    const Snapshot* current = mSnapshot.load(std::memory_order_relaxed);
+    auto it = current->lowerBound(id);
+    const bool exists = it != current->entries.end() && it->first == id;
+    std::unique_ptr<Snapshot> next(new Snapshot());
+    next->entries.reserve(current->entries.size() + 1);
+    next->entries.insert(next->entries.end(), current->entries.begin(), it);
+    next->entries.push_back(std::make_pair(id, entry));
+    next->entries.insert(next->entries.end(), exists ? it + 1 : it, current->entries.end());
+    mSnapshot.store(next.get(), std::memory_order_release);
+    mSnapshots.push_back(std::move(next));
+}
 
-insert_result_and_return:
-    mMap.insert(std::make_pair(id, result));
-    return result;
+HyphenatorMap::Snapshot::Iterator HyphenatorMap::Snapshot::lowerBound(uint64_t id) const {
+    return std::lower_bound(
+            entries.begin(), entries.end(), id,
+            [](const std::pair<uint64_t, Entry>& entry, uint64_t id) { return entry.first < id; });
 }
 
-const Hyphenator* HyphenatorMap::lookupByIdentifier(uint64_t id) const {
-    auto it = mMap.find(id);
-    return it == mMap.end() ? nullptr : it->second;
+const HyphenatorMap::Entry* HyphenatorMap::Snapshot::find(uint64_t id) const {
+    auto it = lowerBound(id);
+    return it != entries.end() && it->first == id ? &it->second : nullptr;
 }
 
-const Hyphenator* HyphenatorMap::lookupBySubtag(const Locale& locale, SubtagBits bits) const {
+const HyphenatorMap::Entry* HyphenatorMap::Snapshot::findBySubtag(const Locale& locale,
+                                                                  SubtagBits bits) const {
     const Locale partialLocale = locale.getPartialLocale(bits);
     if (!partialLocale.isSupported() || partialLocale == locale) {
         return nullptr;  // Skip the partial locale result in the same locale or not supported.
     }
-    return lookupByIdentifier(partialLocale.getIdentifier());
+    return find(partialLocale.getIdentifier());
+}
+
+const Hyphenator* HyphenatorMap::LazyHyphenator::get(const Hyphenator* fallback) {
+    std::call_once(mOnce, [this, fallback]() {
+        size_t size = 0;
+        const uint8_t* data = HyphenatorBundle::mapFile(mPath, &size);
+        if (data != nullptr && HyphenatorBundle::isBundle(data, size)) {
+            // Use the entry of the same locale in the bundle.
+            const uint8_t* bundleData = data;
+            data = nullptr;
+            HyphenatorBundle bundle;
+            if (HyphenatorBundle::parse(bundleData, size, &bundle)) {
+                for (const HyphenatorBundle::Entry& entry : bundle.entries) {
+                    if (entry.locale == mLocaleStr) {
+                        data = entry.patternData;
+                        size = entry.patternSize;
+                        break;
+                    }
+                }
+            }
+        }
+        if (data == nullptr) {
+            ALOGE("Failed to load the hyphenator for %s from %s", mLocaleStr.c_str(),
+                  mPath.c_str());
+            mHyphenator = fallback;
+            return;
+        }
+        mHyphenator = mCompile ? Hyphenator::loadCompiled(data, size, mMinPrefix, mMinSuffix,
+                                                          mLocaleStr)
+                               : Hyphenator::loadBinary(data, size, mMinPrefix, mMinSuffix,
+                                                        mLocaleStr);
+        if (mHyphenator == nullptr) {
+            mHyphenator = fallback;
+        }
+    });
+    return mHyphenator;
 }
 
 }  // namespace minikin
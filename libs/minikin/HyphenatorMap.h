@@ -17,8 +17,11 @@
 #ifndef MINIKIN_HYPHENATOR_MAP_H
 #define MINIKIN_HYPHENATOR_MAP_H
 
+#include <atomic>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 #include "minikin/Hyphenator.h"
 #include "minikin/Macros.h"
@@ -35,6 +38,14 @@ public:
         getInstance().addInternal(localeStr, hyphenator);
     }
 
+    // Registers the hyphenator of the hyb file at the path without reading the file. The file is
+    // mapped and the hyphenator is created on the first lookup of the locale or its aliases. The
+    // patterns are compiled if compile is true.
+    static void addFromFile(const std::string& localeStr, const std::string& path,
+                            size_t minPrefix, size_t minSuffix, bool compile) {
+        getInstance().addFromFileInternal(localeStr, path, minPrefix, minSuffix, compile);
+    }
+
     static void addAlias(const std::string& fromLocaleStr, const std::string& toLocaleStr) {
         getInstance().addAliasInternal(fromLocaleStr, toLocaleStr);
     }
@@ -43,7 +54,8 @@ public:
     static void clear() { getInstance().clearInternal(); }
 
     // The returned pointer is never a dangling pointer. If nothing found for a given locale,
-    // returns a hyphenator which only processes soft hyphens.
+    // returns a hyphenator which only processes soft hyphens. This doesn't take a lock unless the
+    // locale is neither registered nor in the cache of the fallback results.
     //
     // The Hyphenator lookup works with the following rules:
     // 1. Search for the Hyphenator with the given locale.
@@ -57,12 +69,24 @@ public:
     }
 
 protected:
-    // The following five methods are protected for testing purposes.
+    // The following methods are protected for testing purposes.
     HyphenatorMap();  // Use getInstance() instead.
     void addInternal(const std::string& localeStr, const Hyphenator* hyphenator);
+    void addFromFileInternal(const std::string& localeStr, const std::string& path,
+                             size_t minPrefix, size_t minSuffix, bool compile);
     void addAliasInternal(const std::string& fromLocaleStr, const std::string& toLocaleStr);
     const Hyphenator* lookupInternal(const Locale& locale);
 
+    static size_t getFallbackSlotIndex(uint64_t id) {
+        return static_cast<size_t>((id * 0x9E3779B97F4A7C15ull) >> 59);  // The top 5 bits.
+    }
+
+    // Returns the number of the locales whose fallback results are cached.
+    size_t getFallbackEntryCount() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mFallbackEntries.size();
+    }
+
 private:
     static HyphenatorMap& getInstance() {  // Singleton.
         static HyphenatorMap map;
@@ -71,12 +95,89 @@ private:
 
     void clearInternal();
 
-    const Hyphenator* lookupByIdentifier(uint64_t id) const EXCLUSIVE_LOCKS_REQUIRED(mMutex);
-    const Hyphenator* lookupBySubtag(const Locale& locale, SubtagBits bits) const
-            EXCLUSIVE_LOCKS_REQUIRED(mMutex);
+    // A hyphenator registered by the file path. The file is loaded by the first get() call, and
+    // the following calls return the same hyphenator. This is safe to call from multiple threads.
+    class LazyHyphenator {
+    public:
+        LazyHyphenator(const std::string& localeStr, const std::string& path, size_t minPrefix,
+                       size_t minSuffix, bool compile)
+                : mLocaleStr(localeStr),
+                  mPath(path),
+                  mMinPrefix(minPrefix),
+                  mMinSuffix(minSuffix),
+                  mCompile(compile),
+                  mHyphenator(nullptr) {}
+
+        // Returns the fallback if the file can't be loaded.
+        const Hyphenator* get(const Hyphenator* fallback);
+
+    private:
+        const std::string mLocaleStr;
+        const std::string mPath;
+        const size_t mMinPrefix;
+        const size_t mMinSuffix;
+        const bool mCompile;
+
+        std::once_flag mOnce;
+        const Hyphenator* mHyphenator;
+
+        MINIKIN_PREVENT_COPY_AND_ASSIGN(LazyHyphenator);
+    };
+
+    // Either the hyphenator is registered, or it is loaded by the lazyHyphenator on the lookup.
+    struct Entry {
+        const Hyphenator* hyphenator;
+        LazyHyphenator* lazyHyphenator;
+    };
+
+    // An immutable copy of the registered entries as an array sorted by the locale identifier. The
+    // lookups read the current snapshot without locking. The registrations copy it with the change
+    // under mMutex and publish the copy.
+    struct Snapshot {
+        typedef std::vector<std::pair<uint64_t, Entry>>::const_iterator Iterator;
+
+        std::vector<std::pair<uint64_t, Entry>> entries;
+
+        // Returns the first entry whose id is not less than the given id.
+        Iterator lowerBound(uint64_t id) const;
+        const Entry* find(uint64_t id) const;
+        const Entry* findBySubtag(const Locale& locale, SubtagBits bits) const;
+    };
+
+    // The fallback lookup result of a locale which is not registered. This is valid only while the
+    // snapshot is the current one, so that the later registrations are not hidden by it.
+    struct FallbackEntry {
+        const Snapshot* snapshot;
+        uint64_t id;
+        Entry entry;
+    };
+
+    static constexpr size_t kFallbackSlotCount = 32;
+    // The fallback entries can't be released while the lookups in the other threads may still
+    // read them, so the results of only this many locales are cached.
+    static constexpr size_t kMaxFallbackEntryCount = 256;
+
+    Entry lookupEntry(const Locale& locale);
+
+    // Publishes a new snapshot with the entry. The entry for the id is replaced if exists.
+    void putEntry(uint64_t id, const Entry& entry) EXCLUSIVE_LOCKS_REQUIRED(mMutex);
 
     const Hyphenator* mSoftHyphenOnlyHyphenator;
-    std::map<uint64_t, const Hyphenator*> mMap GUARDED_BY(mMutex);
+    std::atomic<const Snapshot*> mSnapshot;
+    // Owns all the published snapshots. The replaced snapshots are kept since the lookups in the
+    // other threads may still read them. The snapshot is replaced only on the registration, so
+    // only a few small snapshots are kept.
+    std::vector<std::unique_ptr<Snapshot>> mSnapshots GUARDED_BY(mMutex);
+    // A direct-mapped cache of the fallback lookup results, indexed by getFallbackSlotIndex().
+    std::atomic<const FallbackEntry*> mFallbackSlots[kFallbackSlotCount];
+    // Owns the latest fallback entry of each cached locale, keyed by the locale identifier. The
+    // slots only refer to these, so the locales colliding in a slot reuse their entries.
+    std::map<uint64_t, std::unique_ptr<FallbackEntry>> mFallbackEntries GUARDED_BY(mMutex);
+    // Owns the fallback entries of the replaced snapshots, which the other threads may still read.
+    // This grows only once per locale for each registration after the locale is looked up.
+    std::vector<std::unique_ptr<FallbackEntry>> mReplacedFallbackEntries GUARDED_BY(mMutex);
+    // Owns the LazyHyphenators referred by the entries.
+    std::vector<std::unique_ptr<LazyHyphenator>> mLazyHyphenators GUARDED_BY(mMutex);
 
     std::mutex mMutex;
 };
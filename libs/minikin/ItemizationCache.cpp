@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "Minikin"
+
+#include "ItemizationCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace minikin {
+
+ItemizationCache::ItemizationCache(uint32_t maxEntries)
+        : mCache(maxEntries), mRequestCount(0), mCacheHitCount(0) {
+    mCache.setOnEntryRemovedListener(this);
+}
+
+std::vector<FontCollection::Run> ItemizationCache::itemize(const FontCollection& collection,
+                                                           const U16StringPiece& text,
+                                                           FontStyle style, uint32_t localeListId,
+                                                           FamilyVariant variant) {
+    if (text.size() >= kLengthLimit) {
+        return collection.itemize(text, style, localeListId, variant);
+    }
+    ItemizationCacheKey key(collection.getId(), text, style, localeListId, variant);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRequestCount++;
+        const std::vector<FontCollection::Run>* runs = mCache.get(key);
+        if (runs != nullptr) {
+            mCacheHitCount++;
+            return *runs;
+        }
+    }
+    // Itemization takes long time, so releases the mutex during itemization.
+    std::vector<FontCollection::Run> runs = collection.itemize(text, style, localeListId, variant);
+    auto copied = std::make_unique<std::vector<FontCollection::Run>>(runs);
+    key.copyText();
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mCache.put(key, copied.get())) {
+            copied.release();
+        } else {
+            // The same text has been itemized in the other thread.
+            key.freeText();
+        }
+    }
+    return runs;
+}
+
+void ItemizationCache::clear() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mCache.clear();
+}
+
+uint32_t ItemizationCache::getCacheSize() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mCache.size();
+}
+
+void ItemizationCache::dumpStats(int fd) {
+    char buffer[256];
+    int length;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        const float ratio = (mRequestCount == 0) ? 0 : mCacheHitCount / (float)mRequestCount;
+        length = snprintf(buffer, sizeof(buffer),
+                          "\nItemization Cache Info:\n  Usage: %zu/%zu entries\n"
+                          "  Hit ratio: %u/%u (%f)\n",
+                          mCache.size(), kMaxEntries, mCacheHitCount, mRequestCount, ratio);
+    }
+    if (length <= 0) {
+        return;
+    }
+    const size_t size = std::min(static_cast<size_t>(length), sizeof(buffer) - 1);
+#ifdef _WIN32
+    _write(fd, buffer, size);
+#else
+    if (write(fd, buffer, size) < 0) {
+        // Nothing to do for the failure of dumping stats.
+    }
+#endif
+}
+
+void ItemizationCache::operator()(ItemizationCacheKey& key,
+                                  std::vector<FontCollection::Run>*& value) {
+    key.freeText();
+    delete value;
+}
+
+}  // namespace minikin
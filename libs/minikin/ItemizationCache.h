@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MINIKIN_ITEMIZATION_CACHE_H
+#define MINIKIN_ITEMIZATION_CACHE_H
+
+#include <mutex>
+#include <vector>
+
+#include <utils/LruCache.h>
+
+#include "minikin/FontCollection.h"
+#include "minikin/FontFamily.h"
+#include "minikin/Hasher.h"
+#include "minikin/Macros.h"
+#include "minikin/U16StringPiece.h"
+
+namespace minikin {
+
+class ItemizationCacheKey {
+public:
+    ItemizationCacheKey(uint32_t collectionId, const U16StringPiece& text, FontStyle style,
+                        uint32_t localeListId, FamilyVariant variant)
+            : mChars(text.data()),
+              mNchars(text.size()),
+              mCollectionId(collectionId),
+              mStyle(style),
+              mLocaleListId(localeListId),
+              mVariant(variant),
+              mHash(computeHash()) {}
+
+    bool operator==(const ItemizationCacheKey& o) const {
+        return mCollectionId == o.mCollectionId && mStyle == o.mStyle &&
+               mLocaleListId == o.mLocaleListId && mVariant == o.mVariant &&
+               mNchars == o.mNchars && !memcmp(mChars, o.mChars, mNchars * sizeof(uint16_t));
+    }
+
+    android::hash_t hash() const { return mHash; }
+
+    void copyText() {
+        uint16_t* charsCopy = new uint16_t[mNchars];
+        memcpy(charsCopy, mChars, mNchars * sizeof(uint16_t));
+        mChars = charsCopy;
+    }
+    void freeText() {
+        delete[] mChars;
+        mChars = nullptr;
+    }
+
+private:
+    const uint16_t* mChars;
+    size_t mNchars;
+    uint32_t mCollectionId;
+    FontStyle mStyle;
+    uint32_t mLocaleListId;
+    FamilyVariant mVariant;
+    android::hash_t mHash;
+
+    android::hash_t computeHash() const {
+        return Hasher()
+                .update(mCollectionId)
+                .update(mStyle.identifier())
+                .update(mLocaleListId)
+                .update(static_cast<uint8_t>(mVariant))
+                .updateShorts(mChars, mNchars)
+                .hash();
+    }
+};
+
+// A cache of the FontCollection::itemize results.
+//
+// The itemization only depends on the font collection, the text, the style, the locale list and
+// the family variant, so the result can be shared among the layouts with different text size,
+// letter spacing, etc., which are cached separately in the LayoutCache.
+class ItemizationCache
+        : private android::OnEntryRemoved<ItemizationCacheKey, std::vector<FontCollection::Run>*> {
+public:
+    static ItemizationCache& getInstance() {
+        static ItemizationCache cache(kMaxEntries);
+        return cache;
+    }
+
+    // Returns the same result as collection.itemize(text, style, localeListId, variant).
+    std::vector<FontCollection::Run> itemize(const FontCollection& collection,
+                                             const U16StringPiece& text, FontStyle style,
+                                             uint32_t localeListId, FamilyVariant variant);
+
+    void clear();
+
+    void dumpStats(int fd);
+
+    // Text longer than this is itemized without cache.
+    static const uint32_t kLengthLimit = 128;
+
+protected:
+    explicit ItemizationCache(uint32_t maxEntries);
+
+    uint32_t getCacheSize();
+
+private:
+    // callback for OnEntryRemoved
+    void operator()(ItemizationCacheKey& key, std::vector<FontCollection::Run>*& value);
+
+    android::LruCache<ItemizationCacheKey, std::vector<FontCollection::Run>*> mCache
+            GUARDED_BY(mMutex);
+
+    uint32_t mRequestCount GUARDED_BY(mMutex);
+    uint32_t mCacheHitCount GUARDED_BY(mMutex);
+
+    static const size_t kMaxEntries = 5000;
+
+    std::mutex mMutex;
+
+    MINIKIN_PREVENT_COPY_AND_ASSIGN(ItemizationCache);
+};
+
+inline android::hash_t hash_type(const ItemizationCacheKey& key) {
+    return key.hash();
+}
+
+}  // namespace minikin
+
+#endif  // MINIKIN_ITEMIZATION_CACHE_H
@@ -38,6 +38,9 @@
 #include "minikin/Macros.h"
 
 #include "BidiUtils.h"
+#include "HyphenPieceCache.h"
+#include "HyphenationCache.h"
+#include "ItemizationCache.h"
 #include "LayoutSplitter.h"
 #include "LayoutUtils.h"
 #include "LocaleListCache.h"
@@ -70,6 +73,100 @@ float Layout::measureText(const U16StringPiece& textBuf, const Range& range, Bid
     return advance;
 }
 
+namespace {
+
+struct BatchPieceInfo {
+    uint32_t rangeIndex;
+    uint32_t runIndex;
+    uint32_t outOffset;
+    float wordSpacing;
+};
+
+// The pieces may be reported in any order, so the advance of each piece is stored and summed up
+// afterwards in the same order as measureText does.
+class BatchMeasureFunctor {
+public:
+    BatchMeasureFunctor(const std::vector<BatchPieceInfo>& infos, float* pieceAdvances,
+                        float* advances)
+            : mInfos(infos), mPieceAdvances(pieceAdvances), mAdvances(advances) {}
+
+    void operator()(size_t index, const LayoutPiece& layoutPiece, const MinikinPaint& /* paint */) {
+        const BatchPieceInfo& info = mInfos[index];
+        mPieceAdvances[index] = layoutPiece.advance() + info.wordSpacing;
+        if (mAdvances) {
+            const std::vector<float>& advances = layoutPiece.advances();
+            std::copy(advances.begin(), advances.end(), mAdvances + info.outOffset);
+            mAdvances[info.outOffset] += info.wordSpacing;
+        }
+    }
+
+private:
+    const std::vector<BatchPieceInfo>& mInfos;
+    float* mPieceAdvances;
+    float* mAdvances;
+};
+
+}  // namespace
+
+void Layout::measureTextBatch(const U16StringPiece& textBuf, const std::vector<Range>& ranges,
+                              Bidi bidiFlags, const MinikinPaint& paint, float* totalAdvances,
+                              float* advances) {
+    std::vector<LayoutCacheRequest> requests;
+    std::vector<BatchPieceInfo> infos;
+    const bool ltrOnly = isLtrOnlyText(textBuf, bidiFlags);
+
+    uint32_t outStart = 0;
+    uint32_t runCount = 0;
+    for (uint32_t i = 0; i < ranges.size(); ++i) {
+        const Range& range = ranges[i];
+        totalAdvances[i] = 0;
+        auto addRun = [&](const Range& runRange, bool isRtl) {
+            if (!runRange.isValid()) {
+                return;  // ICU failed to retrieve the bidi run?
+            }
+            for (const auto[context, piece] : LayoutSplitter(textBuf, runRange, isRtl)) {
+                const U16StringPiece contextText = textBuf.substr(context);
+                const Range pieceRange(piece.getStart() - context.getStart(),
+                                       piece.getEnd() - context.getStart());
+                const float wordSpacing =
+                        piece.getLength() == 1 && isWordSpace(textBuf[piece.getStart()])
+                                ? paint.wordSpacing
+                                : 0;
+                requests.push_back({contextText, pieceRange, isRtl});
+                infos.push_back({i, runCount, outStart + range.toRangeOffset(piece.getStart()),
+                                 wordSpacing});
+            }
+            runCount++;
+        };
+        if (ltrOnly) {
+            addRun(range, false);
+        } else {
+            for (const BidiText::RunInfo& runInfo : BidiText(textBuf, range, bidiFlags)) {
+                addRun(runInfo.range, runInfo.isRtl);
+            }
+        }
+        outStart += range.getLength();
+    }
+
+    if (advances) {
+        std::fill(advances, advances + outStart, 0.0f);
+    }
+    std::vector<float> pieceAdvances(infos.size());
+    BatchMeasureFunctor f(infos, pieceAdvances.data(), advances);
+    LayoutCache::getInstance().getOrCreateBatch(requests, paint, f);
+
+    // Sum up the pieces of each run first, then the runs of each range, as measureText does, so
+    // that the totals are bit-identical.
+    float runAdvance = 0;
+    for (size_t i = 0; i < infos.size(); ++i) {
+        runAdvance += pieceAdvances[i];
+        if (i + 1 == infos.size() || infos[i + 1].runIndex != infos[i].runIndex) {
+            totalAdvances[infos[i].rangeIndex] += runAdvance;
+            runAdvance = 0;
+        }
+    }
+}
+
 float Layout::doLayoutRunCached(const U16StringPiece& textBuf, const Range& range, bool isRtl,
                                 const MinikinPaint& paint, size_t dstStart,
                                 StartHyphenEdit startHyphen, EndHyphenEdit endHyphen,
@@ -166,10 +263,16 @@ void Layout::appendLayout(const LayoutPiece& src, size_t start, float extraAdvan
 
 void Layout::purgeCaches() {
     LayoutCache::getInstance().clear();
+    ItemizationCache::getInstance().clear();
+    HyphenationCache::getInstance().clear();
+    HyphenPieceCache::getInstance().clear();
 }
 
 void Layout::dumpMinikinStats(int fd) {
     LayoutCache::getInstance().dumpStats(fd);
+    ItemizationCache::getInstance().dumpStats(fd);
+    HyphenationCache::getInstance().dumpStats(fd);
+    HyphenPieceCache::getInstance().dumpStats(fd);
 }
 
 }  // namespace minikin
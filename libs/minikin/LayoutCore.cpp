@@ -38,6 +38,7 @@
 #include "minikin/Macros.h"
 
 #include "BidiUtils.h"
+#include "ItemizationCache.h"
 #include "LayoutUtils.h"
 #include "LocaleListCache.h"
 #include "MinikinInternal.h"
@@ -355,8 +356,9 @@ LayoutPiece::LayoutPiece(const U16StringPiece& textBuf, const Range& range, bool
     mPoints.reserve(count);
 
     HbBufferUniquePtr buffer(hb_buffer_create());
-    std::vector<FontCollection::Run> items = paint.font->itemize(
-            textBuf.substr(range), paint.fontStyle, paint.localeListId, paint.familyVariant);
+    std::vector<FontCollection::Run> items = ItemizationCache::getInstance().itemize(
+            *paint.font, textBuf.substr(range), paint.fontStyle, paint.localeListId,
+            paint.familyVariant);
 
     std::vector<hb_feature_t> features;
     // Disable default-on non-required ligature features if letter-spacing
@@ -383,7 +385,7 @@ LayoutPiece::LayoutPiece(const U16StringPiece& textBuf, const Range& range, bool
     for (int run_ix = isRtl ? items.size() - 1 : 0;
          isRtl ? run_ix >= 0 : run_ix < static_cast<int>(items.size());
          isRtl ? --run_ix : ++run_ix) {
-        FontCollection::Run& run = items[run_ix];
+        const FontCollection::Run& run = items[run_ix];
         const FakedFont& fakedFont = run.fakedFont;
         auto it = fontMap.find(fakedFont.font);
         uint8_t font_ix;
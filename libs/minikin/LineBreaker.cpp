@@ -16,22 +16,134 @@
 
 #include "minikin/LineBreaker.h"
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 #include "GreedyLineBreaker.h"
 #include "OptimalLineBreaker.h"
 
 namespace minikin {
 
+LineBreakResult::LineBreakResult(const std::vector<LineRecord>& lines) {
+    breakPoints.reserve(lines.size());
+    widths.reserve(lines.size());
+    ascents.reserve(lines.size());
+    descents.reserve(lines.size());
+    flags.reserve(lines.size());
+    for (const LineRecord& line : lines) {
+        breakPoints.push_back(line.breakPoint);
+        widths.push_back(line.width);
+        ascents.push_back(line.ascent);
+        descents.push_back(line.descent);
+        flags.push_back(line.flags);
+    }
+}
+
 LineBreakResult breakIntoLines(const U16StringPiece& textBuffer, BreakStrategy strategy,
                                HyphenationFrequency frequency, bool justified,
                                const MeasuredText& measuredText, const LineWidth& lineWidth,
                                const TabStops& tabStops) {
+    return breakIntoLines(textBuffer, strategy, frequency, justified, measuredText, lineWidth,
+                          tabStops, nullptr /* no cache */);
+}
+
+LineBreakResult breakIntoLines(const U16StringPiece& textBuffer, BreakStrategy strategy,
+                               HyphenationFrequency frequency, bool justified,
+                               const MeasuredText& measuredText, const LineWidth& lineWidth,
+                               const TabStops& tabStops, LineBreakerCache* cache) {
+    return LineBreakResult(breakIntoLineRecords(textBuffer, strategy, frequency, justified,
+                                                measuredText, lineWidth, tabStops, cache));
+}
+
+std::vector<LineRecord> breakIntoLineRecords(const U16StringPiece& textBuffer,
+                                             BreakStrategy strategy, HyphenationFrequency frequency,
+                                             bool justified, const MeasuredText& measuredText,
+                                             const LineWidth& lineWidth, const TabStops& tabStops,
+                                             LineBreakerCache* cache) {
     if (strategy == BreakStrategy::Greedy || textBuffer.hasChar(CHAR_TAB)) {
         return breakLineGreedy(textBuffer, measuredText, lineWidth, tabStops,
                                frequency != HyphenationFrequency::None);
     } else {
         return breakLineOptimal(textBuffer, measuredText, lineWidth, strategy, frequency,
-                                justified);
+                                justified, cache);
+    }
+}
+
+std::vector<LineRecord> breakIntoFirstLines(const U16StringPiece& textBuffer,
+                                            BreakStrategy strategy, HyphenationFrequency frequency,
+                                            bool justified, const MeasuredText& measuredText,
+                                            const LineWidth& lineWidth, const TabStops& tabStops,
+                                            uint32_t maxLines) {
+    if (strategy == BreakStrategy::Greedy || textBuffer.hasChar(CHAR_TAB)) {
+        return breakLineGreedy(textBuffer, measuredText, lineWidth, tabStops,
+                               frequency != HyphenationFrequency::None, maxLines,
+                               false /* compute line info */);
+    } else {
+        return breakLineOptimal(textBuffer, measuredText, lineWidth, strategy, frequency,
+                                justified, nullptr /* no cache */, maxLines,
+                                false /* compute line info */);
+    }
+}
+
+uint32_t countLines(const U16StringPiece& textBuffer, BreakStrategy strategy,
+                    HyphenationFrequency frequency, bool justified,
+                    const MeasuredText& measuredText, const LineWidth& lineWidth,
+                    const TabStops& tabStops) {
+    if (strategy == BreakStrategy::Greedy || textBuffer.hasChar(CHAR_TAB)) {
+        return countLinesGreedy(textBuffer, measuredText, lineWidth, tabStops,
+                                frequency != HyphenationFrequency::None);
+    } else {
+        return countLinesOptimal(textBuffer, measuredText, lineWidth, strategy, frequency,
+                                 justified);
+    }
+}
+
+namespace {
+
+// The minimum total length of the paragraphs per thread. Starting a thread costs about as much as
+// breaking a few thousand characters, so a thread is only worth it for that much text.
+constexpr size_t MIN_TEXT_LENGTH_PER_THREAD = 2048;
+
+}  // namespace
+
+std::vector<LineBreakResult> breakParagraphsIntoLines(
+        const std::vector<LineBreakParagraph>& paragraphs, BreakStrategy strategy,
+        HyphenationFrequency frequency, bool justified, uint32_t threadCount) {
+    std::vector<LineBreakResult> results(paragraphs.size());
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    size_t textLength = 0;
+    for (const LineBreakParagraph& paragraph : paragraphs) {
+        textLength += paragraph.text.size();
+    }
+    const uint32_t workerCount = std::max<size_t>(
+            1, std::min({static_cast<size_t>(threadCount), paragraphs.size(),
+                         textLength / MIN_TEXT_LENGTH_PER_THREAD}));
+
+    // The paragraphs are independent, so each worker simply takes the next unprocessed paragraph
+    // until all the paragraphs are processed. This balances the load even if the paragraph
+    // lengths vary a lot.
+    std::atomic<uint32_t> nextParagraph(0);
+    auto worker = [&]() {
+        for (uint32_t i = nextParagraph++; i < paragraphs.size(); i = nextParagraph++) {
+            const LineBreakParagraph& paragraph = paragraphs[i];
+            results[i] = breakIntoLines(paragraph.text, strategy, frequency, justified,
+                                        *paragraph.measuredText, *paragraph.lineWidth,
+                                        *paragraph.tabStops);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < workerCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
     }
+    return results;
 }
 
 }  // namespace minikin
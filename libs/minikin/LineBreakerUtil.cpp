@@ -16,45 +16,93 @@
 
 #include "LineBreakerUtil.h"
 
-namespace minikin {
+#include <algorithm>
+#include <numeric>
 
-// Very long words trigger O(n^2) behavior in hyphenation, so we disable hyphenation for
-// unreasonably long words. This is somewhat of a heuristic because extremely long words are
-// possible in some languages. This does mean that very long real words can get broken by
-// desperate breaks, with no hyphens.
-constexpr size_t LONGEST_HYPHENATED_WORD = 45;
+#include "HyphenationCache.h"
 
-// Hyphenates a string potentially containing non-breaking spaces.
-std::vector<HyphenationType> hyphenate(const U16StringPiece& str, const Hyphenator& hyphenator) {
-    std::vector<HyphenationType> out;
-    const size_t len = str.size();
-    out.resize(len);
+namespace minikin {
+
+// Very long words trigger O(n^2) behavior in measuring the hyphenated pieces, since both pieces of
+// every hyphenation point are measured, so we disable hyphenation for unreasonably long words.
+// This is somewhat of a heuristic. It covers the long compound words of German or Finnish and the
+// chemical names, but the longer strings are more likely to be URLs or other non-words, which get
+// broken by desperate breaks, with no hyphens.
+constexpr size_t LONGEST_HYPHENATED_WORD = 128;
 
-    // A word here is any consecutive string of non-NBSP characters.
+// Calls f with each word of the range to be hyphenated. A word here is any consecutive string of
+// non-NBSP characters.
+template <typename F>
+static void forEachWordToHyphenate(const U16StringPiece& str, const Range& range, F f) {
     bool inWord = false;
-    size_t wordStart = 0;  // The initial value will never be accessed, but just in case.
-    for (size_t i = 0; i <= len; i++) {
-        if (i == len || str[i] == CHAR_NBSP) {
+    uint32_t wordStart = 0;  // The initial value will never be accessed, but just in case.
+    for (uint32_t i = range.getStart(); i <= range.getEnd(); i++) {
+        if (i == range.getEnd() || str[i] == CHAR_NBSP) {
             if (inWord) {
-                // A word just ended. Hyphenate it.
-                const U16StringPiece word = str.substr(Range(wordStart, i));
-                if (word.size() <= LONGEST_HYPHENATED_WORD) {
-                    hyphenator.hyphenate(word, out.data() + wordStart);
-                } else {  // Word is too long. Inefficient to hyphenate.
-                    out.insert(out.end(), word.size(), HyphenationType::DONT_BREAK);
+                // A word just ended. If the word is too long, it is inefficient to hyphenate.
+                if (i - wordStart <= LONGEST_HYPHENATED_WORD) {
+                    f(Range(wordStart, i));
                 }
                 inWord = false;
             }
-            if (i < len) {
-                // Insert one DONT_BREAK for the NBSP.
-                out.push_back(HyphenationType::DONT_BREAK);
-            }
         } else if (!inWord) {
             inWord = true;
             wordStart = i;
         }
     }
-    return out;
+}
+
+// Hyphenates a string potentially containing non-breaking spaces.
+void hyphenate(const U16StringPiece& str, const Hyphenator& hyphenator,
+               std::vector<HyphenationType>* out) {
+    // The non-breaking spaces and the words too long to hyphenate are left DONT_BREAK.
+    out->assign(str.size(), HyphenationType::DONT_BREAK);
+    forEachWordToHyphenate(str, Range(0, str.size()), [&](const Range& word) {
+        HyphenationCache::getInstance().hyphenate(hyphenator, str.substr(word),
+                                                  out->data() + word.getStart());
+    });
+}
+
+std::pair<float, float> computeHyphenPieceWidths(const U16StringPiece& textBuf, const Run& run,
+                                                 const Range& contextRange, uint32_t offset,
+                                                 HyphenationType hyph, LayoutPieces* pieces,
+                                                 HyphenPieceApproximation* approximation) {
+    // The approximation only covers the hyphen appended to the end of the line with no edit at the
+    // start of the next line, where the pieces are the characters as measured in the run plus the
+    // hyphen. The layout pieces must be measured for real.
+    if (approximation == nullptr || pieces != nullptr || run.isRtl() ||
+        hyph != HyphenationType::BREAK_AND_INSERT_HYPHEN) {
+        return run.measureHyphenPieces(textBuf, contextRange, offset, hyph, pieces);
+    }
+    const float* advances = approximation->advances;
+    const float firstAdvances =
+            std::accumulate(advances + contextRange.getStart(), advances + offset, 0.0f);
+    const float secondAdvances =
+            std::accumulate(advances + offset, advances + contextRange.getEnd(), 0.0f);
+    if (approximation->hasHyphenAdvance) {
+        return std::make_pair(firstAdvances + approximation->hyphenAdvance, secondAdvances);
+    }
+    const std::pair<float, float> widths =
+            run.measureHyphenPieces(textBuf, contextRange, offset, hyph, pieces);
+    approximation->hasHyphenAdvance = true;
+    approximation->hyphenAdvance = widths.first - firstAdvances;
+    return widths;
+}
+
+void hyphenateRanges(const U16StringPiece& textBuf, const std::vector<Range>& ranges,
+                     const Hyphenator& hyphenator, LineBreakScratch* scratch) {
+    std::vector<HyphenationType>& out = scratch->hyphenation;
+    std::vector<Range>& words = scratch->hyphenationWords;
+    out.resize(textBuf.size());
+    words.clear();
+    for (const Range& range : ranges) {
+        std::fill(out.begin() + range.getStart(), out.begin() + range.getEnd(),
+                  HyphenationType::DONT_BREAK);
+        forEachWordToHyphenate(textBuf, range, [&words](const Range& word) {
+            words.push_back(word);
+        });
+    }
+    HyphenationCache::getInstance().hyphenate(hyphenator, textBuf, words, out.data());
 }
 
 }  // namespace minikin
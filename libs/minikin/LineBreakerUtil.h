@@ -17,6 +17,7 @@
 #ifndef MINIKIN_LINE_BREAKER_UTIL_H
 #define MINIKIN_LINE_BREAKER_UTIL_H
 
+#include <limits>
 #include <vector>
 
 #include "minikin/Hyphenator.h"
@@ -38,8 +39,42 @@ namespace minikin {
 // on performance/accuracy tradeoff.
 typedef double ParaWidth;
 
-// Hyphenates a string potentially containing non-breaking spaces.
-std::vector<HyphenationType> hyphenate(const U16StringPiece& string, const Hyphenator& hypenator);
+// Represents a desperate break point.
+struct DesperateBreak {
+    // The break offset.
+    uint32_t offset;
+
+    // The sum of the character width from the beginning of the word.
+    ParaWidth sumOfChars;
+
+    DesperateBreak(uint32_t offset, ParaWidth sumOfChars)
+            : offset(offset), sumOfChars(sumOfChars){};
+};
+
+// Buffers reused across the words of a paragraph by a line breaker, so that they are allocated a
+// few times for the paragraph instead of once for each word. The contents are only valid until
+// they are filled for the next word.
+struct LineBreakScratch {
+    // The hyphenation of the current word, or of the text buffer for hyphenateRanges.
+    std::vector<HyphenationType> hyphenation;
+
+    // The desperate break points of the current word.
+    std::vector<DesperateBreak> desperateBreaks;
+
+    // The words split from the ranges passed to hyphenateRanges.
+    std::vector<Range> hyphenationWords;
+};
+
+// Hyphenates a string potentially containing non-breaking spaces. The out is overwritten with the
+// result, which has the same length as the string.
+void hyphenate(const U16StringPiece& string, const Hyphenator& hypenator,
+               std::vector<HyphenationType>* out);
+
+// Hyphenates the ranges of the text buffer at once, e.g. all the words of a run. The result is
+// stored in scratch->hyphenation at the same offsets as the text buffer. Same as hyphenate, the
+// ranges may contain non-breaking spaces.
+void hyphenateRanges(const U16StringPiece& textBuf, const std::vector<Range>& ranges,
+                     const Hyphenator& hyphenator, LineBreakScratch* scratch);
 
 // This function determines whether a character is a space that disappears at end of line.
 // It is the Unicode set: [[:General_Category=Space_Separator:]-[:Line_Break=Glue:]], plus '\n'.
@@ -60,40 +95,48 @@ inline Locale getEffectiveLocale(uint32_t localeListId) {
     return localeList.empty() ? Locale() : localeList[0];
 }
 
+// Approximates the hyphen piece widths from the character advances instead of measuring the
+// pieces. See MeasuredTextBuilder::setApproximateHyphenPieceWidths.
+struct HyphenPieceApproximation {
+    // The character advances of the text buffer.
+    const float* advances;
+
+    // The advance added by the hyphen at the end of a piece. Calibrated by the first hyphenation
+    // point measured in the run.
+    bool hasHyphenAdvance;
+    float hyphenAdvance;
+};
+
+// Returns the widths of the pieces of the context range split at the hyphenation point, measured by
+// the run or approximated if the approximation is not null.
+std::pair<float, float> computeHyphenPieceWidths(const U16StringPiece& textBuf, const Run& run,
+                                                 const Range& contextRange, uint32_t offset,
+                                                 HyphenationType hyph, LayoutPieces* pieces,
+                                                 HyphenPieceApproximation* approximation);
+
 // Retrieves hyphenation break points from a word.
 inline void populateHyphenationPoints(
         const U16StringPiece& textBuf,        // A text buffer.
         const Run& run,                       // A run of this region.
-        const Hyphenator& hyphenator,         // A hyphenator to be used for hyphenation.
         const Range& contextRange,            // A context range for measuring hyphenated piece.
         const Range& hyphenationTargetRange,  // An actual range for the hyphenation target.
+        const HyphenationType* hyphenResult,  // The hyphenation of the target, at its offsets.
         std::vector<HyphenBreak>* out,        // An output to be appended.
-        LayoutPieces* pieces) {               // An output of layout pieces. Maybe null.
+        LayoutPieces* pieces,                 // An output of layout pieces. Maybe null.
+        HyphenPieceApproximation* approximation) {  // Approximates the widths if not null.
     if (!run.getRange().contains(contextRange) || !contextRange.contains(hyphenationTargetRange)) {
         return;
     }
 
-    const std::vector<HyphenationType> hyphenResult =
-            hyphenate(textBuf.substr(hyphenationTargetRange), hyphenator);
     for (uint32_t i = hyphenationTargetRange.getStart(); i < hyphenationTargetRange.getEnd(); ++i) {
-        const HyphenationType hyph = hyphenResult[hyphenationTargetRange.toRangeOffset(i)];
+        const HyphenationType hyph = hyphenResult[i];
         if (hyph == HyphenationType::DONT_BREAK) {
             continue;  // Not a hyphenation point.
         }
 
-        auto hyphenPart = contextRange.split(i);
-        U16StringPiece firstText = textBuf.substr(hyphenPart.first);
-        U16StringPiece secondText = textBuf.substr(hyphenPart.second);
-        const float first =
-                run.measureHyphenPiece(firstText, Range(0, firstText.size()),
-                                       StartHyphenEdit::NO_EDIT /* start hyphen edit */,
-                                       editForThisLine(hyph) /* end hyphen edit */, pieces);
-        const float second =
-                run.measureHyphenPiece(secondText, Range(0, secondText.size()),
-                                       editForNextLine(hyph) /* start hyphen edit */,
-                                       EndHyphenEdit::NO_EDIT /* end hyphen edit */, pieces);
-
-        out->emplace_back(i, hyph, first, second);
+        const std::pair<float, float> widths = computeHyphenPieceWidths(
+                textBuf, run, contextRange, i, hyph, pieces, approximation);
+        out->emplace_back(i, hyph, widths.first, widths.second);
     }
 }
 
@@ -130,7 +173,9 @@ struct CharProcessor {
     const Hyphenator* hyphenator = nullptr;
 
     // Retrieve the current word range.
-    inline Range wordRange() const { return breaker.wordRange(); }
+    inline Range wordRange() const {
+        return wordBreaks ? (*wordBreaks)[wordBreakIndex].wordRange : breaker.wordRange();
+    }
 
     // Retrieve the current context range.
     inline Range contextRange() const { return Range(prevWordBreak, nextWordBreak); }
@@ -141,17 +186,28 @@ struct CharProcessor {
     }
 
     // Returns the break penalty for the current word break point.
-    inline int wordBreakPenalty() const { return breaker.breakBadness(); }
+    inline int wordBreakPenalty() const {
+        return wordBreaks ? (*wordBreaks)[wordBreakIndex].badness : breaker.breakBadness();
+    }
 
+    // Runs the word breaker on the text.
     CharProcessor(const U16StringPiece& text) { breaker.setText(text.data(), text.size()); }
 
+    // Replays the word break points recorded while measuring the text instead of running the word
+    // breaker. The characters must be fed in the same order as during the measurement.
+    CharProcessor(const MeasuredText& measured) : wordBreaks(&measured.wordBreaks) {
+        nextWordBreak = nextRecordedWordBreak();
+    }
+
     // The user of CharProcessor must call updateLocaleIfNecessary with valid locale at least one
     // time before feeding characters.
     void updateLocaleIfNecessary(const Run& run) {
         uint32_t newLocaleListId = run.getLocaleListId();
         if (localeListId != newLocaleListId) {
             Locale locale = getEffectiveLocale(newLocaleListId);
-            nextWordBreak = breaker.followingWithLocale(locale, run.getRange().getStart());
+            if (!wordBreaks) {
+                nextWordBreak = breaker.followingWithLocale(locale, run.getRange().getStart());
+            }
             hyphenator = HyphenatorMap::lookup(locale);
             localeListId = newLocaleListId;
         }
@@ -164,7 +220,12 @@ struct CharProcessor {
                 prevWordBreak = nextWordBreak;
                 sumOfCharWidthsAtPrevWordBreak = sumOfCharWidths;
             }
-            nextWordBreak = breaker.next();
+            if (wordBreaks) {
+                wordBreakIndex++;
+                nextWordBreak = nextRecordedWordBreak();
+            } else {
+                nextWordBreak = breaker.next();
+            }
         }
         if (isWordSpace(c)) {
             rawSpaceCount += 1;
@@ -182,10 +243,21 @@ struct CharProcessor {
     }
 
 private:
+    inline uint32_t nextRecordedWordBreak() const {
+        return wordBreakIndex < wordBreaks->size() ? (*wordBreaks)[wordBreakIndex].offset
+                                                   : std::numeric_limits<uint32_t>::max();
+    }
+
     // The current locale list id.
     uint32_t localeListId = LocaleListCache::kInvalidListId;
 
     WordBreaker breaker;
+
+    // The recorded word break points to be replayed, or nullptr if the word breaker is used.
+    const std::vector<WordBreakPoint>* wordBreaks = nullptr;
+
+    // The index of the next word break point in wordBreaks.
+    uint32_t wordBreakIndex = 0;
 };
 }  // namespace minikin
 
@@ -17,20 +17,78 @@
 #define LOG_TAG "Minikin"
 #include "minikin/MeasuredText.h"
 
+#include <algorithm>
+#include <tuple>
+
 #include "minikin/Layout.h"
 
 #include "BidiUtils.h"
+#include "HyphenPieceCache.h"
 #include "LayoutSplitter.h"
 #include "LayoutUtils.h"
 #include "LineBreakerUtil.h"
 
 namespace minikin {
 
+void PieceExtents::build(uint32_t textLength) {
+    std::sort(mPendingPieces.begin(), mPendingPieces.end(),
+              [](const std::pair<Range, MinikinExtent>& l,
+                 const std::pair<Range, MinikinExtent>& r) {
+                  return l.first.getStart() < r.first.getStart();
+              });
+    mStarts.clear();
+    mTree.clear();
+
+    const uint32_t size = mPendingPieces.size();
+    uint32_t end = 0;
+    bool covered = size != 0;
+    for (const auto& piece : mPendingPieces) {
+        if (piece.first.getStart() != end) {
+            covered = false;  // Some run didn't add its pieces, or the pieces overlap.
+            break;
+        }
+        end = piece.first.getEnd();
+    }
+    if (covered && end == textLength) {
+        mStarts.reserve(size + 1);
+        mTree.resize(2 * size);
+        for (uint32_t i = 0; i < size; ++i) {
+            mStarts.push_back(mPendingPieces[i].first.getStart());
+            mTree[size + i] = mPendingPieces[i].second;
+        }
+        mStarts.push_back(textLength);
+        for (uint32_t i = size - 1; i > 0; --i) {
+            mTree[i] = mTree[2 * i];
+            mTree[i].extendBy(mTree[2 * i + 1]);
+        }
+    }
+    std::vector<std::pair<Range, MinikinExtent>>().swap(mPendingPieces);
+}
+
+uint32_t PieceExtents::findPiece(uint32_t offset) const {
+    return std::upper_bound(mStarts.begin(), mStarts.end(), offset) - mStarts.begin() - 1;
+}
+
+MinikinExtent PieceExtents::getExtent(uint32_t from, uint32_t to) const {
+    MinikinExtent extent;
+    const uint32_t size = mStarts.size() - 1;
+    for (from += size, to += size; from < to; from /= 2, to /= 2) {
+        if (from & 1) {
+            extent.extendBy(mTree[from++]);
+        }
+        if (to & 1) {
+            extent.extendBy(mTree[--to]);
+        }
+    }
+    return extent;
+}
+
 // Helper class for composing character advances.
 class AdvancesCompositor {
 public:
-    AdvancesCompositor(std::vector<float>* outAdvances, LayoutPieces* outPieces)
-            : mOutAdvances(outAdvances), mOutPieces(outPieces) {}
+    AdvancesCompositor(std::vector<float>* outAdvances, LayoutPieces* outPieces,
+                       PieceExtents* outExtents)
+            : mOutAdvances(outAdvances), mOutPieces(outPieces), mOutExtents(outExtents) {}
 
     void setNextRange(const Range& range, bool dir) {
         mRange = range;
@@ -44,6 +102,9 @@ public:
         if (mOutPieces != nullptr) {
             mOutPieces->insert(mRange, 0 /* no edit */, layoutPiece, mDir, paint);
         }
+        if (mOutExtents != nullptr) {
+            mOutExtents->add(mRange, layoutPiece.extent());
+        }
     }
 
 private:
@@ -51,11 +112,18 @@ private:
     bool mDir;
     std::vector<float>* mOutAdvances;
     LayoutPieces* mOutPieces;
+    PieceExtents* mOutExtents;
 };
 
 void StyleRun::getMetrics(const U16StringPiece& textBuf, std::vector<float>* advances,
                           LayoutPieces* precomputed, LayoutPieces* outPieces) const {
-    AdvancesCompositor compositor(advances, outPieces);
+    getMetricsWithExtents(textBuf, advances, precomputed, outPieces, nullptr /* outExtents */);
+}
+
+void StyleRun::getMetricsWithExtents(const U16StringPiece& textBuf, std::vector<float>* advances,
+                                     LayoutPieces* precomputed, LayoutPieces* outPieces,
+                                     PieceExtents* outExtents) const {
+    AdvancesCompositor compositor(advances, outPieces, outExtents);
     const Bidi bidiFlag = mIsRtl ? Bidi::FORCE_RTL : Bidi::FORCE_LTR;
     const uint32_t paintId =
             (precomputed == nullptr) ? LayoutPieces::kNoPaintId : precomputed->findPaintId(mPaint);
@@ -124,22 +192,62 @@ float StyleRun::measureHyphenPiece(const U16StringPiece& textBuf, const Range& r
     return compositor.advance();
 }
 
+std::pair<float, float> Run::measureHyphenPieces(const U16StringPiece& textBuf,
+                                                 const Range& contextRange, uint32_t offset,
+                                                 HyphenationType hyph,
+                                                 LayoutPieces* pieces) const {
+    const std::pair<Range, Range> hyphenPart = contextRange.split(offset);
+    const U16StringPiece firstText = textBuf.substr(hyphenPart.first);
+    const U16StringPiece secondText = textBuf.substr(hyphenPart.second);
+    const float first = measureHyphenPiece(firstText, Range(0, firstText.size()),
+                                           StartHyphenEdit::NO_EDIT /* start hyphen edit */,
+                                           editForThisLine(hyph) /* end hyphen edit */, pieces);
+    const float second = measureHyphenPiece(secondText, Range(0, secondText.size()),
+                                            editForNextLine(hyph) /* start hyphen edit */,
+                                            EndHyphenEdit::NO_EDIT /* end hyphen edit */, pieces);
+    return std::make_pair(first, second);
+}
+
+std::pair<float, float> StyleRun::measureHyphenPieces(const U16StringPiece& textBuf,
+                                                      const Range& contextRange, uint32_t offset,
+                                                      HyphenationType hyph,
+                                                      LayoutPieces* pieces) const {
+    const U16StringPiece word = textBuf.substr(contextRange);
+    if (pieces != nullptr || !HyphenPieceCache::canCache(word, mPaint)) {
+        return Run::measureHyphenPieces(textBuf, contextRange, offset, hyph, pieces);
+    }
+    HyphenPieceCache& cache = HyphenPieceCache::getInstance();
+    const uint32_t wordOffset = offset - contextRange.getStart();
+    HyphenPieceWidths widths;
+    if (!cache.get(word, wordOffset, hyph, mPaint, mIsRtl, &widths)) {
+        std::tie(widths.first, widths.second) =
+                Run::measureHyphenPieces(textBuf, contextRange, offset, hyph, nullptr);
+        cache.put(word, wordOffset, hyph, mPaint, mIsRtl, widths);
+    }
+    return std::make_pair(widths.first, widths.second);
+}
+
 void MeasuredText::measure(const U16StringPiece& textBuf, bool computeHyphenation,
-                           bool computeLayout, MeasuredText* hint) {
+                           bool computeLayout, bool approximateHyphenPieceWidths,
+                           MeasuredText* hint) {
     if (textBuf.size() == 0) {
         return;
     }
 
     LayoutPieces* piecesOut = computeLayout ? &layoutPieces : nullptr;
     CharProcessor proc(textBuf);
+    LineBreakScratch scratch;
+    // The words of the run, which are hyphenated at once at the end of the run.
+    std::vector<Range> hyphenationTargets;
+    std::vector<Range> hyphenationContexts;
     for (const auto& run : runs) {
         const Range& range = run->getRange();
-        run->getMetrics(textBuf, &widths, hint ? &hint->layoutPieces : nullptr, piecesOut);
-
-        if (!computeHyphenation || !run->canBreak()) {
-            continue;
-        }
+        run->getMetricsWithExtents(textBuf, &widths, hint ? &hint->layoutPieces : nullptr,
+                                   piecesOut, &pieceExtents);
 
+        // The word breaker walks all the runs as the line breakers do, so that they can replay the
+        // recorded word breaks instead of running the word breaker again.
+        const bool doHyphenation = computeHyphenation && run->canBreak();
         proc.updateLocaleIfNecessary(*run);
         for (uint32_t i = range.getStart(); i < range.getEnd(); ++i) {
             proc.feedChar(i, textBuf[i], widths[i], run->canBreak());
@@ -149,10 +257,26 @@ void MeasuredText::measure(const U16StringPiece& textBuf, bool computeHyphenatio
                 continue;  // Wait until word break point.
             }
 
-            populateHyphenationPoints(textBuf, *run, *proc.hyphenator, proc.contextRange(),
-                                      proc.wordRange(), &hyphenBreaks, piecesOut);
+            wordBreaks.emplace_back(nextCharOffset, proc.wordRange(), proc.wordBreakPenalty());
+            if (doHyphenation) {
+                hyphenationTargets.push_back(proc.wordRange());
+                hyphenationContexts.push_back(proc.contextRange());
+            }
+        }
+        if (hyphenationTargets.empty()) {
+            continue;
+        }
+        hyphenateRanges(textBuf, hyphenationTargets, *proc.hyphenator, &scratch);
+        HyphenPieceApproximation approximation = {widths.data(), false, 0.0f};
+        for (size_t j = 0; j < hyphenationTargets.size(); ++j) {
+            populateHyphenationPoints(textBuf, *run, hyphenationContexts[j], hyphenationTargets[j],
+                                      scratch.hyphenation.data(), &hyphenBreaks, piecesOut,
+                                      approximateHyphenPieceWidths ? &approximation : nullptr);
         }
+        hyphenationTargets.clear();
+        hyphenationContexts.clear();
     }
+    pieceExtents.build(textBuf.size());
 }
 
 // Helper class for composing Layout object.
@@ -309,6 +433,38 @@ MinikinRect MeasuredText::getBounds(const U16StringPiece& textBuf, const Range&
 }
 
 MinikinExtent MeasuredText::getExtent(const U16StringPiece& textBuf, const Range& range) const {
+    if (range.isEmpty() || !pieceExtents.isAvailable()) {
+        return computeExtent(textBuf, range);
+    }
+
+    // Only the pieces partially covered by the range need to be computed. The line breakers
+    // usually break at piece boundaries, so this is mostly a single query to pieceExtents.
+    uint32_t first = pieceExtents.findPiece(range.getStart());
+    uint32_t last = pieceExtents.findPiece(range.getEnd() - 1);
+    const Range firstRange = pieceExtents.getRange(first);
+    const Range lastRange = pieceExtents.getRange(last);
+    if (first == last && firstRange != range) {
+        return computeExtent(textBuf, range);
+    }
+
+    MinikinExtent extent;
+    if (firstRange.getStart() != range.getStart()) {
+        extent.extendBy(computeExtent(textBuf, Range(range.getStart(), firstRange.getEnd())));
+        first++;
+    }
+    if (lastRange.getEnd() != range.getEnd()) {
+        extent.extendBy(computeExtent(textBuf, Range(lastRange.getStart(), range.getEnd())));
+    } else {
+        last++;
+    }
+    if (first < last) {
+        extent.extendBy(pieceExtents.getExtent(first, last));
+    }
+    return extent;
+}
+
+MinikinExtent MeasuredText::computeExtent(const U16StringPiece& textBuf,
+                                          const Range& range) const {
     MinikinExtent extent;
     for (const auto& run : runs) {
         const Range& runRange = run->getRange();
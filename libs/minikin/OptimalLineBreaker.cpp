@@ -17,10 +17,13 @@
 #include "OptimalLineBreaker.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <limits>
 
 #include "minikin/Characters.h"
 #include "minikin/Layout.h"
+#include "minikin/MinikinExtent.h"
 #include "minikin/Range.h"
 #include "minikin/U16StringPiece.h"
 
@@ -55,6 +58,19 @@ constexpr float SHRINK_PENALTY_MULTIPLIER = 4.0f;
 // Maximum amount that spaces can shrink, in justified text.
 constexpr float SHRINKABILITY = 1.0 / 3.0;
 
+// The number of candidates scored at once by computeWidthScores.
+constexpr uint32_t SCORE_LANES = 4;
+
+// The scan for the beginning of the line is done SCORE_LANES candidates at a time only if it is
+// longer than this. Shorter scans are faster one by one.
+constexpr uint32_t MIN_LANES_SCAN_LENGTH = 4 * SCORE_LANES;
+
+// False only while testing that the scoring SCORE_LANES candidates at a time gives the same result.
+std::atomic<bool> gScoreLanesEnabled(true);
+
+// The penalty ratio of desperate breaks, which get SCORE_DESPERATE regardless of the run.
+constexpr int DESPERATE_PENALTY_RATIO = -1;
+
 // A single candidate break
 struct Candidate {
     uint32_t offset;  // offset to text buffer, in code units
@@ -64,64 +80,99 @@ struct Candidate {
                               // between two candidates. The line width between two line break
                               // candidates i and j is calculated as postBreak(j) - preBreak(i).
     ParaWidth postBreak;      // width of text until this point, if we decide to break here
-    float penalty;            // penalty of this break (for example, hyphen penalty)
+    uint32_t runIndex;        // index of the run the penalty of this break is computed for
+    int penaltyRatio;         // penalty of this break in units of the hyphen penalty of the run,
+                              // or DESPERATE_PENALTY_RATIO
     uint32_t preSpaceCount;   // preceding space count before breaking
     uint32_t postSpaceCount;  // preceding space count after breaking
     HyphenationType hyphenType;
     bool isRtl;  // The direction of the bidi run containing or ending in this candidate
 
-    Candidate(uint32_t offset, ParaWidth preBreak, ParaWidth postBreak, float penalty,
-              uint32_t preSpaceCount, uint32_t postSpaceCount, HyphenationType hyphenType,
-              bool isRtl)
+    Candidate(uint32_t offset, ParaWidth preBreak, ParaWidth postBreak, uint32_t runIndex,
+              int penaltyRatio, uint32_t preSpaceCount, uint32_t postSpaceCount,
+              HyphenationType hyphenType, bool isRtl)
             : offset(offset),
               preBreak(preBreak),
               postBreak(postBreak),
-              penalty(penalty),
+              runIndex(runIndex),
+              penaltyRatio(penaltyRatio),
               preSpaceCount(preSpaceCount),
               postSpaceCount(postSpaceCount),
               hyphenType(hyphenType),
               isRtl(isRtl) {}
+
+    bool operator==(const Candidate& o) const {
+        return offset == o.offset && preBreak == o.preBreak && postBreak == o.postBreak &&
+               runIndex == o.runIndex && penaltyRatio == o.penaltyRatio &&
+               preSpaceCount == o.preSpaceCount && postSpaceCount == o.postSpaceCount &&
+               hyphenType == o.hyphenType && isRtl == o.isRtl;
+    }
 };
 
 // A context of line break optimization.
+//
+// This doesn't depend on the line width except for the desperate breaks, which are only added to
+// the words wider than the minimum line width. The context can be reused for any minimum line
+// width in [minLineWidthLow, minLineWidthHigh), which leaves the same words desperate.
 struct OptimizeContext {
     // The break candidates.
     std::vector<Candidate> candidates;
 
-    // The penalty for the number of lines.
-    float linePenalty = 0.0f;
+    // The preBreak and preSpaceCount of the candidates in separate arrays, for scoring consecutive
+    // candidates as the beginnings of the line with computeWidthScores.
+    std::vector<ParaWidth> preBreaks;
+    std::vector<uint32_t> preSpaceCounts;
 
     // The width of a space. May be 0 if there are no spaces.
     // Note: if there are multiple different widths for spaces (for example, because of mixing of
     // fonts), it's only guaranteed to pick one.
     float spaceWidth = 0.0f;
 
+    // The widest word not wider than the minimum line width.
+    ParaWidth minLineWidthLow = std::numeric_limits<ParaWidth>::lowest();
+    // The narrowest word wider than the minimum line width.
+    ParaWidth minLineWidthHigh = std::numeric_limits<ParaWidth>::max();
+
+    bool isValidFor(ParaWidth minLineWidth) const {
+        return minLineWidthLow <= minLineWidth && minLineWidth < minLineWidthHigh;
+    }
+
     // Append desperate break point to the candidates.
     inline void pushDesperate(uint32_t offset, ParaWidth sumOfCharWidths, uint32_t spaceCount,
-                              bool isRtl) {
-        candidates.emplace_back(offset, sumOfCharWidths, sumOfCharWidths, SCORE_DESPERATE,
-                                spaceCount, spaceCount,
+                              uint32_t runIndex, bool isRtl) {
+        candidates.emplace_back(offset, sumOfCharWidths, sumOfCharWidths, runIndex,
+                                DESPERATE_PENALTY_RATIO, spaceCount, spaceCount,
                                 HyphenationType::BREAK_AND_DONT_INSERT_HYPHEN, isRtl);
     }
 
     // Append hyphenation break point to the candidates.
     inline void pushHyphenation(uint32_t offset, ParaWidth preBreak, ParaWidth postBreak,
-                                float penalty, uint32_t spaceCount, HyphenationType type,
+                                uint32_t runIndex, uint32_t spaceCount, HyphenationType type,
                                 bool isRtl) {
-        candidates.emplace_back(offset, preBreak, postBreak, penalty, spaceCount, spaceCount, type,
-                                isRtl);
+        candidates.emplace_back(offset, preBreak, postBreak, runIndex, 1 /* penalty ratio */,
+                                spaceCount, spaceCount, type, isRtl);
     }
 
     // Append word break point to the candidates.
     inline void pushWordBreak(uint32_t offset, ParaWidth preBreak, ParaWidth postBreak,
-                              float penalty, uint32_t preSpaceCount, uint32_t postSpaceCount,
-                              bool isRtl) {
-        candidates.emplace_back(offset, preBreak, postBreak, penalty, preSpaceCount, postSpaceCount,
-                                HyphenationType::DONT_BREAK, isRtl);
+                              uint32_t runIndex, int penaltyRatio, uint32_t preSpaceCount,
+                              uint32_t postSpaceCount, bool isRtl) {
+        candidates.emplace_back(offset, preBreak, postBreak, runIndex, penaltyRatio, preSpaceCount,
+                                postSpaceCount, HyphenationType::DONT_BREAK, isRtl);
+    }
+
+    // Fills preBreaks and preSpaceCounts from the candidates.
+    void buildColumns() {
+        preBreaks.resize(candidates.size());
+        preSpaceCounts.resize(candidates.size());
+        for (uint32_t i = 0; i < candidates.size(); ++i) {
+            preBreaks[i] = candidates[i].preBreak;
+            preSpaceCounts[i] = candidates[i].preSpaceCount;
+        }
     }
 
     OptimizeContext() {
-        candidates.emplace_back(0, 0.0f, 0.0f, 0.0f, 0, 0, HyphenationType::DONT_BREAK, false);
+        candidates.emplace_back(0, 0.0f, 0.0f, 0, 0, 0, 0, HyphenationType::DONT_BREAK, false);
     }
 };
 
@@ -148,32 +199,47 @@ std::pair<float, float> computePenalties(const Run& run, const LineWidth& lineWi
     return std::make_pair(hyphenPenalty, linePenalty);
 }
 
-// Represents a desperate break point.
-struct DesperateBreak {
-    // The break offset.
-    uint32_t offset;
-
-    // The sum of the character width from the beginning of the word.
-    ParaWidth sumOfChars;
+// Computes the penalties of the candidates for the line width into out, and returns the penalty
+// for the number of lines.
+float computeCandidatePenalties(const OptimizeContext& context, const MeasuredText& measured,
+                                const LineWidth& lineWidth, HyphenationFrequency frequency,
+                                bool justified, std::vector<float>* out) {
+    float linePenalty = 0.0f;
+    std::vector<float> hyphenPenalties(measured.runs.size(), 0.0f);
+    for (uint32_t i = 0; i < measured.runs.size(); ++i) {
+        const Run& run = *measured.runs[i];
+        if (run.canBreak()) {
+            auto penalties = computePenalties(run, lineWidth, frequency, justified);
+            hyphenPenalties[i] = penalties.first;
+            linePenalty = std::max(penalties.second, linePenalty);
+        }
+    }
 
-    DesperateBreak(uint32_t offset, ParaWidth sumOfChars)
-            : offset(offset), sumOfChars(sumOfChars){};
-};
+    const std::vector<Candidate>& candidates = context.candidates;
+    out->resize(candidates.size());
+    (*out)[0] = 0.0f;
+    for (uint32_t i = 1; i < candidates.size(); ++i) {
+        const Candidate& cand = candidates[i];
+        (*out)[i] = cand.penaltyRatio == DESPERATE_PENALTY_RATIO
+                            ? SCORE_DESPERATE
+                            : hyphenPenalties[cand.runIndex] * cand.penaltyRatio;
+    }
+    return linePenalty;
+}
 
-// Retrieves desperate break points from a word.
-std::vector<DesperateBreak> populateDesperatePoints(const MeasuredText& measured,
-                                                    const Range& range) {
-    std::vector<DesperateBreak> out;
+// Retrieves desperate break points from a word into out, replacing its contents.
+void populateDesperatePoints(const MeasuredText& measured, const Range& range,
+                             std::vector<DesperateBreak>* out) {
+    out->clear();
     ParaWidth width = measured.widths[range.getStart()];
     for (uint32_t i = range.getStart() + 1; i < range.getEnd(); ++i) {
         const float w = measured.widths[i];
         if (w == 0) {
             continue;  // w == 0 means here is not a grapheme bounds. Don't break here.
         }
-        out.emplace_back(i, width);
+        out->emplace_back(i, width);
         width += w;
     }
-    return out;
 }
 
 // Append hyphenation break points and desperate break points.
@@ -185,18 +251,18 @@ std::vector<DesperateBreak> populateDesperatePoints(const MeasuredText& measured
 void appendWithMerging(std::vector<HyphenBreak>::const_iterator hyIter,
                        std::vector<HyphenBreak>::const_iterator endHyIter,
                        const std::vector<DesperateBreak>& desperates, const CharProcessor& proc,
-                       float hyphenPenalty, bool isRtl, OptimizeContext* out) {
+                       uint32_t runIndex, bool isRtl, OptimizeContext* out) {
     auto d = desperates.begin();
     while (hyIter != endHyIter || d != desperates.end()) {
         // If both hyphen breaks and desperate breaks point to the same offset, push desperate
         // breaks first.
         if (d != desperates.end() && (hyIter == endHyIter || d->offset <= hyIter->offset)) {
             out->pushDesperate(d->offset, proc.sumOfCharWidthsAtPrevWordBreak + d->sumOfChars,
-                               proc.effectiveSpaceCount, isRtl);
+                               proc.effectiveSpaceCount, runIndex, isRtl);
             d++;
         } else {
             out->pushHyphenation(hyIter->offset, proc.sumOfCharWidths - hyIter->second,
-                                 proc.sumOfCharWidthsAtPrevWordBreak + hyIter->first, hyphenPenalty,
+                                 proc.sumOfCharWidthsAtPrevWordBreak + hyIter->first, runIndex,
                                  proc.effectiveSpaceCount, hyIter->type, isRtl);
             hyIter++;
         }
@@ -205,28 +271,19 @@ void appendWithMerging(std::vector<HyphenBreak>::const_iterator hyIter,
 
 // Enumerate all line break candidates.
 OptimizeContext populateCandidates(const U16StringPiece& textBuf, const MeasuredText& measured,
-                                   const LineWidth& lineWidth, HyphenationFrequency frequency,
-                                   bool isJustified) {
-    const ParaWidth minLineWidth = lineWidth.getMin();
-    CharProcessor proc(textBuf);
+                                   ParaWidth minLineWidth, bool doHyphenation,
+                                   LineBreakScratch* scratch) {
+    CharProcessor proc(measured);
 
     OptimizeContext result;
 
-    const bool doHyphenation = frequency != HyphenationFrequency::None;
     auto hyIter = std::begin(measured.hyphenBreaks);
 
-    for (const auto& run : measured.runs) {
+    for (uint32_t runIndex = 0; runIndex < measured.runs.size(); ++runIndex) {
+        const auto& run = measured.runs[runIndex];
         const bool isRtl = run->isRtl();
         const Range& range = run->getRange();
 
-        // Compute penalty parameters.
-        float hyphenPenalty = 0.0f;
-        if (run->canBreak()) {
-            auto penalties = computePenalties(*run, lineWidth, frequency, isJustified);
-            hyphenPenalty = penalties.first;
-            result.linePenalty = std::max(penalties.second, result.linePenalty);
-        }
-
         proc.updateLocaleIfNecessary(*run);
 
         for (uint32_t i = range.getStart(); i < range.getEnd(); ++i) {
@@ -239,8 +296,7 @@ OptimizeContext populateCandidates(const U16StringPiece& textBuf, const Measured
             }
 
             // Add hyphenation and desperate break points.
-            std::vector<HyphenBreak> hyphenedBreaks;
-            std::vector<DesperateBreak> desperateBreaks;
+            std::vector<DesperateBreak>& desperateBreaks = scratch->desperateBreaks;
             const Range contextRange = proc.contextRange();
 
             auto beginHyIter = hyIter;
@@ -248,89 +304,332 @@ OptimizeContext populateCandidates(const U16StringPiece& textBuf, const Measured
                    hyIter->offset < contextRange.getEnd()) {
                 hyIter++;
             }
-            if (proc.widthFromLastWordBreak() > minLineWidth) {
-                desperateBreaks = populateDesperatePoints(measured, contextRange);
+            const ParaWidth wordWidth = proc.widthFromLastWordBreak();
+            if (wordWidth > minLineWidth) {
+                populateDesperatePoints(measured, contextRange, &desperateBreaks);
+                result.minLineWidthHigh = std::min(result.minLineWidthHigh, wordWidth);
+            } else {
+                desperateBreaks.clear();
+                result.minLineWidthLow = std::max(result.minLineWidthLow, wordWidth);
             }
             appendWithMerging(beginHyIter, doHyphenation ? hyIter : beginHyIter, desperateBreaks,
-                              proc, hyphenPenalty, isRtl, &result);
+                              proc, runIndex, isRtl, &result);
 
             // We skip breaks for zero-width characters inside replacement spans.
             if (run->getPaint() != nullptr || nextCharOffset == range.getEnd() ||
                 measured.widths[nextCharOffset] > 0) {
-                const float penalty = hyphenPenalty * proc.wordBreakPenalty();
                 result.pushWordBreak(nextCharOffset, proc.sumOfCharWidths, proc.effectiveWidth,
-                                     penalty, proc.rawSpaceCount, proc.effectiveSpaceCount, isRtl);
+                                     runIndex, proc.wordBreakPenalty(), proc.rawSpaceCount,
+                                     proc.effectiveSpaceCount, isRtl);
             }
         }
     }
     result.spaceWidth = proc.spaceWidth;
+    result.buildColumns();
     return result;
 }
 
+// Data used to compute optimal line breaks
+struct OptimalBreaksData {
+    float score;          // best score found for this break
+    uint32_t prev;        // index to previous break
+    uint32_t lineNumber;  // the computed line number of the candidate
+};
+
+// A line break optimization recorded for resuming it after the text is edited.
+struct OptimizeRecord {
+    // The inputs of the optimization other than the candidates.
+    std::vector<float> penalties;
+    float linePenalty = 0.0f;
+    float maxShrink = 0.0f;
+    bool justified = false;
+    // The line widths by the line number, up to the largest line number in breaksData.
+    std::vector<float> lineWidths;
+
+    std::vector<OptimalBreaksData> breaksData;
+    // The first candidate examined as the beginning of the line for each candidate. Empty if the
+    // optimization can't be resumed.
+    std::vector<uint32_t> firstActive;
+};
+
 class LineBreakOptimizer {
 public:
     LineBreakOptimizer() {}
 
-    LineBreakResult computeBreaks(const OptimizeContext& context, const U16StringPiece& textBuf,
-                                  const MeasuredText& measuredText, const LineWidth& lineWidth,
-                                  BreakStrategy strategy, bool justified);
+    // Computes the line breaks. If record is not null, the computation resumes from the first
+    // candidate whose breaks data may differ from the recorded ones, given that the first
+    // unchangedCount candidates are the same as the ones the record was computed for. Then the
+    // computation is recorded to it. Only the first maxLines lines are returned, and their extents
+    // and flags are left zero unless computeLineInfo is true.
+    std::vector<LineRecord> computeBreaks(const OptimizeContext& context,
+                                          const U16StringPiece& textBuf,
+                                          const MeasuredText& measuredText,
+                                          const LineWidth& lineWidth, BreakStrategy strategy,
+                                          HyphenationFrequency frequency, bool justified,
+                                          uint32_t unchangedCount, OptimizeRecord* record,
+                                          uint32_t maxLines, bool computeLineInfo);
+
+    // Returns the number of lines computeBreaks returns for all the lines, without building them.
+    uint32_t countLines(const OptimizeContext& context, const MeasuredText& measuredText,
+                        const LineWidth& lineWidth, BreakStrategy strategy,
+                        HyphenationFrequency frequency, bool justified);
+
+    // Computes the breaks data of the candidates into the record. If resume is true, the
+    // computation resumes from the first candidate whose breaks data may differ from the ones in
+    // the record, given that the first unchangedCount candidates are the same as the ones the
+    // record was computed for.
+    void optimize(const OptimizeContext& context, std::vector<float>&& penalties,
+                  float linePenalty, const LineWidth& lineWidth, BreakStrategy strategy,
+                  bool justified, uint32_t unchangedCount, bool resume, OptimizeRecord* record);
 
 private:
-    // Data used to compute optimal line breaks
-    struct OptimalBreaksData {
-        float score;          // best score found for this break
-        uint32_t prev;        // index to previous break
-        uint32_t lineNumber;  // the computed line number of the candidate
-    };
-    LineBreakResult finishBreaksOptimal(const U16StringPiece& textBuf, const MeasuredText& measured,
-                                        const std::vector<OptimalBreaksData>& breaksData,
-                                        const std::vector<Candidate>& candidates);
+    std::vector<LineRecord> finishBreaksOptimal(const U16StringPiece& textBuf,
+                                                const MeasuredText& measured,
+                                                const std::vector<OptimalBreaksData>& breaksData,
+                                                const std::vector<Candidate>& candidates,
+                                                uint32_t maxLines, bool computeLineInfo);
+
+    // Fills the breaks data for all candidates except for the last one, for the constant line
+    // width and non-justified text, and sets the first candidate that can begin the last line to
+    // active. Returns false if an overfull line is necessary. The caller must discard the breaks
+    // data and fall back to the general algorithm in that case.
+    bool computeBreaksConstantWidth(const OptimizeContext& context,
+                                    const std::vector<float>& penalties, float linePenalty,
+                                    float width, std::vector<OptimalBreaksData>* breaksData,
+                                    uint32_t* active);
 };
 
+// Returns true if computeBreaksConstantWidth can be used for the candidates.
+//
+// Both preBreak and postBreak must never decrease as the candidate offset increases. This usually
+// holds, but not always, e.g. a hyphen can be wider than the following letter. Also, desperate
+// breaks must not exist since their huge penalty absorbs the width scores in float precision and
+// makes the choice depend on the order of the comparisons.
+//
+// In addition, preBreak must strictly increase, e.g. no zero width word. computeBreaks prunes a
+// beginning of the line whose score can't be better than the best so far by assuming the width
+// score of the previous beginning. If two beginnings have the same preBreak, that assumption is
+// exact and the earlier one wins a tie, while a later beginning wins any other tie.
+bool canUseConstantWidthSolver(const std::vector<Candidate>& candidates,
+                               const std::vector<float>& penalties) {
+    for (uint32_t i = 1; i < candidates.size(); ++i) {
+        if (candidates[i].preBreak <= candidates[i - 1].preBreak ||
+            candidates[i].postBreak < candidates[i - 1].postBreak ||
+            penalties[i] >= SCORE_DESPERATE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Computes the scores of the lines ending at a candidate other than the last one and beginning at
+// SCORE_LANES consecutive candidates, whose preBreak and preSpaceCount are given. The results are
+// the same as the ones computeBreaks computes for each candidate, but the loop has no branches so
+// that it can be vectorized.
+inline void computeWidthScores(const ParaWidth* preBreaks, const uint32_t* preSpaceCounts,
+                               ParaWidth leftEdge, uint32_t postSpaceCount, float maxShrink,
+                               float* deltas, float* widthScores) {
+    for (uint32_t k = 0; k < SCORE_LANES; ++k) {
+        const float delta = preBreaks[k] - leftEdge;
+        const float widthScore = delta * delta;
+        // maxShrink is 0 unless justified, so that the line never shrinks.
+        const bool canShrink = -delta < maxShrink * (postSpaceCount - preSpaceCounts[k]);
+        deltas[k] = delta;
+        widthScores[k] = delta >= 0 ? widthScore
+                                    : (canShrink ? widthScore * SHRINK_PENALTY_MULTIPLIER
+                                                 : SCORE_OVERFULL);
+    }
+}
+
+// SIMD vectors of SCORE_LANES values. Most of the candidates are pruned by bestHope, so testing
+// them a vector at a time matters more than the scoring. Both GCC and Clang support these vectors
+// on all architectures, falling back to scalar instructions if necessary.
+typedef float ScoreLanes __attribute__((vector_size(SCORE_LANES * sizeof(float))));
+typedef uint32_t LineNumberLanes __attribute__((vector_size(SCORE_LANES * sizeof(uint32_t))));
+typedef int32_t MaskLanes __attribute__((vector_size(SCORE_LANES * sizeof(int32_t))));
+
+// Returns true if any lane of the comparison result is true.
+inline bool anyLane(MaskLanes mask) {
+    uint64_t halves[2];
+    static_assert(sizeof(halves) == sizeof(mask), "SCORE_LANES must be 4");
+    memcpy(halves, &mask, sizeof(mask));
+    return (halves[0] | halves[1]) != 0;
+}
+
+// Returns true if all the given SCORE_LANES line numbers are the same as lineNumber.
+inline bool isAtLine(const uint32_t* lineNumbers, uint32_t lineNumber) {
+    LineNumberLanes lanes;
+    memcpy(&lanes, lineNumbers, sizeof(lanes));
+    return !anyLane(lanes != lineNumber);
+}
+
+// Returns true if any of the given SCORE_LANES scores is not pruned by bestHope.
+inline bool hasHope(const float* scores, float bestHope, float best) {
+    ScoreLanes lanes;
+    memcpy(&lanes, scores, sizeof(lanes));
+    return anyLane(lanes + bestHope < best);
+}
+
+// Returns the first candidate whose breaks data may differ from the record, given that the first
+// unchangedCount candidates are the same as the ones the record was computed for. The breaks data
+// of a candidate only depends on the preceding candidates, its penalty and the widths of the lines
+// that the preceding candidates begin.
+uint32_t findFirstChangedCandidate(const OptimizeRecord& record, uint32_t unchangedCount,
+                                   const std::vector<float>& penalties, float linePenalty,
+                                   float maxShrink, bool justified, const LineWidth& lineWidth) {
+    if (record.firstActive.empty() || record.linePenalty != linePenalty ||
+        record.maxShrink != maxShrink || record.justified != justified) {
+        return 1;
+    }
+    uint32_t firstChangedLine = 0;
+    while (firstChangedLine < record.lineWidths.size() &&
+           lineWidth.getAt(firstChangedLine) == record.lineWidths[firstChangedLine]) {
+        firstChangedLine++;
+    }
+
+    // The last candidate is scored differently from the others, so it is always recomputed.
+    const uint32_t end = std::min({unchangedCount, static_cast<uint32_t>(penalties.size()) - 1,
+                                   static_cast<uint32_t>(record.breaksData.size()) - 1});
+    uint32_t maxLineNumber = 0;
+    uint32_t i = 1;
+    for (; i < end; ++i) {
+        maxLineNumber = std::max(maxLineNumber, record.breaksData[i - 1].lineNumber);
+        if (maxLineNumber >= firstChangedLine || penalties[i] != record.penalties[i]) {
+            break;
+        }
+    }
+    return i;
+}
+
 // Follow "prev" links in candidates array, and copy to result arrays.
-LineBreakResult LineBreakOptimizer::finishBreaksOptimal(
+std::vector<LineRecord> LineBreakOptimizer::finishBreaksOptimal(
         const U16StringPiece& textBuf, const MeasuredText& measured,
-        const std::vector<OptimalBreaksData>& breaksData,
-        const std::vector<Candidate>& candidates) {
-    LineBreakResult result;
-    const uint32_t nCand = candidates.size();
-    uint32_t prevIndex;
-    for (uint32_t i = nCand - 1; i > 0; i = prevIndex) {
-        prevIndex = breaksData[i].prev;
+        const std::vector<OptimalBreaksData>& breaksData, const std::vector<Candidate>& candidates,
+        uint32_t maxLines, bool computeLineInfo) {
+    // The line number of the last candidate is the number of lines. Find the line ends by
+    // following the previous breaks from the last candidate, then fill the lines in the order.
+    const uint32_t lineCount = breaksData.back().lineNumber;
+    std::vector<uint32_t> lineEnds(lineCount);
+    uint32_t lineIndex = lineCount;
+    for (uint32_t i = candidates.size() - 1; i > 0; i = breaksData[i].prev) {
+        MINIKIN_ASSERT(lineIndex > 0, "The line count must match the line number");
+        lineEnds[--lineIndex] = i;
+    }
+
+    lineEnds.resize(std::min(lineCount, maxLines));
+    std::vector<LineRecord> lines;
+    lines.reserve(lineEnds.size());
+    uint32_t prevIndex = 0;
+    for (uint32_t i : lineEnds) {
         const Candidate& cand = candidates[i];
         const Candidate& prev = candidates[prevIndex];
-
-        result.breakPoints.push_back(cand.offset);
-        result.widths.push_back(cand.postBreak - prev.preBreak);
-        MinikinExtent extent = measured.getExtent(textBuf, Range(prev.offset, cand.offset));
-        result.ascents.push_back(extent.ascent);
-        result.descents.push_back(extent.descent);
-
+        if (!computeLineInfo) {
+            lines.emplace_back(cand.offset, cand.postBreak - prev.preBreak, 0.0f, 0.0f, 0);
+            prevIndex = i;
+            continue;
+        }
+        const MinikinExtent extent = measured.getExtent(textBuf, Range(prev.offset, cand.offset));
         const HyphenEdit edit =
                 packHyphenEdit(editForNextLine(prev.hyphenType), editForThisLine(cand.hyphenType));
-        result.flags.push_back(static_cast<int>(edit));
+        lines.emplace_back(cand.offset, cand.postBreak - prev.preBreak, extent.ascent,
+                           extent.descent, static_cast<int>(edit));
+        prevIndex = i;
     }
-    result.reverse();
-    return result;
+    return lines;
+}
+
+std::vector<LineRecord> LineBreakOptimizer::computeBreaks(
+        const OptimizeContext& context, const U16StringPiece& textBuf, const MeasuredText& measured,
+        const LineWidth& lineWidth, BreakStrategy strategy, HyphenationFrequency frequency,
+        bool justified, uint32_t unchangedCount, OptimizeRecord* record, uint32_t maxLines,
+        bool computeLineInfo) {
+    std::vector<float> penalties;
+    const float linePenalty = computeCandidatePenalties(context, measured, lineWidth, frequency,
+                                                        justified, &penalties);
+    OptimizeRecord localRecord;
+    OptimizeRecord* out = record != nullptr ? record : &localRecord;
+    optimize(context, std::move(penalties), linePenalty, lineWidth, strategy, justified,
+             unchangedCount, record != nullptr /* resume */, out);
+    return finishBreaksOptimal(textBuf, measured, out->breaksData, context.candidates, maxLines,
+                               computeLineInfo);
 }
 
-LineBreakResult LineBreakOptimizer::computeBreaks(const OptimizeContext& context,
-                                                  const U16StringPiece& textBuf,
-                                                  const MeasuredText& measured,
-                                                  const LineWidth& lineWidth,
-                                                  BreakStrategy strategy, bool justified) {
+uint32_t LineBreakOptimizer::countLines(const OptimizeContext& context,
+                                        const MeasuredText& measured, const LineWidth& lineWidth,
+                                        BreakStrategy strategy, HyphenationFrequency frequency,
+                                        bool justified) {
+    std::vector<float> penalties;
+    const float linePenalty = computeCandidatePenalties(context, measured, lineWidth, frequency,
+                                                        justified, &penalties);
+    OptimizeRecord record;
+    optimize(context, std::move(penalties), linePenalty, lineWidth, strategy, justified,
+             0 /* unchanged count */, false /* resume */, &record);
+    // The line number of the last candidate is the number of lines.
+    return record.breaksData.back().lineNumber;
+}
+
+void LineBreakOptimizer::optimize(const OptimizeContext& context, std::vector<float>&& penalties,
+                                  float linePenalty, const LineWidth& lineWidth,
+                                  BreakStrategy strategy, bool justified, uint32_t unchangedCount,
+                                  bool resume, OptimizeRecord* record) {
     const std::vector<Candidate>& candidates = context.candidates;
     uint32_t active = 0;
     const uint32_t nCand = candidates.size();
     const float maxShrink = justified ? SHRINKABILITY * context.spaceWidth : 0.0f;
 
     std::vector<OptimalBreaksData> breaksData;
+    std::vector<uint32_t> firstActive;
+    uint32_t first = 1;
+    if (resume) {
+        first = findFirstChangedCandidate(*record, unchangedCount, penalties, linePenalty,
+                                          maxShrink, justified, lineWidth);
+        if (first > 1) {
+            active = record->firstActive[first];
+            breaksData = std::move(record->breaksData);
+            breaksData.resize(first);
+            firstActive = std::move(record->firstActive);
+            firstActive.resize(first);
+        }
+    }
+    if (first == 1) {
+        breaksData.push_back({0.0, 0, 0});  // The first candidate is always at the first line.
+        firstActive.push_back(0);
+    }
     breaksData.reserve(nCand);
-    breaksData.push_back({0.0, 0, 0});  // The first candidate is always at the first line.
+
+    bool resumable = resume;
+    if (first == 1 && nCand > 2 && !justified && lineWidth.isConstant() &&
+        canUseConstantWidthSolver(candidates, penalties)) {
+        if (computeBreaksConstantWidth(context, penalties, linePenalty, lineWidth.getAt(0),
+                                       &breaksData, &active)) {
+            first = nCand - 1;  // Only the last line is left to the loop below.
+            resumable = false;
+        } else {
+            breaksData.resize(1);
+            active = 0;
+        }
+    }
+    if (resumable) {
+        firstActive.reserve(nCand);
+    }
+
+    // The scores and the line numbers in separate arrays for scoring SCORE_LANES candidates at
+    // once. These are kept in sync with breaksData.
+    std::vector<float> scores(breaksData.size());
+    std::vector<uint32_t> lineNumbers(breaksData.size());
+    for (uint32_t i = 0; i < breaksData.size(); ++i) {
+        scores[i] = breaksData[i].score;
+        lineNumbers[i] = breaksData[i].lineNumber;
+    }
+    scores.reserve(nCand);
+    lineNumbers.reserve(nCand);
 
     // "i" iterates through candidates for the end of the line.
-    for (uint32_t i = 1; i < nCand; i++) {
+    for (uint32_t i = first; i < nCand; i++) {
         const bool atEnd = i == nCand - 1;
+        if (resumable) {
+            firstActive.push_back(active);
+        }
         float best = SCORE_INFTY;
         uint32_t bestPrev = 0;
 
@@ -340,77 +639,589 @@ LineBreakResult LineBreakOptimizer::computeBreaks(const OptimizeContext& context
         ParaWidth leftEdge = candidates[i].postBreak - width;
         float bestHope = 0;
 
-        // "j" iterates through candidates for the beginning of the line.
-        for (uint32_t j = active; j < i; j++) {
-            const uint32_t lineNumber = breaksData[j].lineNumber;
-            if (lineNumber != lineNumberLast) {
-                const float widthNew = lineWidth.getAt(lineNumber);
-                if (widthNew != width) {
-                    leftEdge = candidates[i].postBreak - width;
-                    bestHope = 0;
-                    width = widthNew;
+        // "j" iterates through candidates for the beginning of the line, SCORE_LANES candidates
+        // at a time if useLanes is true.
+        const bool useLanes = !atEnd && i - active >= MIN_LANES_SCAN_LENGTH &&
+                              gScoreLanesEnabled.load(std::memory_order_relaxed);
+        const uint32_t stride = useLanes ? SCORE_LANES : i - active;
+        for (uint32_t j = active; j < i;) {
+            const uint32_t blockEnd = std::min(i, j + stride);
+            if (useLanes && blockEnd - j == SCORE_LANES &&
+                isAtLine(&lineNumbers[j], lineNumberLast)) {
+                // The lines beginning at these candidates have the same width, so score them at
+                // once. The scores are consumed in the same order as below, so the pruning and
+                // the tie-breaking are unchanged.
+                if (hasHope(&scores[j], bestHope, best)) {
+                    float deltas[SCORE_LANES];
+                    float widthScores[SCORE_LANES];
+                    computeWidthScores(&context.preBreaks[j], &context.preSpaceCounts[j], leftEdge,
+                                       candidates[i].postSpaceCount, maxShrink, deltas,
+                                       widthScores);
+                    for (uint32_t k = 0; k < SCORE_LANES; k++) {
+                        const float jScore = scores[j + k];
+                        if (jScore + bestHope >= best) continue;
+                        if (deltas[k] < 0) {
+                            active = j + k + 1;
+                        } else {
+                            bestHope = widthScores[k];
+                        }
+                        const float score = jScore + widthScores[k];
+                        if (score <= best) {
+                            best = score;
+                            bestPrev = j + k;
+                        }
+                    }
                 }
-                lineNumberLast = lineNumber;
+                // Otherwise, all of them are pruned since a pruned candidate changes nothing.
+                j = blockEnd;
+                continue;
             }
-            const float jScore = breaksData[j].score;
-            if (jScore + bestHope >= best) continue;
-            const float delta = candidates[j].preBreak - leftEdge;
-
-            // compute width score for line
-
-            // Note: the "bestHope" optimization makes the assumption that, when delta is
-            // non-negative, widthScore will increase monotonically as successive candidate
-            // breaks are considered.
-            float widthScore = 0.0f;
-            float additionalPenalty = 0.0f;
-            if ((atEnd || !justified) && delta < 0) {
-                widthScore = SCORE_OVERFULL;
-            } else if (atEnd && strategy != BreakStrategy::Balanced) {
-                // increase penalty for hyphen on last line
-                additionalPenalty = LAST_LINE_PENALTY_MULTIPLIER * candidates[j].penalty;
-            } else {
-                widthScore = delta * delta;
-                if (delta < 0) {
-                    if (-delta <
-                        maxShrink * (candidates[i].postSpaceCount - candidates[j].preSpaceCount)) {
-                        widthScore *= SHRINK_PENALTY_MULTIPLIER;
-                    } else {
-                        widthScore = SCORE_OVERFULL;
+
+            for (; j < blockEnd; j++) {
+                const uint32_t lineNumber = breaksData[j].lineNumber;
+                if (lineNumber != lineNumberLast) {
+                    const float widthNew = lineWidth.getAt(lineNumber);
+                    if (widthNew != width) {
+                        leftEdge = candidates[i].postBreak - width;
+                        bestHope = 0;
+                        width = widthNew;
                     }
+                    lineNumberLast = lineNumber;
+                }
+                const float jScore = breaksData[j].score;
+                if (jScore + bestHope >= best) continue;
+                const float delta = candidates[j].preBreak - leftEdge;
+
+                // compute width score for line
+
+                // Note: the "bestHope" optimization makes the assumption that, when delta is
+                // non-negative, widthScore will increase monotonically as successive candidate
+                // breaks are considered.
+                float widthScore = 0.0f;
+                float additionalPenalty = 0.0f;
+                if ((atEnd || !justified) && delta < 0) {
+                    widthScore = SCORE_OVERFULL;
+                } else if (atEnd && strategy != BreakStrategy::Balanced) {
+                    // increase penalty for hyphen on last line
+                    additionalPenalty = LAST_LINE_PENALTY_MULTIPLIER * penalties[j];
+                } else {
+                    widthScore = delta * delta;
+                    if (delta < 0) {
+                        if (-delta < maxShrink * (candidates[i].postSpaceCount -
+                                                  candidates[j].preSpaceCount)) {
+                            widthScore *= SHRINK_PENALTY_MULTIPLIER;
+                        } else {
+                            widthScore = SCORE_OVERFULL;
+                        }
+                    }
+                }
+
+                if (delta < 0) {
+                    active = j + 1;
+                } else {
+                    bestHope = widthScore;
+                }
+
+                const float score = jScore + widthScore + additionalPenalty;
+                if (score <= best) {
+                    best = score;
+                    bestPrev = j;
                 }
             }
+        }
+        breaksData.push_back({best + penalties[i] + linePenalty,     // score
+                              bestPrev,                               // prev
+                              breaksData[bestPrev].lineNumber + 1});  // lineNumber
+        scores.push_back(breaksData.back().score);
+        lineNumbers.push_back(breaksData.back().lineNumber);
+    }
 
-            if (delta < 0) {
-                active = j + 1;
-            } else {
-                bestHope = widthScore;
+    uint32_t maxLineNumber = 0;
+    for (const OptimalBreaksData& data : breaksData) {
+        maxLineNumber = std::max(maxLineNumber, data.lineNumber);
+    }
+    record->lineWidths.resize(maxLineNumber + 1);
+    for (uint32_t i = 0; i <= maxLineNumber; ++i) {
+        record->lineWidths[i] = lineWidth.getAt(i);
+    }
+    record->penalties = std::move(penalties);
+    record->linePenalty = linePenalty;
+    record->maxShrink = maxShrink;
+    record->justified = justified;
+    record->breaksData = std::move(breaksData);
+    if (resumable) {
+        record->firstActive = std::move(firstActive);
+    } else {
+        record->firstActive.clear();
+    }
+}
+
+// For the lines other than the last one, breaking at candidate i after candidate j costs
+//     score(j) + (preBreak(j) - (postBreak(i) - width))^2
+// unless the line is overfull. Since both preBreak and postBreak are non-decreasing, this cost
+// satisfies the quadrangle inequality: once a later j is at least as good as an earlier one for
+// some i, it stays so for all the following i. Following Hirschberg and Larmore, we keep a queue
+// of candidates, each of which is the best beginning of the line for a contiguous range of the
+// upcoming line ends, and binary-search where a newly scored candidate takes over. This makes the
+// whole computation O(n log n) instead of the O(n^2) worst case of the loop in computeBreaks.
+//
+// The scores and tie-breaking (a later candidate wins on the same score) are the same as
+// computeBreaks so that the both produce the same breaks, given that preBreak strictly increases
+// as checked by canUseConstantWidthSolver. The only exception is a tie that only appears after
+// rounding, where computeBreaks may keep the earlier candidate since it compares the score with
+// the width score of a preceding candidate instead. Overfull lines are not handled here since
+// their huge score breaks the above property in float precision.
+bool LineBreakOptimizer::computeBreaksConstantWidth(const OptimizeContext& context,
+                                                    const std::vector<float>& penalties,
+                                                    float linePenalty, float width,
+                                                    std::vector<OptimalBreaksData>* breaksData,
+                                                    uint32_t* active) {
+    const std::vector<Candidate>& candidates = context.candidates;
+    const uint32_t lastCand = candidates.size() - 1;
+
+    // Returns the score of the line from j to i, or SCORE_INFTY if the line is overfull.
+    auto fitScore = [&](uint32_t j, uint32_t i) -> float {
+        const ParaWidth leftEdge = candidates[i].postBreak - width;
+        const float delta = candidates[j].preBreak - leftEdge;
+        if (delta < 0) {
+            return SCORE_INFTY;
+        }
+        const float widthScore = delta * delta;
+        return (*breaksData)[j].score + widthScore;
+    };
+
+    // Pairs of the candidate index and the first line end for which it is the best.
+    std::vector<std::pair<uint32_t, uint32_t>> queue;
+    queue.reserve(lastCand);
+    size_t head = 0;
+
+    for (uint32_t i = 1; i < lastCand; i++) {
+        // The candidate i - 1 is now scored. Add it to the queue.
+        const uint32_t j = i - 1;
+        while (true) {
+            if (head == queue.size()) {
+                queue.emplace_back(j, i);
+                break;
+            }
+            const uint32_t k = queue.back().first;
+            const uint32_t start = std::max(queue.back().second, i);
+            if (fitScore(j, start) <= fitScore(k, start)) {
+                queue.pop_back();
+                continue;
             }
+            uint32_t lo = start + 1;
+            uint32_t hi = lastCand;
+            while (lo < hi) {
+                const uint32_t mid = lo + (hi - lo) / 2;
+                if (fitScore(j, mid) <= fitScore(k, mid)) {
+                    hi = mid;
+                } else {
+                    lo = mid + 1;
+                }
+            }
+            if (lo < lastCand) {
+                queue.emplace_back(j, lo);
+            }
+            break;
+        }
+        while (head + 1 < queue.size() && queue[head + 1].second <= i) {
+            head++;
+        }
 
-            const float score = jScore + widthScore + additionalPenalty;
-            if (score <= best) {
-                best = score;
-                bestPrev = j;
+        // Skip the candidates that can no longer begin a line without overflowing. Since the line
+        // end only moves forward, each candidate is visited here at most once.
+        const ParaWidth leftEdge = candidates[i].postBreak - width;
+        for (; *active < i; (*active)++) {
+            const float delta = candidates[*active].preBreak - leftEdge;
+            if (delta >= 0) {
+                break;
             }
         }
-        breaksData.push_back({best + candidates[i].penalty + context.linePenalty,  // score
-                              bestPrev,                                            // prev
-                              breaksData[bestPrev].lineNumber + 1});               // lineNumber
+
+        const uint32_t bestPrev = queue[head].first;
+        const float best = fitScore(bestPrev, i);
+        if (best == SCORE_INFTY) {
+            return false;
+        }
+        breaksData->push_back({best + penalties[i] + linePenalty,        // score
+                               bestPrev,                                 // prev
+                               (*breaksData)[bestPrev].lineNumber + 1});  // lineNumber
     }
-    return finishBreaksOptimal(textBuf, measured, breaksData, candidates);
+    return true;
 }
 
+// The properties of a run that the candidates depend on.
+struct RunInfo {
+    Range range;
+    uint32_t localeListId;
+    bool isRtl;
+    bool canBreak;
+    bool hasPaint;
+
+    explicit RunInfo(const Run& run)
+            : range(run.getRange()),
+              localeListId(run.getLocaleListId()),
+              isRtl(run.isRtl()),
+              canBreak(run.canBreak()),
+              hasPaint(run.getPaint() != nullptr) {}
+
+    bool operator==(const RunInfo& o) const {
+        return range == o.range && localeListId == o.localeListId && isRtl == o.isRtl &&
+               canBreak == o.canBreak && hasPaint == o.hasPaint;
+    }
+};
+
+// A copy of the inputs of populateCandidates other than the minimum line width, for checking if
+// the candidates populated from them can be reused.
+struct CandidateInputs {
+    std::vector<uint16_t> text;
+    std::vector<float> widths;
+    std::vector<HyphenBreak> hyphenBreaks;
+    std::vector<RunInfo> runs;
+    bool doHyphenation = false;
+
+    bool matches(const U16StringPiece& textBuf, const MeasuredText& measured,
+                 bool doHyphenation) const {
+        if (this->doHyphenation != doHyphenation || text.size() != textBuf.size() ||
+            !std::equal(text.begin(), text.end(), textBuf.data()) || widths != measured.widths ||
+            runs.size() != measured.runs.size()) {
+            return false;
+        }
+        for (uint32_t i = 0; i < runs.size(); ++i) {
+            if (!(runs[i] == RunInfo(*measured.runs[i]))) {
+                return false;
+            }
+        }
+        return std::equal(hyphenBreaks.begin(), hyphenBreaks.end(), measured.hyphenBreaks.begin(),
+                          measured.hyphenBreaks.end(),
+                          [](const HyphenBreak& l, const HyphenBreak& r) {
+                              return l.offset == r.offset && l.type == r.type &&
+                                     l.first == r.first && l.second == r.second;
+                          });
+    }
+
+    void assign(const U16StringPiece& textBuf, const MeasuredText& measured, bool doHyphenation) {
+        text.assign(textBuf.data(), textBuf.data() + textBuf.size());
+        widths = measured.widths;
+        hyphenBreaks = measured.hyphenBreaks;
+        runs.clear();
+        for (const auto& run : measured.runs) {
+            runs.emplace_back(*run);
+        }
+        this->doHyphenation = doHyphenation;
+    }
+};
+
+// The line widths after the given number of lines, for optimizing the rest of the paragraph as if
+// it begins at the first uncommitted line. This is never constant so that the optimization can be
+// resumed.
+class ShiftedLineWidth : public LineWidth {
+public:
+    ShiftedLineWidth(const LineWidth& base, uint32_t shift) : mBase(base), mShift(shift) {}
+
+    float getAt(size_t lineNo) const override { return mBase.getAt(lineNo + mShift); }
+    float getMin() const override { return mBase.getMin(); }
+
+private:
+    const LineWidth& mBase;
+    const uint32_t mShift;
+};
+
 }  // namespace
 
-LineBreakResult breakLineOptimal(const U16StringPiece& textBuf, const MeasuredText& measured,
-                                 const LineWidth& lineWidth, BreakStrategy strategy,
-                                 HyphenationFrequency frequency, bool justified) {
+struct LineBreakerCache::State {
+    CandidateInputs inputs;
+    OptimizeContext context;
+    OptimizeRecord record;
+};
+
+LineBreakerCache::LineBreakerCache() {}
+
+LineBreakerCache::~LineBreakerCache() {}
+
+void LineBreakerCache::clear() {
+    mState.reset();
+}
+
+void setScoreLanesEnabledForTesting(bool enabled) {
+    gScoreLanesEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+std::vector<LineRecord> breakLineOptimal(const U16StringPiece& textBuf,
+                                         const MeasuredText& measured, const LineWidth& lineWidth,
+                                         BreakStrategy strategy, HyphenationFrequency frequency,
+                                         bool justified) {
+    return breakLineOptimal(textBuf, measured, lineWidth, strategy, frequency, justified,
+                            nullptr /* no cache */);
+}
+
+std::vector<LineRecord> breakLineOptimal(const U16StringPiece& textBuf,
+                                         const MeasuredText& measured, const LineWidth& lineWidth,
+                                         BreakStrategy strategy, HyphenationFrequency frequency,
+                                         bool justified, LineBreakerCache* cache) {
+    return breakLineOptimal(textBuf, measured, lineWidth, strategy, frequency, justified, cache,
+                            std::numeric_limits<uint32_t>::max(), true /* compute line info */);
+}
+
+std::vector<LineRecord> breakLineOptimal(const U16StringPiece& textBuf,
+                                         const MeasuredText& measured, const LineWidth& lineWidth,
+                                         BreakStrategy strategy, HyphenationFrequency frequency,
+                                         bool justified, LineBreakerCache* cache,
+                                         uint32_t maxLines, bool computeLineInfo) {
+    if (textBuf.size() == 0 || maxLines == 0) {
+        return std::vector<LineRecord>();
+    }
+    const ParaWidth minLineWidth = lineWidth.getMin();
+    const bool doHyphenation = frequency != HyphenationFrequency::None;
+    LineBreakOptimizer optimizer;
+    LineBreakScratch scratch;
+    if (cache == nullptr) {
+        const OptimizeContext context =
+                populateCandidates(textBuf, measured, minLineWidth, doHyphenation, &scratch);
+        return optimizer.computeBreaks(context, textBuf, measured, lineWidth, strategy, frequency,
+                                       justified, 0 /* unchanged count */, nullptr /* record */,
+                                       maxLines, computeLineInfo);
+    }
+
+    if (cache->mState == nullptr) {
+        cache->mState = std::make_unique<LineBreakerCache::State>();
+    }
+    LineBreakerCache::State& state = *cache->mState;
+    uint32_t unchangedCount = state.context.candidates.size();
+    if (!state.inputs.matches(textBuf, measured, doHyphenation) ||
+        !state.context.isValidFor(minLineWidth)) {
+        OptimizeContext context =
+                populateCandidates(textBuf, measured, minLineWidth, doHyphenation, &scratch);
+        const std::vector<Candidate>& prev = state.context.candidates;
+        unchangedCount = std::mismatch(prev.begin(), prev.end(), context.candidates.begin(),
+                                       context.candidates.end())
+                                 .first -
+                         prev.begin();
+        state.context = std::move(context);
+        state.inputs.assign(textBuf, measured, doHyphenation);
+    }
+    return optimizer.computeBreaks(state.context, textBuf, measured, lineWidth, strategy, frequency,
+                                   justified, unchangedCount, &state.record, maxLines,
+                                   computeLineInfo);
+}
+
+uint32_t countLinesOptimal(const U16StringPiece& textBuf, const MeasuredText& measured,
+                           const LineWidth& lineWidth, BreakStrategy strategy,
+                           HyphenationFrequency frequency, bool justified) {
     if (textBuf.size() == 0) {
-        return LineBreakResult();
+        return 0;
     }
+    LineBreakOptimizer optimizer;
+    LineBreakScratch scratch;
     const OptimizeContext context =
-            populateCandidates(textBuf, measured, lineWidth, frequency, justified);
+            populateCandidates(textBuf, measured, lineWidth.getMin(),
+                               frequency != HyphenationFrequency::None, &scratch);
+    return optimizer.countLines(context, measured, lineWidth, strategy, frequency, justified);
+}
+
+struct StreamingLineBreaker::State {
+    State(const LineWidth& lineWidth, BreakStrategy strategy, HyphenationFrequency frequency,
+          bool justified)
+            : lineWidth(lineWidth), strategy(strategy), frequency(frequency), justified(justified) {
+        penalties.push_back(0.0f);
+        extents.emplace_back();
+    }
+
+    const LineWidth& lineWidth;
+    const BreakStrategy strategy;
+    const HyphenationFrequency frequency;
+    const bool justified;
+
+    // The uncommitted candidates, beginning at the end of the last committed line. The offsets and
+    // the widths are from the beginning of the paragraph.
+    OptimizeContext context;
+    // The penalty of each candidate, and the extent of the text from the previous candidate.
+    std::vector<float> penalties;
+    std::vector<MinikinExtent> extents;
+    float linePenalty = 0.0f;
+    OptimizeRecord record;
+    LineBreakScratch scratch;
+
+    // The offset of the next window in the paragraph.
+    uint32_t textOffset = 0;
+    uint32_t committedLineCount = 0;
+    std::vector<LineRecord> lines;
+
+    void append(const U16StringPiece& window, const MeasuredText& measured);
+    void commitLines(uint32_t end);
+    void commitFinishedLines();
+};
+
+// Appends the candidates of the window, dropping the one at the beginning of the window since it
+// is the same as the last candidate.
+void StreamingLineBreaker::State::append(const U16StringPiece& window,
+                                         const MeasuredText& measured) {
+    const OptimizeContext windowContext =
+            populateCandidates(window, measured, lineWidth.getMin(),
+                               frequency != HyphenationFrequency::None, &scratch);
+    std::vector<float> windowPenalties;
+    linePenalty = std::max(linePenalty,
+                           computeCandidatePenalties(windowContext, measured, lineWidth, frequency,
+                                                     justified, &windowPenalties));
+    if (context.spaceWidth == 0.0f) {
+        context.spaceWidth = windowContext.spaceWidth;
+    }
+
+    const Candidate last = context.candidates.back();
+    for (uint32_t i = 1; i < windowContext.candidates.size(); ++i) {
+        Candidate cand = windowContext.candidates[i];
+        extents.push_back(measured.getExtent(
+                window, Range(windowContext.candidates[i - 1].offset, cand.offset)));
+        cand.offset += textOffset;
+        cand.preBreak += last.preBreak;
+        cand.postBreak += last.preBreak;
+        cand.preSpaceCount += last.preSpaceCount;
+        cand.postSpaceCount += last.preSpaceCount;
+        context.candidates.push_back(cand);
+        penalties.push_back(windowPenalties[i]);
+    }
+    context.buildColumns();
+    textOffset += window.size();
+}
+
+// Commits the lines along the optimal breaks ending at the candidate end.
+void StreamingLineBreaker::State::commitLines(uint32_t end) {
+    const std::vector<OptimalBreaksData>& breaksData = record.breaksData;
+    const uint32_t lineCount = breaksData[end].lineNumber;
+    const uint32_t first = lines.size();
+    lines.resize(first + lineCount, LineRecord(0, 0.0f, 0.0f, 0.0f, 0));
+    uint32_t lineIndex = lineCount;
+    for (uint32_t i = end; i > 0; i = breaksData[i].prev) {
+        const uint32_t prevIndex = breaksData[i].prev;
+        const Candidate& cand = context.candidates[i];
+        const Candidate& prev = context.candidates[prevIndex];
+        MinikinExtent extent;
+        for (uint32_t j = prevIndex + 1; j <= i; ++j) {
+            extent.extendBy(extents[j]);
+        }
+        const HyphenEdit edit =
+                packHyphenEdit(editForNextLine(prev.hyphenType), editForThisLine(cand.hyphenType));
+        lines[first + --lineIndex] =
+                LineRecord(cand.offset, cand.postBreak - prev.preBreak, extent.ascent,
+                           extent.descent, static_cast<int>(edit));
+    }
+    committedLineCount += lineCount;
+}
+
+// Commits the lines shared by the optimal breaks of all the candidates that the following
+// candidates can break after, and discards the candidates before them.
+void StreamingLineBreaker::State::commitFinishedLines() {
+    const uint32_t nCand = context.candidates.size();
+    std::vector<OptimalBreaksData>& breaksData = record.breaksData;
+    if (nCand < 3 || breaksData.size() != nCand || record.firstActive.size() != nCand) {
+        return;
+    }
+
+    // The following candidates only break after the candidates in [active, nCand - 1), or the last
+    // one, whose breaks are recomputed from them. Find the latest candidate that all of their
+    // optimal breaks go through.
+    const uint32_t active = record.firstActive.back();
+    uint32_t common = active;
+    for (uint32_t i = active + 1; i < nCand - 1; ++i) {
+        uint32_t j = i;
+        while (j != common) {
+            if (j > common) {
+                j = breaksData[j].prev;
+            } else {
+                common = breaksData[common].prev;
+            }
+        }
+    }
+    if (common == 0) {
+        return;
+    }
+    commitLines(common);
+
+    // Rebase the optimization on the common candidate as if it were the beginning of the
+    // paragraph. The candidates not descending from it are never examined again. The scores are
+    // kept as they are, since the desperate break penalty absorbs the width scores in float
+    // precision and subtracting it would change the choices.
+    const OptimalBreaksData base = breaksData[common];
+    std::vector<bool> descends(nCand - common, false);
+    descends[0] = true;
+    for (uint32_t i = common + 1; i < nCand; ++i) {
+        const uint32_t prev = breaksData[i].prev;
+        descends[i - common] = prev >= common && descends[prev - common];
+        if (descends[i - common]) {
+            breaksData[i] = {breaksData[i].score, prev - common,
+                             breaksData[i].lineNumber - base.lineNumber};
+        } else {
+            breaksData[i] = {SCORE_INFTY, 0, 0};
+        }
+        record.firstActive[i] = std::max(record.firstActive[i], common) - common;
+    }
+    breaksData[common] = {base.score, 0, 0};
+    record.firstActive[common] = 0;
+
+    breaksData.erase(breaksData.begin(), breaksData.begin() + common);
+    record.firstActive.erase(record.firstActive.begin(), record.firstActive.begin() + common);
+    record.penalties.erase(record.penalties.begin(), record.penalties.begin() + common);
+    const size_t committedWidths = std::min<size_t>(base.lineNumber, record.lineWidths.size());
+    record.lineWidths.erase(record.lineWidths.begin(),
+                            record.lineWidths.begin() + committedWidths);
+    context.candidates.erase(context.candidates.begin(), context.candidates.begin() + common);
+    penalties.erase(penalties.begin(), penalties.begin() + common);
+    extents.erase(extents.begin(), extents.begin() + common);
+    context.buildColumns();
+}
+
+StreamingLineBreaker::StreamingLineBreaker(const LineWidth& lineWidth, BreakStrategy strategy,
+                                           HyphenationFrequency frequency, bool justified)
+        : mState(std::make_unique<State>(lineWidth, strategy, frequency, justified)) {
+    MINIKIN_ASSERT(strategy != BreakStrategy::Greedy, "Greedy strategy is not supported");
+}
+
+StreamingLineBreaker::~StreamingLineBreaker() {}
+
+void StreamingLineBreaker::feed(const U16StringPiece& window, const MeasuredText& measuredText) {
+    if (window.size() == 0) {
+        return;
+    }
+    State& state = *mState;
+    state.commitFinishedLines();
+
+    // The last candidate is scored differently from the others, so it is recomputed.
+    const uint32_t unchangedCount = state.context.candidates.size() - 1;
+    state.append(window, measuredText);
+    const ShiftedLineWidth lineWidth(state.lineWidth, state.committedLineCount);
     LineBreakOptimizer optimizer;
-    return optimizer.computeBreaks(context, textBuf, measured, lineWidth, strategy, justified);
+    optimizer.optimize(state.context, std::vector<float>(state.penalties), state.linePenalty,
+                       lineWidth, state.strategy, state.justified, unchangedCount,
+                       true /* resume */, &state.record);
+}
+
+void StreamingLineBreaker::finish() {
+    State& state = *mState;
+    if (state.context.candidates.size() > 1) {
+        state.commitLines(state.context.candidates.size() - 1);
+    }
+    // Start over for the next paragraph, keeping the lines not taken yet.
+    std::unique_ptr<State> next =
+            std::make_unique<State>(state.lineWidth, state.strategy, state.frequency,
+                                    state.justified);
+    next->lines = std::move(state.lines);
+    mState = std::move(next);
+}
+
+std::vector<LineRecord> StreamingLineBreaker::takeLines() {
+    std::vector<LineRecord> lines;
+    lines.swap(mState->lines);
+    return lines;
+}
+
+size_t StreamingLineBreaker::getMemoryUsage() const {
+    const State& state = *mState;
+    const size_t nCand = state.context.candidates.size();
+    const size_t perCandidate = sizeof(Candidate) + sizeof(ParaWidth) + sizeof(uint32_t) +
+                                2 * sizeof(float) + sizeof(MinikinExtent) +
+                                sizeof(OptimalBreaksData) + sizeof(uint32_t);
+    return nCand * perCandidate + state.record.lineWidths.size() * sizeof(float) +
+           state.lines.size() * sizeof(LineRecord);
 }
 
 }  // namespace minikin
@@ -23,9 +23,35 @@
 
 namespace minikin {
 
-LineBreakResult breakLineOptimal(const U16StringPiece& textBuf, const MeasuredText& measured,
-                                 const LineWidth& lineWidthLimits, BreakStrategy strategy,
-                                 HyphenationFrequency frequency, bool justified);
+std::vector<LineRecord> breakLineOptimal(const U16StringPiece& textBuf,
+                                         const MeasuredText& measured,
+                                         const LineWidth& lineWidthLimits, BreakStrategy strategy,
+                                         HyphenationFrequency frequency, bool justified);
+
+// Same as above, but reuses and updates the cache if it is not null.
+std::vector<LineRecord> breakLineOptimal(const U16StringPiece& textBuf,
+                                         const MeasuredText& measured,
+                                         const LineWidth& lineWidthLimits, BreakStrategy strategy,
+                                         HyphenationFrequency frequency, bool justified,
+                                         LineBreakerCache* cache);
+
+// Same as above, but returns the first maxLines lines only. If computeLineInfo is false, the
+// extents and the flags of the lines are not computed and left zero.
+std::vector<LineRecord> breakLineOptimal(const U16StringPiece& textBuf,
+                                         const MeasuredText& measured,
+                                         const LineWidth& lineWidthLimits, BreakStrategy strategy,
+                                         HyphenationFrequency frequency, bool justified,
+                                         LineBreakerCache* cache, uint32_t maxLines,
+                                         bool computeLineInfo);
+
+// Returns the number of lines breakLineOptimal produces, without building the lines.
+uint32_t countLinesOptimal(const U16StringPiece& textBuf, const MeasuredText& measured,
+                           const LineWidth& lineWidthLimits, BreakStrategy strategy,
+                           HyphenationFrequency frequency, bool justified);
+
+// Only for testing. If false, the beginnings of the lines are always scored one by one instead of
+// several candidates at a time, which must not change the result.
+void setScoreLanesEnabledForTesting(bool enabled);
 
 }  // namespace minikin
 
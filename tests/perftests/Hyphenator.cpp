@@ -18,6 +18,8 @@
 #include <benchmark/benchmark.h>
 
 #include "FileUtils.h"
+#include "HyphenatorMap.h"
+#include "LocaleListCache.h"
 #include "UnicodeUtils.h"
 
 namespace minikin {
@@ -26,9 +28,26 @@ const char* enUsHyph = "/system/usr/hyphen-data/hyph-en-us.hyb";
 const int enUsMinPrefix = 2;
 const int enUsMinSuffix = 3;
 
+const char* deHyph = "/system/usr/hyphen-data/hyph-de-1996.hyb";
+const int deMinPrefix = 2;
+const int deMinSuffix = 2;
+
+// Compound words, many of which are longer than the stack buffer of the hyphenator.
+const char* kLongGermanCompounds[] = {
+        "Donaudampfschifffahrtselektrizitätenhauptbetriebswerkbauunterbeamtengesellschaft",
+        "Rindfleischetikettierungsüberwachungsaufgabenübertragungsgesetz",
+        "Grundstücksverkehrsgenehmigungszuständigkeitsübertragungsverordnung",
+        "Verkehrsinfrastrukturfinanzierungsgesellschaft",
+        "Kraftfahrzeughaftpflichtversicherung",
+        "Arbeiterunfallversicherungsgesetz",
+        "Straßenbahnhaltestellenüberdachungsreinigungsdienstleistungsunternehmen",
+        "Bundesausbildungsförderungsgesetz",
+};
+
 static void BM_Hyphenator_short_word(benchmark::State& state) {
-    Hyphenator* hyphenator = Hyphenator::loadBinary(readWholeFile(enUsHyph).data(), enUsMinPrefix,
-                                                    enUsMinSuffix, "en");
+    static std::vector<uint8_t> patternData = readWholeFile(enUsHyph);
+    Hyphenator* hyphenator =
+            Hyphenator::loadBinary(patternData.data(), enUsMinPrefix, enUsMinSuffix, "en");
     std::vector<uint16_t> word = utf8ToUtf16("hyphen");
     std::vector<HyphenationType> result;
     while (state.KeepRunning()) {
@@ -40,8 +59,9 @@ static void BM_Hyphenator_short_word(benchmark::State& state) {
 BENCHMARK(BM_Hyphenator_short_word);
 
 static void BM_Hyphenator_long_word(benchmark::State& state) {
-    Hyphenator* hyphenator = Hyphenator::loadBinary(readWholeFile(enUsHyph).data(), enUsMinPrefix,
-                                                    enUsMinSuffix, "en");
+    static std::vector<uint8_t> patternData = readWholeFile(enUsHyph);
+    Hyphenator* hyphenator =
+            Hyphenator::loadBinary(patternData.data(), enUsMinPrefix, enUsMinSuffix, "en");
     std::vector<uint16_t> word = utf8ToUtf16("Pneumonoultramicroscopicsilicovolcanoconiosis");
     std::vector<HyphenationType> result;
     while (state.KeepRunning()) {
@@ -52,6 +72,71 @@ static void BM_Hyphenator_long_word(benchmark::State& state) {
 // TODO: Use BENCHMARK_CAPTURE for parametrise.
 BENCHMARK(BM_Hyphenator_long_word);
 
+static void BM_Hyphenator_short_word_compiled(benchmark::State& state) {
+    static std::vector<uint8_t> patternData = readWholeFile(enUsHyph);
+    Hyphenator* hyphenator =
+            Hyphenator::loadCompiled(patternData.data(), enUsMinPrefix, enUsMinSuffix, "en");
+    std::vector<uint16_t> word = utf8ToUtf16("hyphen");
+    std::vector<HyphenationType> result;
+    while (state.KeepRunning()) {
+        hyphenator->hyphenate(word, &result);
+    }
+}
+
+BENCHMARK(BM_Hyphenator_short_word_compiled);
+
+static void BM_Hyphenator_long_word_compiled(benchmark::State& state) {
+    static std::vector<uint8_t> patternData = readWholeFile(enUsHyph);
+    Hyphenator* hyphenator =
+            Hyphenator::loadCompiled(patternData.data(), enUsMinPrefix, enUsMinSuffix, "en");
+    std::vector<uint16_t> word = utf8ToUtf16("Pneumonoultramicroscopicsilicovolcanoconiosis");
+    std::vector<HyphenationType> result;
+    while (state.KeepRunning()) {
+        hyphenator->hyphenate(word, &result);
+    }
+}
+
+BENCHMARK(BM_Hyphenator_long_word_compiled);
+
+static void BM_Hyphenator_long_compound_words(benchmark::State& state) {
+    static std::vector<uint8_t> patternData = readWholeFile(deHyph);
+    Hyphenator* hyphenator =
+            Hyphenator::loadBinary(patternData.data(), deMinPrefix, deMinSuffix, "de");
+    std::vector<std::vector<uint16_t>> words;
+    for (const char* word : kLongGermanCompounds) {
+        words.push_back(utf8ToUtf16(word));
+    }
+    std::vector<HyphenationType> result;
+    while (state.KeepRunning()) {
+        for (const std::vector<uint16_t>& word : words) {
+            hyphenator->hyphenate(word, &result);
+        }
+    }
+}
+
+BENCHMARK(BM_Hyphenator_long_compound_words);
+
+// Looks up the hyphenators of the locales seen in a mixed locale text, from multiple threads.
+static void BM_HyphenatorMap_lookup(benchmark::State& state) {
+    static bool registered = []() {
+        addHyphenatorFromFile("en-US", enUsHyph, enUsMinPrefix, enUsMinSuffix);
+        addHyphenatorAlias("en-GB", "en-US");
+        return true;
+    }();
+    (void)registered;
+    std::vector<Locale> locales;
+    for (const char* localeStr : {"en-US", "en-GB", "en-Latn-US", "ja-JP", "fr-FR"}) {
+        locales.push_back(LocaleListCache::getById(LocaleListCache::getId(localeStr))[0]);
+    }
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(HyphenatorMap::lookup(locales[i]));
+        i = (i + 1) % locales.size();
+    }
+}
+
+BENCHMARK(BM_HyphenatorMap_lookup)->ThreadRange(1, 8);
+
 // TODO: Add more tests for other languages.
 
 }  // namespace minikin
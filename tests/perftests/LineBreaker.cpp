@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "minikin/LineBreaker.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "minikin/AndroidLineBreakerHelper.h"
+#include "minikin/FontCollection.h"
+#include "minikin/LocaleList.h"
+#include "minikin/MeasuredText.h"
+#include "minikin/MinikinPaint.h"
+
+#include "FontTestUtils.h"
+#include "UnicodeUtils.h"
+
+namespace minikin {
+
+static const char* SYSTEM_FONT_PATH = "/system/fonts/";
+static const char* SYSTEM_FONT_XML = "/system/etc/fonts.xml";
+
+constexpr size_t WORD_COUNT = 10000;
+
+static const char* WORDS[] = {
+        "Lorem", "ipsum", "dolor", "sit", "amet,", "consectetur", "adipiscing", "elit,", "sed",
+        "do", "eiusmod", "tempor", "incididunt", "ut", "labore", "et", "dolore", "magna",
+        "aliqua.", "Ut", "enim", "ad", "minim", "veniam,", "quis", "nostrud", "exercitation",
+        "ullamco", "laboris", "nisi", "ut", "aliquip", "ex", "ea", "commodo", "consequat.",
+};
+
+// Returns a paragraph of WORD_COUNT words.
+static std::vector<uint16_t> buildLongParagraph() {
+    constexpr size_t kWordListSize = sizeof(WORDS) / sizeof(WORDS[0]);
+    std::string text;
+    for (size_t i = 0; i < WORD_COUNT; ++i) {
+        if (i != 0) {
+            text += " ";
+        }
+        // Mix the order a bit to avoid repeating the same line breaks.
+        text += WORDS[(i * 7 + i / kWordListSize) % kWordListSize];
+    }
+    return utf8ToUtf16(text);
+}
+
+static std::unique_ptr<MeasuredText> measureParagraph(const std::vector<uint16_t>& text) {
+    auto collection =
+            std::make_shared<FontCollection>(getFontFamilies(SYSTEM_FONT_PATH, SYSTEM_FONT_XML));
+    MinikinPaint paint(collection);
+    paint.size = 16.0f;
+    paint.localeListId = registerLocaleList("en-US");
+
+    MeasuredTextBuilder builder;
+    builder.addStyleRun(0, text.size(), std::move(paint), false /* is RTL */);
+    return builder.build(text, false /* compute hyphenation */, false /* compute full layout */,
+                         nullptr /* no hint */);
+}
+
+static void BM_LineBreaker_optimal_constantWidth(benchmark::State& state) {
+    const std::vector<uint16_t> text = buildLongParagraph();
+    std::unique_ptr<MeasuredText> measured = measureParagraph(text);
+    const float width = state.range(0);
+    const std::vector<float> indents;
+    android::AndroidLineWidth lineWidth(width, 0 /* first line count */, width, indents, 0);
+    TabStops tabStops(nullptr, 0, 0);
+
+    while (state.KeepRunning()) {
+        breakIntoLines(text, BreakStrategy::HighQuality, HyphenationFrequency::None,
+                       false /* justified */, *measured, lineWidth, tabStops);
+    }
+}
+
+BENCHMARK(BM_LineBreaker_optimal_constantWidth)->Arg(200)->Arg(1000);
+
+// The first line is narrower than the others, so the line breaker can't assume the constant width.
+static void BM_LineBreaker_optimal_variableWidth(benchmark::State& state) {
+    const std::vector<uint16_t> text = buildLongParagraph();
+    std::unique_ptr<MeasuredText> measured = measureParagraph(text);
+    const float width = state.range(0);
+    const std::vector<float> indents;
+    android::AndroidLineWidth lineWidth(width - 16, 1 /* first line count */, width, indents, 0);
+    TabStops tabStops(nullptr, 0, 0);
+
+    while (state.KeepRunning()) {
+        breakIntoLines(text, BreakStrategy::HighQuality, HyphenationFrequency::None,
+                       false /* justified */, *measured, lineWidth, tabStops);
+    }
+}
+
+BENCHMARK(BM_LineBreaker_optimal_variableWidth)->Arg(200)->Arg(1000);
+
+static void BM_LineBreaker_optimal_justified(benchmark::State& state) {
+    const std::vector<uint16_t> text = buildLongParagraph();
+    std::unique_ptr<MeasuredText> measured = measureParagraph(text);
+    const float width = state.range(0);
+    const std::vector<float> indents;
+    android::AndroidLineWidth lineWidth(width, 0 /* first line count */, width, indents, 0);
+    TabStops tabStops(nullptr, 0, 0);
+
+    while (state.KeepRunning()) {
+        breakIntoLines(text, BreakStrategy::HighQuality, HyphenationFrequency::None,
+                       true /* justified */, *measured, lineWidth, tabStops);
+    }
+}
+
+BENCHMARK(BM_LineBreaker_optimal_justified)->Arg(200)->Arg(1000);
+
+// Alternates between two widths with a cache, as resizing the container does.
+static void BM_LineBreaker_optimal_widthChange_cached(benchmark::State& state) {
+    const std::vector<uint16_t> text = buildLongParagraph();
+    std::unique_ptr<MeasuredText> measured = measureParagraph(text);
+    const float width = state.range(0);
+    const std::vector<float> indents;
+    android::AndroidLineWidth lineWidth(width - 16, 1 /* first line count */, width, indents, 0);
+    android::AndroidLineWidth otherLineWidth(width - 8, 1 /* first line count */, width, indents,
+                                             0);
+    TabStops tabStops(nullptr, 0, 0);
+    LineBreakerCache cache;
+
+    bool useOther = false;
+    while (state.KeepRunning()) {
+        breakIntoLines(text, BreakStrategy::HighQuality, HyphenationFrequency::None,
+                       false /* justified */, *measured, useOther ? otherLineWidth : lineWidth,
+                       tabStops, &cache);
+        useOther = !useOther;
+    }
+}
+
+BENCHMARK(BM_LineBreaker_optimal_widthChange_cached)->Arg(200)->Arg(1000);
+
+// Finds the first lines for ellipsizing, e.g. a preview of a long text.
+static void BM_LineBreaker_greedy_firstLines(benchmark::State& state) {
+    const std::vector<uint16_t> text = buildLongParagraph();
+    std::unique_ptr<MeasuredText> measured = measureParagraph(text);
+    const float width = 1000;
+    const std::vector<float> indents;
+    android::AndroidLineWidth lineWidth(width, 0 /* first line count */, width, indents, 0);
+    TabStops tabStops(nullptr, 0, 0);
+
+    while (state.KeepRunning()) {
+        breakIntoFirstLines(text, BreakStrategy::Greedy, HyphenationFrequency::None,
+                            false /* justified */, *measured, lineWidth, tabStops, state.range(0));
+    }
+}
+
+BENCHMARK(BM_LineBreaker_greedy_firstLines)->Arg(3)->Arg(100);
+
+static void BM_LineBreaker_optimal_countLines(benchmark::State& state) {
+    const std::vector<uint16_t> text = buildLongParagraph();
+    std::unique_ptr<MeasuredText> measured = measureParagraph(text);
+    const float width = state.range(0);
+    const std::vector<float> indents;
+    android::AndroidLineWidth lineWidth(width, 0 /* first line count */, width, indents, 0);
+    TabStops tabStops(nullptr, 0, 0);
+
+    while (state.KeepRunning()) {
+        countLines(text, BreakStrategy::HighQuality, HyphenationFrequency::None,
+                   false /* justified */, *measured, lineWidth, tabStops);
+    }
+}
+
+BENCHMARK(BM_LineBreaker_optimal_countLines)->Arg(200)->Arg(1000);
+
+// Breaks the paragraph in windows of 100 words, keeping only the uncommitted candidates.
+static void BM_LineBreaker_optimal_streaming(benchmark::State& state) {
+    constexpr size_t kWordListSize = sizeof(WORDS) / sizeof(WORDS[0]);
+    constexpr size_t kWindowWordCount = 100;
+    std::vector<std::vector<uint16_t>> windows;
+    std::vector<std::unique_ptr<MeasuredText>> measuredWindows;
+    for (size_t start = 0; start < WORD_COUNT; start += kWindowWordCount) {
+        std::string text;
+        for (size_t i = start; i < start + kWindowWordCount; ++i) {
+            text += WORDS[(i * 7 + i / kWordListSize) % kWordListSize];
+            if (i != WORD_COUNT - 1) {
+                text += " ";
+            }
+        }
+        windows.push_back(utf8ToUtf16(text));
+        measuredWindows.push_back(measureParagraph(windows.back()));
+    }
+    const float width = state.range(0);
+    const std::vector<float> indents;
+    android::AndroidLineWidth lineWidth(width, 0 /* first line count */, width, indents, 0);
+
+    StreamingLineBreaker breaker(lineWidth, BreakStrategy::HighQuality, HyphenationFrequency::None,
+                                 false /* justified */);
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < windows.size(); ++i) {
+            breaker.feed(windows[i], *measuredWindows[i]);
+            breaker.takeLines();
+        }
+        breaker.finish();
+        breaker.takeLines();
+    }
+}
+
+BENCHMARK(BM_LineBreaker_optimal_streaming)->Arg(200)->Arg(1000);
+
+}  // namespace minikin
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "minikin/AndroidLineBreakerHelper.h"
+#include "minikin/FontCollection.h"
+#include "minikin/Hyphenator.h"
+#include "minikin/LineBreaker.h"
+#include "minikin/LocaleList.h"
+#include "minikin/MeasuredText.h"
+#include "minikin/MinikinPaint.h"
+
+#include "FileUtils.h"
+#include "FontTestUtils.h"
+#include "HyphenatorMap.h"
+#include "UnicodeUtils.h"
+
+// Counts the allocations of this binary so that the benchmarks below can report the number of
+// allocations per iteration. This file is built into its own benchmark binary, so that the counting
+// doesn't slow down the allocations of the other benchmarks.
+static std::atomic<uint64_t> gAllocationCount(0);
+
+static void* countedAlloc(size_t size, size_t alignment) noexcept {
+    gAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) {
+        size = 1;
+    }
+    if (alignment <= alignof(std::max_align_t)) {
+        return malloc(size);
+    }
+    void* ptr = nullptr;
+    return posix_memalign(&ptr, alignment, size) == 0 ? ptr : nullptr;
+}
+
+static void* countedAllocOrAbort(size_t size, size_t alignment) noexcept {
+    void* ptr = countedAlloc(size, alignment);
+    if (ptr == nullptr) {
+        abort();  // Out of memory. Exceptions are not available.
+    }
+    return ptr;
+}
+
+void* operator new(size_t size) {
+    return countedAllocOrAbort(size, 0);
+}
+
+void* operator new[](size_t size) {
+    return countedAllocOrAbort(size, 0);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, 0);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return countedAllocOrAbort(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return countedAllocOrAbort(size, static_cast<size_t>(alignment));
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    free(ptr);
+}
+
+namespace minikin {
+
+static const char* SYSTEM_FONT_PATH = "/system/fonts/";
+static const char* SYSTEM_FONT_XML = "/system/etc/fonts.xml";
+static const char* EN_US_HYPH = "/system/usr/hyphen-data/hyph-en-us.hyb";
+
+// The texts of OptimalLineBreakerTest.
+static const char* CORPORA[] = {
+        "This is an example text.",
+        "czerwono-niebieska",
+        "This is an url: http://a.b",
+        "This is an email: a@example.com",
+        "The \u3042\u3044\u3046 is Japanese.",
+        "This is an example \u2639 text.",
+        "\u672C\u65E5\u306F\u6674\u5929\u306A\u308A",
+        "ab de\u00A0\u00A0fg ij\u00A0\u00A0kl no\u00A0\u00A0pq st",
+        "This (is an) example text.",
+        "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor "
+        "incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud "
+        "exercitation ullamco laboris nisi ut aliquip ex ea commodo consequat.",
+};
+
+// The line widths to break each corpus with, from narrower than most words to wider than most of
+// the corpora.
+static const float LINE_WIDTHS[] = {30, 60, 100, 250};
+
+// Measures and breaks the corpus at the index with hyphenation, reporting the allocations per
+// iteration.
+static void BM_OptimalLineBreaker_corpus(benchmark::State& state) {
+    std::vector<uint8_t> pattern = readWholeFile(EN_US_HYPH);
+    HyphenatorMap::add("en-US", Hyphenator::loadBinary(pattern.data(), 2 /* min prefix */,
+                                                       2 /* min suffix */, "en-US"));
+    auto collection =
+            std::make_shared<FontCollection>(getFontFamilies(SYSTEM_FONT_PATH, SYSTEM_FONT_XML));
+    const std::vector<uint16_t> text = utf8ToUtf16(CORPORA[state.range(0)]);
+    const std::vector<float> indents;
+    TabStops tabStops(nullptr, 0, 0);
+
+    uint64_t iterations = 0;
+    const uint64_t allocationCount = gAllocationCount.load();
+    while (state.KeepRunning()) {
+        MinikinPaint paint(collection);
+        paint.size = 10.0f;
+        paint.localeListId = registerLocaleList("en-US");
+        MeasuredTextBuilder builder;
+        builder.addStyleRun(0, text.size(), std::move(paint), false /* is RTL */);
+        std::unique_ptr<MeasuredText> measured =
+                builder.build(text, true /* compute hyphenation */,
+                              false /* compute full layout */, nullptr /* no hint */);
+        for (float width : LINE_WIDTHS) {
+            android::AndroidLineWidth lineWidth(width, 0 /* first line count */, width, indents,
+                                                0);
+            breakIntoLines(text, BreakStrategy::HighQuality, HyphenationFrequency::Normal,
+                           false /* justified */, *measured, lineWidth, tabStops);
+        }
+        iterations++;
+    }
+    if (iterations != 0) {
+        state.SetLabel(std::to_string((gAllocationCount.load() - allocationCount) / iterations) +
+                       " allocations");
+    }
+    HyphenatorMap::clear();
+}
+
+BENCHMARK(BM_OptimalLineBreaker_corpus)->DenseRange(0, sizeof(CORPORA) / sizeof(CORPORA[0]) - 1);
+
+}  // namespace minikin
@@ -29,6 +29,34 @@ const char RTL_1[] = "\u0627\u0644\u0633\u0644\u0627\u0645\u0020\u0639\u0644\u06
 const char LTR_2[] = "Hello, Android";
 const char RTL_2[] = "\u0639\u0644\u064A\u0643\u0645\u0020\u0627\u0644\u0633\u0644\u0627\u0645";
 
+TEST(BidiUtilsTest, isLtrOnlyText) {
+    EXPECT_TRUE(isLtrOnlyText(utf8ToUtf16(LTR_1), Bidi::LTR));
+    EXPECT_TRUE(isLtrOnlyText(utf8ToUtf16(LTR_1), Bidi::DEFAULT_LTR));
+    EXPECT_TRUE(isLtrOnlyText(utf8ToUtf16(LTR_1), Bidi::FORCE_LTR));
+    EXPECT_FALSE(isLtrOnlyText(utf8ToUtf16(LTR_1), Bidi::RTL));
+    EXPECT_FALSE(isLtrOnlyText(utf8ToUtf16(LTR_1), Bidi::DEFAULT_RTL));
+    EXPECT_FALSE(isLtrOnlyText(utf8ToUtf16(LTR_1), Bidi::FORCE_RTL));
+
+    EXPECT_TRUE(isLtrOnlyText(utf8ToUtf16(""), Bidi::LTR));
+    EXPECT_TRUE(isLtrOnlyText(utf8ToUtf16("123 + 456"), Bidi::DEFAULT_LTR));
+    // Non-Latin LTR scripts and emoji.
+    EXPECT_TRUE(isLtrOnlyText(utf8ToUtf16("\u3042\u4E00 \U0001F600 \u0915"), Bidi::LTR));
+    EXPECT_TRUE(isLtrOnlyText(utf8ToUtf16("\u2028\uFFFD\uFEFF"), Bidi::LTR));
+
+    EXPECT_FALSE(isLtrOnlyText(utf8ToUtf16(RTL_1), Bidi::LTR));
+    EXPECT_TRUE(isLtrOnlyText(utf8ToUtf16(RTL_1), Bidi::FORCE_LTR));
+    // RTL characters and bidi controls at any position.
+    for (const char* rtl : {"\u05D0", "\u0627", "\u0661", "\u200F", "\u202E", "\u2067",
+                            "\uFB1D", "\uFEFC", "\U00010800", "\U0001E900"}) {
+        SCOPED_TRACE(rtl);
+        const std::string str(rtl);
+        EXPECT_FALSE(isLtrOnlyText(utf8ToUtf16(str), Bidi::LTR));
+        EXPECT_FALSE(isLtrOnlyText(utf8ToUtf16(LTR_1 + str), Bidi::LTR));
+        EXPECT_FALSE(isLtrOnlyText(utf8ToUtf16(str + LTR_2), Bidi::DEFAULT_LTR));
+        EXPECT_FALSE(isLtrOnlyText(utf8ToUtf16("abc" + str + LTR_2), Bidi::LTR));
+    }
+}
+
 TEST(BidiUtilsTest, AllLTRCharText) {
     auto text = utf8ToUtf16(LTR_1);
     uint32_t ltrLength = text.size();
@@ -1619,4 +1619,30 @@ TEST(FontCollectionItemizeTest, customFallbackTest) {
     EXPECT_EQ(customFallbackFamily->getFont(0), runs[0].fakedFont.font);
 }
 
+TEST(FontCollectionItemizeTest, familyCacheTest) {
+    auto collection = buildFontCollectionFromXml(kItemizeFontXml);
+    EXPECT_EQ(0u, collection->getFamilyCacheHitCount());
+    EXPECT_EQ(0u, collection->getFamilyCacheMissCount());
+
+    // U+9AA8 is supported by all ja-Jpan, zh-Hans, zh-Hant fonts.
+    auto runs = itemize(collection, "U+9AA8", "zh-Hans");
+    ASSERT_EQ(1U, runs.size());
+    EXPECT_EQ(kZH_HansFont, getFontName(runs[0]));
+    const uint32_t missCount = collection->getFamilyCacheMissCount();
+    EXPECT_NE(0u, missCount);
+    EXPECT_NE(0u, collection->getFamilyCacheHitCount());
+
+    // The cached result must not be used for the different locale list.
+    runs = itemize(collection, "U+9AA8", "ja-Jpan");
+    ASSERT_EQ(1U, runs.size());
+    EXPECT_EQ(kJAFont, getFontName(runs[0]));
+    EXPECT_LT(missCount, collection->getFamilyCacheMissCount());
+
+    const uint32_t hitCount = collection->getFamilyCacheHitCount();
+    runs = itemize(collection, "U+9AA8", "zh-Hans");
+    ASSERT_EQ(1U, runs.size());
+    EXPECT_EQ(kZH_HansFont, getFontName(runs[0]));
+    EXPECT_LT(hitCount, collection->getFamilyCacheHitCount());
+}
+
 }  // namespace minikin
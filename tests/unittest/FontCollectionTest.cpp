@@ -18,6 +18,8 @@
 
 #include <gtest/gtest.h>
 
+#include "minikin/LocaleList.h"
+
 #include "FontTestUtils.h"
 #include "MinikinInternal.h"
 
@@ -175,4 +177,49 @@ TEST(FontCollectionTest, createWithVariations) {
     }
 }
 
+TEST(FontCollectionTest, localeMatchingScoresTest) {
+    const std::vector<std::shared_ptr<FontFamily>> families =
+            getFontFamilies(getTestDataDir(), getTestDataDir() + "itemize.xml");
+    // More locale lists than the slots of the locale matching score index, so that the lists
+    // evict each other.
+    const std::vector<std::string> localeLists = {
+            "ja-JP",         "zh-Hans",       "zh-Hant",       "ko-KR",         "en-US",
+            "ja-JP,zh-Hans", "zh-Hans,ja-JP", "zh-Hant,ja-JP", "ko-KR,zh-Hans", "en-US,ja-JP",
+            "en-US,zh-Hans", "en-US,zh-Hant", "en-US,ko-KR",   "fr-FR,ja-JP",   "fr-FR,zh-Hans",
+            "fr-FR,zh-Hant", "fr-FR,ko-KR",   "de-DE,ja-JP",   "de-DE,zh-Hans", "de-DE,ko-KR",
+    };
+    // Han characters supported by both the ja and zh-Hans fonts.
+    const std::vector<uint16_t> text = {0x81ED, 0x82B1, 0x5FCD};
+
+    auto itemizeFirstFont = [&text](const FontCollection& collection, uint32_t localeListId) {
+        std::vector<FontCollection::Run> runs =
+                collection.itemize(text, FontStyle(), localeListId, FamilyVariant::DEFAULT);
+        EXPECT_EQ(1U, runs.size());
+        return runs.empty() ? nullptr : runs[0].fakedFont.font;
+    };
+
+    // Expected results are calculated with a new collection for each locale list.
+    std::vector<uint32_t> localeListIds;
+    std::vector<const Font*> expected;
+    for (const std::string& localeList : localeLists) {
+        localeListIds.push_back(registerLocaleList(localeList));
+        expected.push_back(itemizeFirstFont(FontCollection(families), localeListIds.back()));
+    }
+    EXPECT_NE(expected[0], expected[1]);  // ja-JP and zh-Hans choose different families.
+
+    // The same collection must choose the same family, in whichever order the locale lists are
+    // used.
+    FontCollection collection(families);
+    for (int round = 0; round < 2; ++round) {
+        for (size_t i = 0; i < localeLists.size(); ++i) {
+            SCOPED_TRACE(localeLists[i]);
+            EXPECT_EQ(expected[i], itemizeFirstFont(collection, localeListIds[i]));
+        }
+        for (size_t i = localeLists.size(); i-- > 0;) {
+            SCOPED_TRACE(localeLists[i]);
+            EXPECT_EQ(expected[i], itemizeFirstFont(collection, localeListIds[i]));
+        }
+    }
+}
+
 }  // namespace minikin
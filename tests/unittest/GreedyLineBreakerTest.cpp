@@ -64,13 +64,13 @@ public:
     virtual void TearDown() override { HyphenatorMap::clear(); }
 
 protected:
-    LineBreakResult doLineBreak(const U16StringPiece& textBuffer, bool doHyphenation,
-                                float lineWidth) {
+    std::vector<LineRecord> doLineBreak(const U16StringPiece& textBuffer, bool doHyphenation,
+                                        float lineWidth) {
         return doLineBreak(textBuffer, doHyphenation, "en-US", lineWidth);
     }
 
-    LineBreakResult doLineBreak(const U16StringPiece& textBuffer, bool doHyphenation,
-                                const std::string& lang, float lineWidth) {
+    std::vector<LineRecord> doLineBreak(const U16StringPiece& textBuffer, bool doHyphenation,
+                                        const std::string& lang, float lineWidth) {
         MeasuredTextBuilder builder;
         auto family1 = buildFontFamily("Ascii.ttf");
         auto family2 = buildFontFamily("CustomExtent.ttf");
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HyphenPieceCache.h"
+
+#include <gtest/gtest.h>
+
+#include "FontTestUtils.h"
+#include "UnicodeUtils.h"
+
+namespace minikin {
+
+class TestableHyphenPieceCache : public HyphenPieceCache {
+public:
+    TestableHyphenPieceCache(uint32_t maxEntries) : HyphenPieceCache(maxEntries) {}
+    using HyphenPieceCache::getCacheSize;
+};
+
+TEST(HyphenPieceCacheTest, cacheHitTest) {
+    MinikinPaint paint(buildFontCollection("Ascii.ttf"));
+    paint.size = 10.0f;
+    const std::vector<uint16_t> word = utf8ToUtf16("hyphenation");
+    const HyphenationType type = HyphenationType::BREAK_AND_INSERT_HYPHEN;
+
+    TestableHyphenPieceCache cache(10);
+    HyphenPieceWidths widths = {};
+    EXPECT_FALSE(cache.get(word, 2, type, paint, false /* isRtl */, &widths));
+    cache.put(word, 2, type, paint, false /* isRtl */, {30.0f, 90.0f});
+    EXPECT_EQ(1u, cache.getCacheSize());
+
+    ASSERT_TRUE(cache.get(word, 2, type, paint, false /* isRtl */, &widths));
+    EXPECT_EQ(30.0f, widths.first);
+    EXPECT_EQ(90.0f, widths.second);
+
+    // The same point is stored once.
+    cache.put(word, 2, type, paint, false /* isRtl */, {30.0f, 90.0f});
+    EXPECT_EQ(1u, cache.getCacheSize());
+}
+
+TEST(HyphenPieceCacheTest, cacheMissTest) {
+    MinikinPaint paint(buildFontCollection("Ascii.ttf"));
+    paint.size = 10.0f;
+    const std::vector<uint16_t> word = utf8ToUtf16("hyphenation");
+    const HyphenationType type = HyphenationType::BREAK_AND_INSERT_HYPHEN;
+
+    TestableHyphenPieceCache cache(10);
+    cache.put(word, 2, type, paint, false /* isRtl */, {30.0f, 90.0f});
+    HyphenPieceWidths widths = {};
+    {
+        SCOPED_TRACE("Different offset");
+        EXPECT_FALSE(cache.get(word, 6, type, paint, false /* isRtl */, &widths));
+    }
+    {
+        SCOPED_TRACE("Different word");
+        EXPECT_FALSE(
+                cache.get(utf8ToUtf16("hyphenating"), 2, type, paint, false /* isRtl */, &widths));
+    }
+    {
+        SCOPED_TRACE("Different hyphenation type");
+        EXPECT_FALSE(cache.get(word, 2, HyphenationType::BREAK_AND_INSERT_HYPHEN_AT_NEXT_LINE,
+                               paint, false /* isRtl */, &widths));
+    }
+    {
+        SCOPED_TRACE("Different direction");
+        EXPECT_FALSE(cache.get(word, 2, type, paint, true /* isRtl */, &widths));
+    }
+    {
+        SCOPED_TRACE("Different paint");
+        MinikinPaint largePaint(paint);
+        largePaint.size = 20.0f;
+        EXPECT_FALSE(cache.get(word, 2, type, largePaint, false /* isRtl */, &widths));
+    }
+}
+
+TEST(HyphenPieceCacheTest, canCacheTest) {
+    MinikinPaint paint(buildFontCollection("Ascii.ttf"));
+    EXPECT_TRUE(HyphenPieceCache::canCache(utf8ToUtf16("hyphenation"), paint));
+    const std::vector<uint16_t> longWord(HyphenPieceCache::kLengthLimit + 1, 'a');
+    EXPECT_FALSE(HyphenPieceCache::canCache(longWord, paint));
+    paint.fontFeatureSettings = "'liga' off";
+    EXPECT_FALSE(HyphenPieceCache::canCache(utf8ToUtf16("hyphenation"), paint));
+}
+
+}  // namespace minikin
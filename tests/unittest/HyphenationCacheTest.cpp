@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HyphenationCache.h"
+
+#include <gtest/gtest.h>
+
+#include "FileUtils.h"
+#include "UnicodeUtils.h"
+
+namespace minikin {
+
+static const char* kEnUsHyph = "/system/usr/hyphen-data/hyph-en-us.hyb";
+
+class TestableHyphenationCache : public HyphenationCache {
+public:
+    TestableHyphenationCache(uint32_t maxEntries) : HyphenationCache(maxEntries) {}
+    using HyphenationCache::getCacheSize;
+};
+
+static std::vector<HyphenationType> hyphenateWithCache(HyphenationCache* cache,
+                                                       const Hyphenator& hyphenator,
+                                                       const std::vector<uint16_t>& word) {
+    std::vector<HyphenationType> result(word.size());
+    cache->hyphenate(hyphenator, word, result.data());
+    return result;
+}
+
+TEST(HyphenationCacheTest, cacheHitTest) {
+    std::vector<uint8_t> patternData = readWholeFile(kEnUsHyph);
+    Hyphenator* hyphenator = Hyphenator::loadBinary(patternData.data(), 2, 3, "en");
+    const std::vector<uint16_t> word = utf8ToUtf16("hyphenation");
+    std::vector<HyphenationType> expected;
+    hyphenator->hyphenate(word, &expected);
+
+    TestableHyphenationCache cache(10);
+    EXPECT_EQ(expected, hyphenateWithCache(&cache, *hyphenator, word));
+    EXPECT_EQ(1u, cache.getCacheSize());
+
+    EXPECT_EQ(expected, hyphenateWithCache(&cache, *hyphenator, word));
+    EXPECT_EQ(1u, cache.getCacheSize());
+}
+
+TEST(HyphenationCacheTest, cacheMissTest) {
+    std::vector<uint8_t> patternData = readWholeFile(kEnUsHyph);
+    Hyphenator* hyphenator = Hyphenator::loadBinary(patternData.data(), 2, 3, "en");
+    Hyphenator* softHyphenOnly = Hyphenator::loadBinary(nullptr, 2, 3, "en");
+    const std::vector<uint16_t> word = utf8ToUtf16("hyphenation");
+    const std::vector<uint16_t> word2 = utf8ToUtf16("table");
+
+    TestableHyphenationCache cache(10);
+    hyphenateWithCache(&cache, *hyphenator, word);
+    EXPECT_EQ(1u, cache.getCacheSize());
+
+    {
+        SCOPED_TRACE("Different hyphenator");
+        std::vector<HyphenationType> expected;
+        softHyphenOnly->hyphenate(word, &expected);
+        EXPECT_EQ(expected, hyphenateWithCache(&cache, *softHyphenOnly, word));
+        EXPECT_EQ(2u, cache.getCacheSize());
+    }
+    {
+        SCOPED_TRACE("Different word");
+        std::vector<HyphenationType> expected;
+        hyphenator->hyphenate(word2, &expected);
+        EXPECT_EQ(expected, hyphenateWithCache(&cache, *hyphenator, word2));
+        EXPECT_EQ(3u, cache.getCacheSize());
+    }
+}
+
+TEST(HyphenationCacheTest, cacheLengthLimitTest) {
+    std::vector<uint8_t> patternData = readWholeFile(kEnUsHyph);
+    Hyphenator* hyphenator = Hyphenator::loadBinary(patternData.data(), 2, 3, "en");
+    const std::vector<uint16_t> word(HyphenationCache::kLengthLimit + 1, 'a');
+    std::vector<HyphenationType> expected;
+    hyphenator->hyphenate(word, &expected);
+
+    TestableHyphenationCache cache(10);
+    EXPECT_EQ(expected, hyphenateWithCache(&cache, *hyphenator, word));
+    EXPECT_EQ(0u, cache.getCacheSize());
+}
+
+TEST(HyphenationCacheTest, evictionTest) {
+    std::vector<uint8_t> patternData = readWholeFile(kEnUsHyph);
+    Hyphenator* hyphenator = Hyphenator::loadBinary(patternData.data(), 2, 3, "en");
+
+    TestableHyphenationCache cache(2);
+    for (const char* word : {"hyphenation", "table", "example", "hyphenation"}) {
+        SCOPED_TRACE(word);
+        const std::vector<uint16_t> wordBuf = utf8ToUtf16(word);
+        std::vector<HyphenationType> expected;
+        hyphenator->hyphenate(wordBuf, &expected);
+        EXPECT_EQ(expected, hyphenateWithCache(&cache, *hyphenator, wordBuf));
+        EXPECT_GE(2u, cache.getCacheSize());
+    }
+}
+
+TEST(HyphenationCacheTest, hyphenateWordsTest) {
+    std::vector<uint8_t> patternData = readWholeFile(kEnUsHyph);
+    Hyphenator* hyphenator = Hyphenator::loadBinary(patternData.data(), 2, 3, "en");
+    const std::vector<uint16_t> text = utf8ToUtf16("table hyphenation table example");
+    const std::vector<Range> words = {Range(0, 5), Range(6, 17), Range(18, 23), Range(24, 31)};
+    std::vector<HyphenationType> expected(text.size());
+    hyphenator->hyphenate(text, words, expected.data());
+
+    TestableHyphenationCache cache(10);
+    std::vector<HyphenationType> result(text.size());
+    cache.hyphenate(*hyphenator, text, words, result.data());
+    EXPECT_EQ(expected, result);
+    // The repeated word is stored once.
+    EXPECT_EQ(3u, cache.getCacheSize());
+
+    std::vector<HyphenationType> cached(text.size());
+    cache.hyphenate(*hyphenator, text, words, cached.data());
+    EXPECT_EQ(expected, cached);
+    EXPECT_EQ(3u, cache.getCacheSize());
+}
+
+}  // namespace minikin
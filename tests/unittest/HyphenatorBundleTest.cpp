@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HyphenatorBundle.h"
+
+#include <cstring>
+
+#include <gtest/gtest.h>
+
+#include "minikin/Hyphenator.h"
+
+#include "FileUtils.h"
+#include "HyphenatorMap.h"
+#include "LocaleListCache.h"
+#include "UnicodeUtils.h"
+
+namespace minikin {
+
+static const char* kEnUsHyph = "/system/usr/hyphen-data/hyph-en-us.hyb";
+static const char* kSlHyph = "/system/usr/hyphen-data/hyph-sl.hyb";
+
+struct TestEntry {
+    std::string locale;
+    std::vector<uint8_t> hyb;
+    uint32_t minPrefix;
+    uint32_t minSuffix;
+};
+
+static void appendUint32(std::vector<uint8_t>* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out->push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+static void setUint32(std::vector<uint8_t>* out, size_t offset, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        (*out)[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+// Same layout as the bundling mode of tools/mk_hyb_file.py.
+static std::vector<uint8_t> buildBundle(
+        const std::vector<TestEntry>& entries,
+        const std::vector<std::pair<std::string, std::string>>& aliases) {
+    std::vector<uint8_t> strings;
+    auto addString = [&strings](const std::string& str) {
+        const uint32_t offset = strings.size();
+        strings.insert(strings.end(), str.begin(), str.end());
+        strings.push_back('\0');
+        return offset;
+    };
+    std::vector<uint32_t> localeOffsets;
+    for (const TestEntry& entry : entries) {
+        localeOffsets.push_back(addString(entry.locale));
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> aliasOffsets;
+    for (const auto& alias : aliases) {
+        const uint32_t from = addString(alias.first);
+        aliasOffsets.push_back(std::make_pair(from, addString(alias.second)));
+    }
+
+    const uint32_t stringOffset = 6 * 4 + entries.size() * 5 * 4 + aliases.size() * 2 * 4;
+    std::vector<uint32_t> hybOffsets;
+    uint32_t hybOffset = (stringOffset + strings.size() + 3) & ~3;
+    for (const TestEntry& entry : entries) {
+        hybOffsets.push_back(hybOffset);
+        hybOffset = (hybOffset + entry.hyb.size() + 3) & ~3;
+    }
+
+    std::vector<uint8_t> out;
+    appendUint32(&out, 0x62ad7962);
+    appendUint32(&out, 0);
+    appendUint32(&out, entries.size());
+    appendUint32(&out, aliases.size());
+    appendUint32(&out, stringOffset);
+    appendUint32(&out, hybOffset);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        appendUint32(&out, localeOffsets[i]);
+        appendUint32(&out, hybOffsets[i]);
+        appendUint32(&out, entries[i].hyb.size());
+        appendUint32(&out, entries[i].minPrefix);
+        appendUint32(&out, entries[i].minSuffix);
+    }
+    for (const auto& alias : aliasOffsets) {
+        appendUint32(&out, alias.first);
+        appendUint32(&out, alias.second);
+    }
+    out.insert(out.end(), strings.begin(), strings.end());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        out.resize(hybOffsets[i], 0);
+        out.insert(out.end(), entries[i].hyb.begin(), entries[i].hyb.end());
+    }
+    out.resize(hybOffset, 0);
+    return out;
+}
+
+static std::vector<HyphenationType> hyphenate(const Hyphenator* hyphenator, const char* word) {
+    std::vector<HyphenationType> result;
+    hyphenator->hyphenate(utf8ToUtf16(word), &result);
+    return result;
+}
+
+static const Hyphenator* lookup(const std::string& localeStr) {
+    const LocaleList& locales = LocaleListCache::getById(LocaleListCache::getId(localeStr));
+    return HyphenatorMap::lookup(locales[0]);
+}
+
+TEST(HyphenatorBundleTest, parse) {
+    const std::vector<uint8_t> enUs = readWholeFile(kEnUsHyph);
+    const std::vector<uint8_t> sl = readWholeFile(kSlHyph);
+    const std::vector<uint8_t> bundle =
+            buildBundle({{"en-US", enUs, 2, 3}, {"sl", sl, 2, 2}}, {{"en-GB", "en-US"}});
+
+    HyphenatorBundle parsed;
+    ASSERT_TRUE(HyphenatorBundle::parse(bundle.data(), bundle.size(), &parsed));
+    ASSERT_EQ(2u, parsed.entries.size());
+    EXPECT_EQ("en-US", parsed.entries[0].locale);
+    EXPECT_EQ(2u, parsed.entries[0].minPrefix);
+    EXPECT_EQ(3u, parsed.entries[0].minSuffix);
+    ASSERT_EQ(enUs.size(), parsed.entries[0].patternSize);
+    EXPECT_EQ(0, memcmp(enUs.data(), parsed.entries[0].patternData, enUs.size()));
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(parsed.entries[0].patternData) % 4);
+    EXPECT_EQ("sl", parsed.entries[1].locale);
+    ASSERT_EQ(sl.size(), parsed.entries[1].patternSize);
+    EXPECT_EQ(0, memcmp(sl.data(), parsed.entries[1].patternData, sl.size()));
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(parsed.entries[1].patternData) % 4);
+    ASSERT_EQ(1u, parsed.aliases.size());
+    EXPECT_EQ("en-GB", parsed.aliases[0].fromLocale);
+    EXPECT_EQ("en-US", parsed.aliases[0].toLocale);
+}
+
+TEST(HyphenatorBundleTest, parseMalformed) {
+    const std::vector<uint8_t> enUs = readWholeFile(kEnUsHyph);
+    const std::vector<uint8_t> bundle = buildBundle({{"en-US", enUs, 2, 3}}, {{"en", "en-US"}});
+    HyphenatorBundle parsed;
+    {
+        SCOPED_TRACE("Truncated");
+        EXPECT_FALSE(HyphenatorBundle::parse(bundle.data(), bundle.size() - 4, &parsed));
+        EXPECT_FALSE(HyphenatorBundle::parse(bundle.data(), 20, &parsed));
+    }
+    {
+        SCOPED_TRACE("Bad magic");
+        std::vector<uint8_t> broken = bundle;
+        setUint32(&broken, 0, 0x62ad7968);
+        EXPECT_FALSE(HyphenatorBundle::parse(broken.data(), broken.size(), &parsed));
+    }
+    {
+        SCOPED_TRACE("Entry table overlaps the string pool");
+        std::vector<uint8_t> broken = bundle;
+        setUint32(&broken, 8, 100);
+        EXPECT_FALSE(HyphenatorBundle::parse(broken.data(), broken.size(), &parsed));
+    }
+    {
+        SCOPED_TRACE("Hyb section out of the file");
+        std::vector<uint8_t> broken = bundle;
+        setUint32(&broken, 6 * 4 + 8, enUs.size() + 4);
+        EXPECT_FALSE(HyphenatorBundle::parse(broken.data(), broken.size(), &parsed));
+    }
+    {
+        SCOPED_TRACE("Hyb offset beyond the file size");
+        std::vector<uint8_t> broken = bundle;
+        // The size would pass the check if the file size minus the offset wrapped around.
+        setUint32(&broken, 6 * 4 + 4, bundle.size() + 4);
+        setUint32(&broken, 6 * 4 + 8, enUs.size());
+        EXPECT_FALSE(HyphenatorBundle::parse(broken.data(), broken.size(), &parsed));
+    }
+    {
+        SCOPED_TRACE("Misaligned hyb section");
+        std::vector<uint8_t> broken = bundle;
+        const size_t hybOffsetPos = 6 * 4 + 4;
+        uint32_t hybOffset;
+        memcpy(&hybOffset, bundle.data() + hybOffsetPos, sizeof(hybOffset));
+        setUint32(&broken, hybOffsetPos, hybOffset + 2);
+        setUint32(&broken, hybOffsetPos + 4, enUs.size() - 4);
+        EXPECT_FALSE(HyphenatorBundle::parse(broken.data(), broken.size(), &parsed));
+    }
+    {
+        SCOPED_TRACE("Misaligned data");
+        std::vector<uint8_t> shifted(bundle.size() + 1);
+        memcpy(shifted.data() + 1, bundle.data(), bundle.size());
+        EXPECT_FALSE(HyphenatorBundle::parse(shifted.data() + 1, bundle.size(), &parsed));
+    }
+    {
+        SCOPED_TRACE("Locale string out of the string pool");
+        std::vector<uint8_t> broken = bundle;
+        setUint32(&broken, 6 * 4, bundle.size());
+        EXPECT_FALSE(HyphenatorBundle::parse(broken.data(), broken.size(), &parsed));
+    }
+}
+
+TEST(HyphenatorBundleTest, addHyphenatorBundle) {
+    const std::vector<uint8_t> enUs = readWholeFile(kEnUsHyph);
+    const std::vector<uint8_t> sl = readWholeFile(kSlHyph);
+    const std::vector<uint8_t> bundle =
+            buildBundle({{"en-US", enUs, 2, 3}, {"sl", sl, 2, 2}}, {{"en-GB", "en-US"}});
+    // Drop the lookup results cached by the other tests.
+    HyphenatorMap::clear();
+    ASSERT_TRUE(addHyphenatorBundle(bundle.data(), bundle.size()));
+
+    const Hyphenator* enUsHyphenator = Hyphenator::loadBinary(enUs.data(), 2, 3, "en-US");
+    const Hyphenator* slHyphenator = Hyphenator::loadBinary(sl.data(), 2, 2, "sl");
+    EXPECT_EQ(hyphenate(enUsHyphenator, "hyphenation"),
+              hyphenate(lookup("en-US"), "hyphenation"));
+    EXPECT_EQ(lookup("en-US"), lookup("en-GB"));
+    // The Slovenian rule for the explicit hyphen is enabled by the locale of the entry.
+    EXPECT_EQ(hyphenate(slHyphenator, "avto-cesta"),
+              hyphenate(lookup("sl"), "avto-cesta"));
+    EXPECT_NE(lookup("en-US"), lookup("sl"));
+
+    HyphenatorMap::clear();
+}
+
+TEST(HyphenatorBundleTest, addHyphenatorBundle_malformed) {
+    const std::vector<uint8_t> enUs = readWholeFile(kEnUsHyph);
+    std::vector<uint8_t> bundle = buildBundle({{"en-US", enUs, 2, 3}}, {});
+    setUint32(&bundle, 0, 0);
+    HyphenatorMap::clear();
+    const Hyphenator* softHyphenOnly = lookup("en-US");
+
+    EXPECT_FALSE(addHyphenatorBundle(bundle.data(), bundle.size()));
+    EXPECT_EQ(softHyphenOnly, lookup("en-US"));
+    EXPECT_FALSE(addHyphenatorBundle("/nonexistent/hyph-bundle.hyb"));
+
+    HyphenatorMap::clear();
+}
+
+}  // namespace minikin
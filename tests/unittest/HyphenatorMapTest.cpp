@@ -16,10 +16,14 @@
 
 #include "HyphenatorMap.h"
 
+#include <thread>
+
 #include <gtest/gtest.h>
 
+#include "FileUtils.h"
 #include "LocaleListCache.h"
 #include "MinikinInternal.h"
+#include "UnicodeUtils.h"
 
 namespace minikin {
 namespace {
@@ -67,7 +71,10 @@ public:
     TestableHyphenatorMap() : HyphenatorMap() {}
 
     using HyphenatorMap::addAliasInternal;
+    using HyphenatorMap::addFromFileInternal;
     using HyphenatorMap::addInternal;
+    using HyphenatorMap::getFallbackEntryCount;
+    using HyphenatorMap::getFallbackSlotIndex;
     using HyphenatorMap::lookupInternal;
 };
 
@@ -143,6 +150,19 @@ protected:
         return mMap.lookupInternal(getLocale(localeStr));
     }
 
+    const Hyphenator* lookup(const Locale& locale) { return mMap.lookupInternal(locale); }
+
+    void addFromFile(const std::string& localeStr, const std::string& path, size_t minPrefix,
+                     size_t minSuffix, bool compile = false) {
+        mMap.addFromFileInternal(localeStr, path, minPrefix, minSuffix, compile);
+    }
+
+    void addAlias(const std::string& fromLocaleStr, const std::string& toLocaleStr) {
+        mMap.addAliasInternal(fromLocaleStr, toLocaleStr);
+    }
+
+    size_t getFallbackEntryCount() { return mMap.getFallbackEntryCount(); }
+
 private:
     TestableHyphenatorMap mMap;
 };
@@ -303,5 +323,155 @@ TEST_F(HyphenatorMapTest, CyrlScriptFallback) {
     EXPECT_NE(MN_CYRL_HYPHENATOR, lookup("und-Cyrl"));
 }
 
+const char* EN_US_HYPH = "/system/usr/hyphen-data/hyph-en-us.hyb";
+
+std::vector<HyphenationType> hyphenate(const Hyphenator* hyphenator, const char* word) {
+    std::vector<HyphenationType> result;
+    hyphenator->hyphenate(utf8ToUtf16(word), &result);
+    return result;
+}
+
+TEST_F(HyphenatorMapTest, addFromFile) {
+    std::vector<uint8_t> patternData = readWholeFile(EN_US_HYPH);
+    const Hyphenator* expected = Hyphenator::loadBinary(patternData.data(), 2, 3, "en");
+
+    addFromFile("en-US", EN_US_HYPH, 2, 3);
+    addAlias("en-AU", "en-US");
+    const Hyphenator* hyphenator = lookup("en-US");
+    ASSERT_NE(nullptr, hyphenator);
+    EXPECT_NE(EN_US_HYPHENATOR, hyphenator);
+    EXPECT_EQ(hyphenate(expected, "hyphenation"), hyphenate(hyphenator, "hyphenation"));
+
+    // The file is loaded only once for the locale and its aliases.
+    EXPECT_EQ(hyphenator, lookup("en-US"));
+    EXPECT_EQ(hyphenator, lookup("en-AU"));
+}
+
+TEST_F(HyphenatorMapTest, addFromFile_compiled) {
+    std::vector<uint8_t> patternData = readWholeFile(EN_US_HYPH);
+    const Hyphenator* expected = Hyphenator::loadBinary(patternData.data(), 2, 3, "en");
+
+    addFromFile("en-US", EN_US_HYPH, 2, 3, true /* compile */);
+    const Hyphenator* hyphenator = lookup("en-US");
+    ASSERT_NE(nullptr, hyphenator);
+    EXPECT_NE(EN_US_HYPHENATOR, hyphenator);
+    EXPECT_EQ(hyphenate(expected, "hyphenation"), hyphenate(hyphenator, "hyphenation"));
+}
+
+TEST_F(HyphenatorMapTest, addFromFile_missingFile) {
+    addFromFile("en-US", "/nonexistent/hyph-en-us.hyb", 2, 3);
+    // Falls back to the soft hyphen only hyphenator, which is used for unsupported locales.
+    EXPECT_EQ(lookup("ja"), lookup("en-US"));
+}
+
+TEST_F(HyphenatorMapTest, addFromFile_multipleThreads) {
+    addFromFile("en-US", EN_US_HYPH, 2, 3);
+    const LocaleList& locales = LocaleListCache::getById(LocaleListCache::getId("en-US"));
+    const Locale& locale = locales[0];
+
+    constexpr size_t THREAD_COUNT = 4;
+    const Hyphenator* results[THREAD_COUNT];
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < THREAD_COUNT; ++i) {
+        threads.emplace_back([this, &locale, &results, i]() { results[i] = lookup(locale); });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (size_t i = 0; i < THREAD_COUNT; ++i) {
+        EXPECT_NE(EN_US_HYPHENATOR, results[i]);
+        EXPECT_EQ(results[0], results[i]);
+    }
+}
+
+TEST_F(HyphenatorMapTest, fallbackThenAdd) {
+    EXPECT_EQ(FR_HYPHENATOR, lookup("fr-CA"));
+    // The cached fallback result doesn't hide the later registration.
+    addAlias("fr-CA", "en-US");
+    EXPECT_EQ(EN_US_HYPHENATOR, lookup("fr-CA"));
+    EXPECT_EQ(FR_HYPHENATOR, lookup("fr-FR"));
+}
+
+TEST_F(HyphenatorMapTest, fallbackManyLocales) {
+    // More locales than the fallback results to be cached.
+    for (size_t i = 0; i < 2; ++i) {
+        for (char c1 = 'A'; c1 <= 'Z'; ++c1) {
+            for (char c2 = 'A'; c2 <= 'Z'; ++c2) {
+                EXPECT_EQ(FR_HYPHENATOR, lookup(std::string("fr-") + c1 + c2));
+            }
+        }
+    }
+}
+
+TEST_F(HyphenatorMapTest, fallbackCollidingLocales) {
+    // Find a locale falling back to French in the same cache slot as fr-CA.
+    const size_t slot =
+            TestableHyphenatorMap::getFallbackSlotIndex(getLocale("fr-CA").getIdentifier());
+    std::string colliding;
+    for (char c1 = 'A'; c1 <= 'Z' && colliding.empty(); ++c1) {
+        for (char c2 = 'A'; c2 <= 'Z' && colliding.empty(); ++c2) {
+            const std::string localeStr = std::string("fr-") + c1 + c2;
+            if (localeStr != "fr-CA" && localeStr != "fr-FR" && localeStr != "fr-BE" &&
+                TestableHyphenatorMap::getFallbackSlotIndex(
+                        getLocale(localeStr).getIdentifier()) == slot) {
+                colliding = localeStr;
+            }
+        }
+    }
+    ASSERT_FALSE(colliding.empty());
+
+    // The alternating locales reuse their cached results instead of caching them again.
+    for (size_t i = 0; i < 1000; ++i) {
+        EXPECT_EQ(FR_HYPHENATOR, lookup("fr-CA"));
+        EXPECT_EQ(FR_HYPHENATOR, lookup(colliding));
+    }
+    EXPECT_EQ(2u, getFallbackEntryCount());
+
+    // The registration replaces the cached results, but doesn't add more locales to the cache.
+    addAlias("fr-FR", "en-US");
+    for (size_t i = 0; i < 1000; ++i) {
+        EXPECT_EQ(FR_HYPHENATOR, lookup("fr-CA"));
+        EXPECT_EQ(FR_HYPHENATOR, lookup(colliding));
+    }
+    EXPECT_EQ(2u, getFallbackEntryCount());
+    EXPECT_EQ(EN_US_HYPHENATOR, lookup("fr-FR"));
+    EXPECT_EQ(FR_HYPHENATOR, lookup("fr-BE"));
+    EXPECT_EQ(3u, getFallbackEntryCount());
+}
+
+TEST_F(HyphenatorMapTest, lookupWhileAdding) {
+    const std::vector<std::string> localeStrs = {"es-ES", "fr-CA", "de-CH-1901", "ja-JP", "am"};
+    std::vector<Locale> locales;
+    for (const std::string& localeStr : localeStrs) {
+        locales.push_back(getLocale(localeStr));
+    }
+    const std::vector<const Hyphenator*> expected = {ES_HYPHENATOR, FR_HYPHENATOR,
+                                                     DE_CH_1901_HYPHENATOR, lookup("ja"),
+                                                     UND_ETHI_HYPHENATOR};
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < 4; ++i) {
+        threads.emplace_back([this, &locales, &expected]() {
+            for (size_t j = 0; j < 1000; ++j) {
+                const size_t index = j % locales.size();
+                EXPECT_EQ(expected[index], lookup(locales[index]));
+            }
+        });
+    }
+    // The lookups above see either the old or the new snapshot while the unrelated locales are
+    // added.
+    for (char c1 = 'a'; c1 <= 'd'; ++c1) {
+        for (char c2 = 'a'; c2 <= 'z'; ++c2) {
+            addAlias(std::string("q") + c1 + c2, "en-US");
+        }
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(EN_US_HYPHENATOR, lookup("qaa"));
+    EXPECT_EQ(EN_US_HYPHENATOR, lookup("qdz"));
+    EXPECT_NE(EN_US_HYPHENATOR, lookup("qez"));
+}
+
 }  // namespace
 }  // namespace minikin
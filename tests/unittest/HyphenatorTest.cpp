@@ -16,9 +16,12 @@
 
 #include "minikin/Hyphenator.h"
 
+#include <cstring>
+
 #include <gtest/gtest.h>
 
 #include "FileUtils.h"
+#include "UnicodeUtils.h"
 
 #ifndef NELEM
 #define NELEM(x) ((sizeof(x) / sizeof((x)[0])))
@@ -28,6 +31,7 @@ namespace minikin {
 
 const char* usHyph = "/system/usr/hyphen-data/hyph-en-us.hyb";
 const char* malayalamHyph = "/system/usr/hyphen-data/hyph-ml.hyb";
+const char* germanHyph = "/system/usr/hyphen-data/hyph-de-1996.hyb";
 
 const uint16_t HYPHEN_MINUS = 0x002D;
 const uint16_t SOFT_HYPHEN = 0x00AD;
@@ -338,4 +342,207 @@ TEST(HyphenatorTest, startingHyphenMinus) {
     EXPECT_EQ(HyphenationType::DONT_BREAK, result[1]);
 }
 
+// The words longer than the stack buffer for the codes must be hyphenated with the patterns too.
+TEST(HyphenatorTest, longCompoundWord) {
+    std::vector<uint8_t> patternData = readWholeFile(germanHyph);
+    Hyphenator* hyphenator = Hyphenator::loadBinary(patternData.data(), 2, 2, "de");
+    Hyphenator* compiled = Hyphenator::loadCompiled(patternData.data(), 2, 2, "de");
+    // "Do-nau-dampf-schiff-fahrts...-ge-sell-schaft", 80 code units.
+    const std::vector<uint16_t> word =
+            utf8ToUtf16("Donaudampfschifffahrtselektrizitätenhauptbetriebswerkbauunterbeamten"
+                        "gesellschaft");
+    ASSERT_EQ(80u, word.size());
+    std::vector<HyphenationType> result;
+    hyphenator->hyphenate(word, &result);
+    ASSERT_EQ(word.size(), result.size());
+    for (size_t i : {2, 5, 10, 16, 68, 70, 74}) {
+        EXPECT_EQ(HyphenationType::BREAK_AND_INSERT_HYPHEN, result[i]) << i;
+    }
+    for (size_t i : {0, 1, 3, 4, 69, 71, 78, 79}) {
+        EXPECT_EQ(HyphenationType::DONT_BREAK, result[i]) << i;
+    }
+
+    std::vector<HyphenationType> compiledResult;
+    compiled->hyphenate(word, &compiledResult);
+    EXPECT_EQ(result, compiledResult);
+}
+
+// Hyphenating the words of a text at once must give the same result as one by one.
+TEST(HyphenatorTest, hyphenateWords) {
+    std::vector<uint8_t> patternData = readWholeFile(usHyph);
+    Hyphenator* hyphenator = Hyphenator::loadBinary(patternData.data(), 2, 3, "en");
+    // "table hyphenation re-enter ab", where "ab" is too short to hyphenate.
+    const std::vector<uint16_t> text = {'t', 'a', 'b', 'l', 'e', ' ', 'h', 'y', 'p', 'h', 'e',
+                                        'n', 'a', 't', 'i', 'o', 'n', ' ', 'r', 'e', HYPHEN_MINUS,
+                                        'e', 'n', 't', 'e', 'r', ' ', 'a', 'b'};
+    const std::vector<Range> words = {Range(0, 5), Range(6, 17), Range(18, 26), Range(27, 29)};
+    // The entries out of the words must be left untouched.
+    std::vector<HyphenationType> result(text.size(), HyphenationType::BREAK_AND_INSERT_HYPHEN);
+    hyphenator->hyphenate(text, words, result.data());
+
+    for (const Range& word : words) {
+        std::vector<HyphenationType> expected;
+        hyphenator->hyphenate(U16StringPiece(text).substr(word), &expected);
+        EXPECT_EQ(expected, std::vector<HyphenationType>(result.begin() + word.getStart(),
+                                                         result.begin() + word.getEnd()));
+    }
+    EXPECT_EQ(HyphenationType::BREAK_AND_INSERT_HYPHEN, result[5]);
+    EXPECT_EQ(HyphenationType::BREAK_AND_INSERT_HYPHEN, result[17]);
+    EXPECT_EQ(HyphenationType::BREAK_AND_INSERT_HYPHEN, result[26]);
+}
+
+// The result must not depend on what the output buffer held before, e.g. the previous word.
+TEST(HyphenatorTest, reusedOutputBuffer) {
+    std::vector<uint8_t> patternData = readWholeFile(usHyph);
+    Hyphenator* hyphenator = Hyphenator::loadBinary(patternData.data(), 2, 3, "en");
+    const std::vector<uint16_t> word = {'h', 'y', 'p', 'h', 'e', 'n', 'a', 't', 'i', 'o', 'n'};
+    std::vector<HyphenationType> expected;
+    hyphenator->hyphenate(word, &expected);
+
+    std::vector<HyphenationType> result(word.size(), HyphenationType::BREAK_AND_INSERT_HYPHEN);
+    hyphenator->hyphenate(word, result.data());
+    EXPECT_EQ(expected, result);
+}
+
+// The compiled patterns must give the same result as the patterns in the binary.
+TEST(HyphenatorTest, loadCompiled) {
+    for (const char* path : {usHyph, malayalamHyph}) {
+        SCOPED_TRACE(path);
+        std::vector<uint8_t> patternData = readWholeFile(path);
+        Hyphenator* hyphenator = Hyphenator::loadBinary(patternData.data(), 2, 3, "en");
+        Hyphenator* compiled = Hyphenator::loadCompiled(patternData.data(), 2, 3, "en");
+        const std::vector<std::vector<uint16_t>> words = {
+                {'t', 'a', 'b', 'l', 'e'},
+                {'h', 'y', 'p', 'h', 'e', 'n', 'a', 't', 'i', 'o', 'n'},
+                {'s', 'u', 'p', 'e', 'r', 'c', 'a', 'l', 'i', 'f', 'r', 'a', 'g', 'i', 'l', 'i',
+                 's', 't', 'i', 'c'},
+                {'A', 'b', 'c', 'd', 'e', 'f'},
+                {'a', 'b', GREEK_LOWER_ALPHA, 'c', 'd', 'e'},
+                {MALAYALAM_KA, MALAYALAM_KA, MALAYALAM_KA, MALAYALAM_KA, MALAYALAM_KA},
+                {'r', 'e', HYPHEN_MINUS, 'e', 'n', 't', 'e', 'r'},
+                {'f', 'o', 'o', SOFT_HYPHEN, 'b', 'a', 'r'},
+        };
+        for (const std::vector<uint16_t>& word : words) {
+            std::vector<HyphenationType> expected;
+            hyphenator->hyphenate(word, &expected);
+            std::vector<HyphenationType> result;
+            compiled->hyphenate(word, &result);
+            EXPECT_EQ(expected, result);
+        }
+    }
+}
+
+static uint32_t readUint32(const std::vector<uint8_t>& data, size_t offset) {
+    uint32_t value;
+    memcpy(&value, data.data() + offset, sizeof(value));
+    return value;
+}
+
+static void writeUint32(std::vector<uint8_t>* data, size_t offset, uint32_t value) {
+    memcpy(data->data() + offset, &value, sizeof(value));
+}
+
+// The size checked loading must accept the well-formed files and hyphenate in the same way.
+TEST(HyphenatorTest, loadBinaryWithSize) {
+    for (const char* path : {usHyph, malayalamHyph, germanHyph}) {
+        SCOPED_TRACE(path);
+        std::vector<uint8_t> patternData = readWholeFile(path);
+        Hyphenator* hyphenator = Hyphenator::loadBinary(patternData.data(), 2, 3, "en");
+        Hyphenator* checked =
+                Hyphenator::loadBinary(patternData.data(), patternData.size(), 2, 3, "en");
+        Hyphenator* compiled =
+                Hyphenator::loadCompiled(patternData.data(), patternData.size(), 2, 3, "en");
+        ASSERT_NE(nullptr, checked);
+        ASSERT_NE(nullptr, compiled);
+        const std::vector<std::vector<uint16_t>> words = {
+                {'h', 'y', 'p', 'h', 'e', 'n', 'a', 't', 'i', 'o', 'n'},
+                {'S', 'c', 'h', 'i', 'f', 'f', 'f', 'a', 'h', 'r', 't'},
+                {MALAYALAM_KA, MALAYALAM_KA, MALAYALAM_KA, MALAYALAM_KA, MALAYALAM_KA},
+        };
+        for (const std::vector<uint16_t>& word : words) {
+            std::vector<HyphenationType> expected;
+            hyphenator->hyphenate(word, &expected);
+            std::vector<HyphenationType> result;
+            checked->hyphenate(word, &result);
+            EXPECT_EQ(expected, result);
+            compiled->hyphenate(word, &result);
+            EXPECT_EQ(expected, result);
+        }
+    }
+}
+
+// The size checked loading must reject the data any lookup might read out of.
+TEST(HyphenatorTest, loadBinaryWithSize_malformed) {
+    const std::vector<uint8_t> patternData = readWholeFile(usHyph);
+    const size_t size = patternData.size();
+    const uint32_t trieOffset = readUint32(patternData, 12);
+    const uint32_t patternOffset = readUint32(patternData, 16);
+    const uint32_t linkShift = readUint32(patternData, trieOffset + 8);
+    const uint32_t trieEntryCount = readUint32(patternData, trieOffset + 20);
+    const uint32_t patternPoolSize = readUint32(patternData, patternOffset + 12);
+
+    EXPECT_EQ(nullptr, Hyphenator::loadBinary(nullptr, 0, 2, 3, "en"));
+    EXPECT_EQ(nullptr, Hyphenator::loadBinary(patternData.data(), size - 1, 2, 3, "en"));
+    EXPECT_EQ(nullptr, Hyphenator::loadCompiled(patternData.data(), 16, 2, 3, "en"));
+    {
+        SCOPED_TRACE("Misaligned");
+        std::vector<uint8_t> data(size + 1);
+        std::copy(patternData.begin(), patternData.end(), data.begin() + 1);
+        EXPECT_EQ(nullptr, Hyphenator::loadBinary(data.data() + 1, size, 2, 3, "en"));
+    }
+
+    const std::pair<const char*, std::pair<size_t, uint32_t>> corruptions[] = {
+            {"Magic", {0, 0}},
+            {"Version", {4, 1}},
+            {"Alphabet offset", {8, static_cast<uint32_t>(size)}},
+            {"Trie offset", {12, static_cast<uint32_t>(size - 8)}},
+            {"Pattern offset", {16, 2}},
+            {"Trie entry count", {trieOffset + 20, static_cast<uint32_t>(size / 4)}},
+            // The link of an edge to the last entry, from which the codes read out of the trie.
+            {"Trie link", {trieOffset + 24, (trieEntryCount - 1) << linkShift}},
+            {"Pattern shift", {trieOffset + 16, 32}},
+            {"Pattern entry count", {patternOffset + 4, 0}},
+            // The pattern of the entry 1 ends out of the pattern buffer.
+            {"Pattern entry", {patternOffset + 20, (1u << 26) | patternPoolSize}},
+    };
+    for (const auto& [name, corruption] : corruptions) {
+        SCOPED_TRACE(name);
+        std::vector<uint8_t> data = patternData;
+        writeUint32(&data, corruption.first, corruption.second);
+        EXPECT_EQ(nullptr, Hyphenator::loadBinary(data.data(), size, 2, 3, "en"));
+        EXPECT_EQ(nullptr, Hyphenator::loadCompiled(data.data(), size, 2, 3, "en"));
+    }
+}
+
+// A trie with a cycle is in bounds, but never ends when expanded, so it must be left uncompiled.
+TEST(HyphenatorTest, loadCompiledWithSize_cyclicTrie) {
+    std::vector<uint8_t> patternData = readWholeFile(usHyph);
+    const uint32_t alphabetOffset = readUint32(patternData, 8);
+    const uint32_t trieOffset = readUint32(patternData, 12);
+    ASSERT_EQ(0u, readUint32(patternData, alphabetOffset));
+    const uint32_t code = patternData[alphabetOffset + 12 + 'a' - readUint32(patternData,
+                                                                             alphabetOffset + 4)];
+    const uint32_t charMask = readUint32(patternData, trieOffset + 4);
+    const uint32_t linkShift = readUint32(patternData, trieOffset + 8);
+    const uint32_t linkMask = readUint32(patternData, trieOffset + 12);
+    // Make the edge for 'a' from the node for "a" go back to the node itself.
+    const uint32_t node = (readUint32(patternData, trieOffset + 24 + code * 4) & linkMask) >>
+                          linkShift;
+    const size_t edgeOffset = trieOffset + 24 + (node + code) * 4;
+    writeUint32(&patternData, edgeOffset,
+                (readUint32(patternData, edgeOffset) & ~(charMask | linkMask)) | code |
+                        (node << linkShift));
+
+    Hyphenator* hyphenator = Hyphenator::loadBinary(patternData.data(), 2, 3, "en");
+    Hyphenator* compiled =
+            Hyphenator::loadCompiled(patternData.data(), patternData.size(), 2, 3, "en");
+    ASSERT_NE(nullptr, compiled);
+    const std::vector<uint16_t> word(20, 'a');
+    std::vector<HyphenationType> expected;
+    hyphenator->hyphenate(word, &expected);
+    std::vector<HyphenationType> result;
+    compiled->hyphenate(word, &result);
+    EXPECT_EQ(expected, result);
+}
+
 }  // namespace minikin
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ItemizationCache.h"
+
+#include <gtest/gtest.h>
+
+#include "minikin/LocaleList.h"
+
+#include "FontTestUtils.h"
+#include "LocaleListCache.h"
+#include "UnicodeUtils.h"
+
+namespace minikin {
+
+const char kItemizeFontXml[] = "itemize.xml";
+
+class TestableItemizationCache : public ItemizationCache {
+public:
+    TestableItemizationCache(uint32_t maxEntries) : ItemizationCache(maxEntries) {}
+    using ItemizationCache::getCacheSize;
+};
+
+static void expectSameRuns(const std::vector<FontCollection::Run>& expected,
+                           const std::vector<FontCollection::Run>& actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(expected[i].fakedFont.font, actual[i].fakedFont.font);
+        EXPECT_EQ(expected[i].fakedFont.fakery, actual[i].fakedFont.fakery);
+        EXPECT_EQ(expected[i].start, actual[i].start);
+        EXPECT_EQ(expected[i].end, actual[i].end);
+    }
+}
+
+TEST(ItemizationCacheTest, cacheHitTest) {
+    auto collection = buildFontCollectionFromXml(kItemizeFontXml);
+    auto text = utf8ToUtf16("aあb");
+    const uint32_t localeListId = registerLocaleList("ja-JP");
+
+    TestableItemizationCache cache(10);
+    const auto expected =
+            collection->itemize(text, FontStyle(), localeListId, FamilyVariant::DEFAULT);
+
+    expectSameRuns(expected, cache.itemize(*collection, text, FontStyle(), localeListId,
+                                           FamilyVariant::DEFAULT));
+    EXPECT_EQ(1u, cache.getCacheSize());
+
+    expectSameRuns(expected, cache.itemize(*collection, text, FontStyle(), localeListId,
+                                           FamilyVariant::DEFAULT));
+    EXPECT_EQ(1u, cache.getCacheSize());
+}
+
+TEST(ItemizationCacheTest, cacheMissTest) {
+    auto collection = buildFontCollectionFromXml(kItemizeFontXml);
+    auto collection2 = buildFontCollectionFromXml(kItemizeFontXml);
+    auto text = utf8ToUtf16("aあb");
+    auto text2 = utf8ToUtf16("aあc");
+    const uint32_t localeListId = registerLocaleList("ja-JP");
+    const uint32_t localeListId2 = registerLocaleList("zh-CN");
+
+    TestableItemizationCache cache(10);
+    cache.itemize(*collection, text, FontStyle(), localeListId, FamilyVariant::DEFAULT);
+    EXPECT_EQ(1u, cache.getCacheSize());
+
+    {
+        SCOPED_TRACE("Different collection");
+        expectSameRuns(collection2->itemize(text, FontStyle(), localeListId,
+                                            FamilyVariant::DEFAULT),
+                       cache.itemize(*collection2, text, FontStyle(), localeListId,
+                                     FamilyVariant::DEFAULT));
+        EXPECT_EQ(2u, cache.getCacheSize());
+    }
+    {
+        SCOPED_TRACE("Different text");
+        cache.itemize(*collection, text2, FontStyle(), localeListId, FamilyVariant::DEFAULT);
+        EXPECT_EQ(3u, cache.getCacheSize());
+    }
+    {
+        SCOPED_TRACE("Different style");
+        cache.itemize(*collection, text, FontStyle(FontStyle::Weight::BOLD), localeListId,
+                      FamilyVariant::DEFAULT);
+        EXPECT_EQ(4u, cache.getCacheSize());
+    }
+    {
+        SCOPED_TRACE("Different locale list");
+        expectSameRuns(collection->itemize(text, FontStyle(), localeListId2,
+                                           FamilyVariant::DEFAULT),
+                       cache.itemize(*collection, text, FontStyle(), localeListId2,
+                                     FamilyVariant::DEFAULT));
+        EXPECT_EQ(5u, cache.getCacheSize());
+    }
+    {
+        SCOPED_TRACE("Different variant");
+        cache.itemize(*collection, text, FontStyle(), localeListId, FamilyVariant::ELEGANT);
+        EXPECT_EQ(6u, cache.getCacheSize());
+    }
+}
+
+TEST(ItemizationCacheTest, cacheLengthLimitTest) {
+    auto collection = buildFontCollection("Ascii.ttf");
+    std::vector<uint16_t> text(ItemizationCache::kLengthLimit, 'a');
+
+    TestableItemizationCache cache(140);
+    expectSameRuns(collection->itemize(text, FontStyle(), 0, FamilyVariant::DEFAULT),
+                   cache.itemize(*collection, text, FontStyle(), 0, FamilyVariant::DEFAULT));
+    EXPECT_EQ(0u, cache.getCacheSize());
+}
+
+}  // namespace minikin
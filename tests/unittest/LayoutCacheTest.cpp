@@ -287,4 +287,52 @@ TEST(LayoutCacheTest, cacheLengthLimitTest) {
     EXPECT_EQ(layoutCache.getCacheSize(), 0u);
 }
 
+class BatchLayoutCapture {
+public:
+    BatchLayoutCapture(size_t size) : mLayouts(size, nullptr) {}
+
+    void operator()(size_t i, const LayoutPiece& layout, const MinikinPaint& /* paint */) {
+        mLayouts[i] = &layout;
+    }
+
+    const LayoutPiece* get(size_t i) const { return mLayouts[i]; }
+
+private:
+    std::vector<const LayoutPiece*> mLayouts;
+};
+
+TEST(LayoutCacheTest, batchTest) {
+    auto text1 = utf8ToUtf16("android");
+    auto text2 = utf8ToUtf16("ANDROID");
+    MinikinPaint paint(buildFontCollection("Ascii.ttf"));
+
+    TestableLayoutCache layoutCache(10);
+
+    LayoutCapture layout;
+    layoutCache.getOrCreate(text1, Range(0, text1.size()), paint, false /* LTR */,
+                            StartHyphenEdit::NO_EDIT, EndHyphenEdit::NO_EDIT, layout);
+    EXPECT_EQ(1u, layoutCache.getCacheSize());
+
+    std::vector<LayoutCacheRequest> requests = {
+            {text1, Range(0, text1.size()), false /* LTR */},
+            {text2, Range(0, text2.size()), false /* LTR */},
+            {text2, Range(0, text2.size()), false /* LTR */},  // Same piece in the same batch.
+    };
+    BatchLayoutCapture batch(requests.size());
+    layoutCache.getOrCreateBatch(requests, paint, batch);
+
+    EXPECT_EQ(layout.get(), batch.get(0));
+    ASSERT_NE(nullptr, batch.get(1));
+    ASSERT_NE(nullptr, batch.get(2));
+    EXPECT_EQ(batch.get(1)->advance(), batch.get(2)->advance());
+    EXPECT_EQ(2u, layoutCache.getCacheSize());
+
+    // The pieces created by the batch are available for the subsequent lookups.
+    LayoutCapture layout2;
+    layoutCache.getOrCreate(text2, Range(0, text2.size()), paint, false /* LTR */,
+                            StartHyphenEdit::NO_EDIT, EndHyphenEdit::NO_EDIT, layout2);
+    EXPECT_EQ(2u, layoutCache.getCacheSize());
+    EXPECT_EQ(batch.get(1)->advance(), layout2.get()->advance());
+}
+
 }  // namespace minikin
@@ -19,6 +19,7 @@
 #include <gtest/gtest.h>
 
 #include "minikin/FontCollection.h"
+#include "minikin/LayoutCache.h"
 #include "minikin/LayoutPieces.h"
 
 #include "FontTestUtils.h"
@@ -460,6 +461,67 @@ TEST_F(LayoutTest, measuredTextTest) {
     }
 }
 
+TEST_F(LayoutTest, measureTextBatchTest) {
+    auto fc = buildFontCollection("LayoutTestFont.ttf");
+    MinikinPaint paint(fc);
+    paint.wordSpacing = 3.0f;
+    std::vector<uint16_t> text = utf8ToUtf16("IV X LC XI");
+    std::vector<Range> ranges = {Range(0, 2), Range(0, 4), Range(3, 10), Range(5, 5)};
+    for (Bidi bidi : {Bidi::LTR, Bidi::RTL, Bidi::DEFAULT_LTR, Bidi::FORCE_LTR}) {
+        SCOPED_TRACE(static_cast<int>(bidi));
+        std::vector<float> totalAdvances(ranges.size());
+        std::vector<float> advances(2 + 4 + 7);
+        Layout::measureTextBatch(text, ranges, bidi, paint, totalAdvances.data(), advances.data());
+
+        size_t outOffset = 0;
+        for (size_t i = 0; i < ranges.size(); ++i) {
+            const Range& range = ranges[i];
+            std::vector<float> expectedAdvances(range.getLength());
+            const float expected = Layout::measureText(text, range, bidi, paint,
+                                                       StartHyphenEdit::NO_EDIT,
+                                                       EndHyphenEdit::NO_EDIT,
+                                                       expectedAdvances.data());
+            EXPECT_EQ(expected, totalAdvances[i]);
+            for (size_t j = 0; j < range.getLength(); ++j) {
+                EXPECT_EQ(expectedAdvances[j], advances[outOffset + j]);
+            }
+            outOffset += range.getLength();
+        }
+    }
+    {
+        // Without per-character advances.
+        std::vector<float> totalAdvances(ranges.size());
+        Layout::measureTextBatch(text, ranges, Bidi::LTR, paint, totalAdvances.data(), nullptr);
+        EXPECT_EQ(6.0f, totalAdvances[0]);
+        EXPECT_EQ(29.0f, totalAdvances[1]);
+        EXPECT_EQ(0.0f, totalAdvances[3]);
+    }
+}
+
+TEST_F(LayoutTest, measureTextBatchPartiallyCachedTest) {
+    // Cache hits are reported before misses, but the totals must still be summed in text order.
+    auto fc = buildFontCollection("LayoutTestFont.ttf");
+    MinikinPaint paint(fc);
+    paint.size = 10.3f;
+    paint.wordSpacing = 0.7f;
+    std::vector<uint16_t> text = utf8ToUtf16("IV X LC XI CX VI IL");
+    LayoutCache::getInstance().clear();
+    // Warm the cache with some of the words only.
+    Layout::measureText(text, Range(5, 7), Bidi::LTR, paint, StartHyphenEdit::NO_EDIT,
+                        EndHyphenEdit::NO_EDIT, nullptr);
+    Layout::measureText(text, Range(14, 16), Bidi::LTR, paint, StartHyphenEdit::NO_EDIT,
+                        EndHyphenEdit::NO_EDIT, nullptr);
+
+    std::vector<Range> ranges = {Range(0, 19), Range(3, 16)};
+    std::vector<float> totalAdvances(ranges.size());
+    Layout::measureTextBatch(text, ranges, Bidi::LTR, paint, totalAdvances.data(), nullptr);
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        EXPECT_EQ(Layout::measureText(text, ranges[i], Bidi::LTR, paint, StartHyphenEdit::NO_EDIT,
+                                      EndHyphenEdit::NO_EDIT, nullptr),
+                  totalAdvances[i]);
+    }
+}
+
 // TODO: Add more test cases, e.g. measure text, letter spacing.
 
 }  // namespace minikin
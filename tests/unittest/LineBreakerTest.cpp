@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "minikin/LineBreaker.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "FontTestUtils.h"
+#include "HyphenatorMap.h"
+#include "LineBreakerTestHelper.h"
+#include "LocaleListCache.h"
+#include "UnicodeUtils.h"
+
+namespace minikin {
+namespace {
+
+using line_breaker_test_helper::RectangleLineWidth;
+
+class LineBreakerTest : public testing::Test {
+public:
+    // Line breaking looks up the hyphenators and the fallback results are remembered.
+    virtual void TearDown() override { HyphenatorMap::clear(); }
+};
+
+std::unique_ptr<MeasuredText> buildMeasuredText(const std::vector<uint16_t>& text) {
+    MinikinPaint paint(buildFontCollection("Ascii.ttf"));
+    paint.size = 10.0f;  // Make 1em=1px
+    paint.localeListId = LocaleListCache::getId("en-US");
+    MeasuredTextBuilder builder;
+    builder.addStyleRun(0, text.size(), std::move(paint), false /* is RTL */);
+    return builder.build(text, false /* compute hyphenation */, false /* compute full layout */,
+                         nullptr /* no hint */);
+}
+
+void expectSameResult(const LineBreakResult& expected, const LineBreakResult& actual) {
+    EXPECT_EQ(expected.breakPoints, actual.breakPoints);
+    EXPECT_EQ(expected.widths, actual.widths);
+    EXPECT_EQ(expected.ascents, actual.ascents);
+    EXPECT_EQ(expected.descents, actual.descents);
+    EXPECT_EQ(expected.flags, actual.flags);
+}
+
+TEST_F(LineBreakerTest, breakParagraphsIntoLines) {
+    const std::vector<std::string> texts = {
+            "This is an example text.",
+            "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor.",
+            "",
+            "Hello\tWorld",
+            "Ut enim ad minim veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip.",
+    };
+    const TabStops tabStops(nullptr, 0, 40);
+
+    std::vector<std::vector<uint16_t>> textBufs;
+    std::vector<std::unique_ptr<MeasuredText>> measuredTexts;
+    std::vector<std::unique_ptr<RectangleLineWidth>> lineWidths;
+    std::vector<LineBreakParagraph> paragraphs;
+    for (uint32_t i = 0; i < texts.size(); ++i) {
+        textBufs.push_back(utf8ToUtf16(texts[i]));
+    }
+    for (uint32_t i = 0; i < texts.size(); ++i) {
+        measuredTexts.push_back(buildMeasuredText(textBufs[i]));
+        lineWidths.push_back(std::make_unique<RectangleLineWidth>(50 + 30 * i));
+        paragraphs.push_back({textBufs[i], measuredTexts[i].get(), lineWidths[i].get(), &tabStops});
+    }
+
+    for (BreakStrategy strategy : {BreakStrategy::Greedy, BreakStrategy::HighQuality}) {
+        for (uint32_t threadCount : {0, 1, 2, 16}) {
+            std::vector<LineBreakResult> results = breakParagraphsIntoLines(
+                    paragraphs, strategy, HyphenationFrequency::None, false /* justified */,
+                    threadCount);
+            ASSERT_EQ(paragraphs.size(), results.size());
+            for (uint32_t i = 0; i < paragraphs.size(); ++i) {
+                SCOPED_TRACE(texts[i]);
+                LineBreakResult expected = breakIntoLines(
+                        textBufs[i], strategy, HyphenationFrequency::None, false /* justified */,
+                        *measuredTexts[i], *lineWidths[i], tabStops);
+                expectSameResult(expected, results[i]);
+            }
+        }
+    }
+}
+
+TEST_F(LineBreakerTest, breakParagraphsIntoLines_long) {
+    // Long enough to be broken with multiple threads.
+    std::string longText;
+    for (int i = 0; i < 40; ++i) {
+        longText += "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod. ";
+    }
+    const TabStops tabStops(nullptr, 0, 40);
+
+    std::vector<std::vector<uint16_t>> textBufs;
+    std::vector<std::unique_ptr<MeasuredText>> measuredTexts;
+    std::vector<std::unique_ptr<RectangleLineWidth>> lineWidths;
+    std::vector<LineBreakParagraph> paragraphs;
+    for (uint32_t i = 0; i < 8; ++i) {
+        textBufs.push_back(utf8ToUtf16(longText));
+    }
+    for (uint32_t i = 0; i < textBufs.size(); ++i) {
+        measuredTexts.push_back(buildMeasuredText(textBufs[i]));
+        lineWidths.push_back(std::make_unique<RectangleLineWidth>(100 + 30 * i));
+        paragraphs.push_back({textBufs[i], measuredTexts[i].get(), lineWidths[i].get(), &tabStops});
+    }
+
+    for (BreakStrategy strategy : {BreakStrategy::Greedy, BreakStrategy::HighQuality}) {
+        std::vector<LineBreakResult> results =
+                breakParagraphsIntoLines(paragraphs, strategy, HyphenationFrequency::None,
+                                         false /* justified */, 4 /* thread count */);
+        ASSERT_EQ(paragraphs.size(), results.size());
+        for (uint32_t i = 0; i < paragraphs.size(); ++i) {
+            LineBreakResult expected = breakIntoLines(
+                    textBufs[i], strategy, HyphenationFrequency::None, false /* justified */,
+                    *measuredTexts[i], *lineWidths[i], tabStops);
+            expectSameResult(expected, results[i]);
+        }
+    }
+}
+
+TEST_F(LineBreakerTest, breakParagraphsIntoLines_empty) {
+    EXPECT_TRUE(breakParagraphsIntoLines({}, BreakStrategy::HighQuality,
+                                         HyphenationFrequency::None, false /* justified */,
+                                         4 /* thread count */)
+                        .empty());
+}
+
+TEST_F(LineBreakerTest, breakIntoLineRecords) {
+    const std::vector<uint16_t> textBuf = utf8ToUtf16(
+            "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor. Ut "
+            "enim ad minim veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip.");
+    std::unique_ptr<MeasuredText> measuredText = buildMeasuredText(textBuf);
+    const RectangleLineWidth lineWidth(100);
+    const TabStops tabStops(nullptr, 0, 40);
+
+    for (BreakStrategy strategy :
+         {BreakStrategy::Greedy, BreakStrategy::HighQuality, BreakStrategy::Balanced}) {
+        const LineBreakResult expected =
+                breakIntoLines(textBuf, strategy, HyphenationFrequency::None, false /* justified */,
+                               *measuredText, lineWidth, tabStops);
+        const std::vector<LineRecord> lines = breakIntoLineRecords(
+                textBuf, strategy, HyphenationFrequency::None, false /* justified */,
+                *measuredText, lineWidth, tabStops, nullptr /* no cache */);
+        ASSERT_EQ(expected.breakPoints.size(), lines.size());
+        for (uint32_t i = 0; i < lines.size(); ++i) {
+            EXPECT_EQ(expected.breakPoints[i], lines[i].breakPoint);
+            EXPECT_EQ(expected.widths[i], lines[i].width);
+            EXPECT_EQ(expected.ascents[i], lines[i].ascent);
+            EXPECT_EQ(expected.descents[i], lines[i].descent);
+            EXPECT_EQ(expected.flags[i], lines[i].flags);
+        }
+        // The lines are in the order and the last line ends at the end of the text.
+        for (uint32_t i = 1; i < lines.size(); ++i) {
+            EXPECT_LT(lines[i - 1].breakPoint, lines[i].breakPoint);
+        }
+        EXPECT_EQ(static_cast<int>(textBuf.size()), lines.back().breakPoint);
+    }
+}
+
+TEST_F(LineBreakerTest, breakIntoFirstLines) {
+    const std::vector<uint16_t> textBuf = utf8ToUtf16(
+            "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor. Ut "
+            "enim ad minim veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip.");
+    std::unique_ptr<MeasuredText> measuredText = buildMeasuredText(textBuf);
+    const RectangleLineWidth lineWidth(100);
+    const TabStops tabStops(nullptr, 0, 40);
+
+    for (BreakStrategy strategy :
+         {BreakStrategy::Greedy, BreakStrategy::HighQuality, BreakStrategy::Balanced}) {
+        const LineBreakResult expected =
+                breakIntoLines(textBuf, strategy, HyphenationFrequency::None, false /* justified */,
+                               *measuredText, lineWidth, tabStops);
+        const uint32_t lineCount = expected.breakPoints.size();
+        ASSERT_LT(3u, lineCount);
+        EXPECT_EQ(lineCount, countLines(textBuf, strategy, HyphenationFrequency::None,
+                                        false /* justified */, *measuredText, lineWidth, tabStops));
+
+        for (uint32_t maxLines : {0u, 1u, 3u, lineCount, lineCount + 1}) {
+            SCOPED_TRACE(maxLines);
+            const std::vector<LineRecord> lines = breakIntoFirstLines(
+                    textBuf, strategy, HyphenationFrequency::None, false /* justified */,
+                    *measuredText, lineWidth, tabStops, maxLines);
+            ASSERT_EQ(std::min(maxLines, lineCount), lines.size());
+            for (uint32_t i = 0; i < lines.size(); ++i) {
+                EXPECT_EQ(expected.breakPoints[i], lines[i].breakPoint);
+                EXPECT_EQ(expected.widths[i], lines[i].width);
+            }
+        }
+    }
+}
+
+TEST_F(LineBreakerTest, countLines_empty) {
+    const std::vector<uint16_t> textBuf;
+    std::unique_ptr<MeasuredText> measuredText = buildMeasuredText(textBuf);
+    const RectangleLineWidth lineWidth(100);
+    const TabStops tabStops(nullptr, 0, 40);
+    for (BreakStrategy strategy : {BreakStrategy::Greedy, BreakStrategy::HighQuality}) {
+        EXPECT_EQ(0u, countLines(textBuf, strategy, HyphenationFrequency::None,
+                                 false /* justified */, *measuredText, lineWidth, tabStops));
+    }
+}
+
+// Splits the text into windows of wordCount words, each ending after the spaces following a word.
+std::vector<std::string> splitIntoWindows(const std::string& text, uint32_t wordCount) {
+    std::vector<std::string> windows;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = start;
+        for (uint32_t i = 0; i < wordCount && end < text.size(); ++i) {
+            end = text.find(' ', end);
+            end = end == std::string::npos ? text.size() : text.find_first_not_of(' ', end);
+            end = end == std::string::npos ? text.size() : end;
+        }
+        windows.push_back(text.substr(start, end - start));
+        start = end;
+    }
+    return windows;
+}
+
+std::vector<LineRecord> breakInWindows(StreamingLineBreaker* breaker,
+                                       const std::vector<std::string>& windows) {
+    std::vector<LineRecord> lines;
+    for (const std::string& window : windows) {
+        const std::vector<uint16_t> windowBuf = utf8ToUtf16(window);
+        breaker->feed(windowBuf, *buildMeasuredText(windowBuf));
+        for (const LineRecord& line : breaker->takeLines()) {
+            lines.push_back(line);
+        }
+    }
+    breaker->finish();
+    for (const LineRecord& line : breaker->takeLines()) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+TEST_F(LineBreakerTest, StreamingLineBreaker) {
+    const std::string text =
+            "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor. Ut "
+            "enim ad minim veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip.";
+    const std::vector<uint16_t> textBuf = utf8ToUtf16(text);
+    std::unique_ptr<MeasuredText> measuredText = buildMeasuredText(textBuf);
+    const TabStops tabStops(nullptr, 0, 40);
+
+    for (float width : {30.0f, 100.0f, 200.0f}) {
+        const RectangleLineWidth lineWidth(width);
+        for (BreakStrategy strategy : {BreakStrategy::HighQuality, BreakStrategy::Balanced}) {
+            for (bool justified : {false, true}) {
+                const LineBreakResult expected =
+                        breakIntoLines(textBuf, strategy, HyphenationFrequency::None, justified,
+                                       *measuredText, lineWidth, tabStops);
+                for (uint32_t wordCount : {1u, 3u, 100u}) {
+                    SCOPED_TRACE(testing::Message() << "width=" << width << " justified="
+                                                    << justified << " wordCount=" << wordCount);
+                    StreamingLineBreaker breaker(lineWidth, strategy, HyphenationFrequency::None,
+                                                 justified);
+                    const std::vector<LineRecord> lines =
+                            breakInWindows(&breaker, splitIntoWindows(text, wordCount));
+                    ASSERT_EQ(expected.breakPoints.size(), lines.size());
+                    for (uint32_t i = 0; i < lines.size(); ++i) {
+                        EXPECT_EQ(expected.breakPoints[i], lines[i].breakPoint);
+                        EXPECT_FLOAT_EQ(expected.widths[i], lines[i].width);
+                        EXPECT_EQ(expected.ascents[i], lines[i].ascent);
+                        EXPECT_EQ(expected.descents[i], lines[i].descent);
+                        EXPECT_EQ(expected.flags[i], lines[i].flags);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_F(LineBreakerTest, StreamingLineBreaker_boundedMemory) {
+    const RectangleLineWidth lineWidth(100);
+    StreamingLineBreaker breaker(lineWidth, BreakStrategy::HighQuality, HyphenationFrequency::None,
+                                 false /* justified */);
+    const std::vector<uint16_t> windowBuf = utf8ToUtf16("Lorem ipsum dolor sit amet, ");
+    std::unique_ptr<MeasuredText> measuredText = buildMeasuredText(windowBuf);
+
+    size_t maxUsage = 0;
+    uint32_t lineCount = 0;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        breaker.feed(windowBuf, *measuredText);
+        lineCount += breaker.takeLines().size();
+        if (i == 10) {
+            maxUsage = breaker.getMemoryUsage();
+        } else if (i > 10) {
+            // The retained candidates don't grow with the paragraph length.
+            EXPECT_LE(breaker.getMemoryUsage(), 2 * maxUsage);
+        }
+    }
+    breaker.finish();
+    lineCount += breaker.takeLines().size();
+    EXPECT_LT(1000u, lineCount);
+}
+
+}  // namespace
+}  // namespace minikin
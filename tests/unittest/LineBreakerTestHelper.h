@@ -38,6 +38,21 @@ private:
     float mWidth;
 };
 
+// Same as RectangleLineWidth but claims the width is constant, so that the optimal line breaker
+// uses the algorithm for the constant line width if possible.
+class ConstantLineWidth : public LineWidth {
+public:
+    ConstantLineWidth(float width) : mWidth(width) {}
+    virtual ~ConstantLineWidth() {}
+
+    float getAt(size_t) const override { return mWidth; }
+    float getMin() const override { return mWidth; }
+    bool isConstant() const override { return true; }
+
+private:
+    float mWidth;
+};
+
 // The run implemenataion for returning the same width for all characters.
 class ConstantRun : public Run {
 public:
@@ -53,17 +68,24 @@ public:
 
     virtual bool isRtl() const override { return false; }
     virtual bool canBreak() const override { return true; }
-    virtual uint32_t getLocaleListId() const { return mLocaleListId; }
+    virtual uint32_t getLocaleListId() const override { return mLocaleListId; }
 
     virtual void getMetrics(const U16StringPiece&, std::vector<float>* advances, LayoutPieces*,
-                            LayoutPieces*) const {
+                            LayoutPieces*) const override {
         std::fill(advances->begin() + mRange.getStart(), advances->begin() + mRange.getEnd(),
                   mWidth);
     }
 
-    virtual std::pair<float, MinikinRect> getBounds(const U16StringPiece& /* text */,
-                                                    const Range& /* range */,
-                                                    const LayoutPieces& /* pieces */) const {
+    virtual void getMetricsWithExtents(const U16StringPiece& text, std::vector<float>* advances,
+                                       LayoutPieces* precomputed, LayoutPieces* outPieces,
+                                       PieceExtents* outExtents) const override {
+        getMetrics(text, advances, precomputed, outPieces);
+        outExtents->add(mRange, {mAscent, mDescent});
+    }
+
+    virtual std::pair<float, MinikinRect> getBounds(
+            const U16StringPiece& /* text */, const Range& /* range */,
+            const LayoutPieces& /* pieces */) const override {
         return std::make_pair(mWidth, MinikinRect());
     }
 
@@ -72,11 +94,11 @@ public:
         return {mAscent, mDescent};
     }
 
-    virtual const MinikinPaint* getPaint() const { return &mPaint; }
+    virtual const MinikinPaint* getPaint() const override { return &mPaint; }
 
     virtual float measureHyphenPiece(const U16StringPiece&, const Range& range,
                                      StartHyphenEdit start, EndHyphenEdit end,
-                                     LayoutPieces*) const {
+                                     LayoutPieces*) const override {
         uint32_t extraCharForHyphen = 0;
         if (isInsertion(start)) {
             extraCharForHyphen++;
@@ -89,7 +111,7 @@ public:
 
     virtual void appendLayout(const U16StringPiece&, const Range&, const Range&,
                               const LayoutPieces&, const MinikinPaint&, uint32_t, StartHyphenEdit,
-                              EndHyphenEdit, Layout*) const {}
+                              EndHyphenEdit, Layout*) const override {}
 
 private:
     MinikinPaint mPaint;
@@ -157,6 +179,11 @@ static bool sameLineBreak(const std::vector<LineBreakExpectation>& expected,
     return true;
 }
 
+static bool sameLineBreak(const std::vector<LineBreakExpectation>& expected,
+                          const std::vector<LineRecord>& actual) {
+    return sameLineBreak(expected, LineBreakResult(actual));
+}
+
 // Make debug string.
 static std::string toString(const std::vector<LineBreakExpectation>& lines) {
     std::string out;
@@ -200,5 +227,9 @@ static std::string toString(const U16StringPiece& textBuf, const LineBreakResult
     return out;
 }
 
+static std::string toString(const U16StringPiece& textBuf, const std::vector<LineRecord>& lines) {
+    return toString(textBuf, LineBreakResult(lines));
+}
+
 }  // namespace line_breaker_test_helper
 }  // namespace minikin
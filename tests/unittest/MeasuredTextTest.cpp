@@ -18,9 +18,13 @@
 
 #include <gtest/gtest.h>
 
+#include "minikin/Hyphenator.h"
 #include "minikin/LineBreaker.h"
+#include "minikin/LocaleList.h"
 
+#include "FileUtils.h"
 #include "FontTestUtils.h"
+#include "HyphenatorMap.h"
 #include "UnicodeUtils.h"
 
 namespace minikin {
@@ -57,6 +61,57 @@ TEST(MeasuredTextTest, RunTests) {
     EXPECT_EQ(expectedWidths, measuredText->widths);
 }
 
+TEST(MeasuredTextTest, wordBreaksTest) {
+    auto text = utf8ToUtf16("(Hello) World, Hello.");
+    auto font = buildFontCollection("Ascii.ttf");
+
+    MeasuredTextBuilder builder;
+    MinikinPaint paint(font);
+    paint.size = 10.0f;
+    paint.localeListId = registerLocaleList("en-US");
+    builder.addStyleRun(0, text.size(), std::move(paint), false /* is RTL */);
+    // The word breaks are recorded even if the hyphenation is not computed.
+    auto mt = builder.build(text, false /* hyphenation */, false /* full layout */,
+                            nullptr /* no hint */);
+
+    ASSERT_EQ(3u, mt->wordBreaks.size());
+    EXPECT_EQ(8u, mt->wordBreaks[0].offset);
+    EXPECT_EQ(Range(1, 6), mt->wordBreaks[0].wordRange);
+    EXPECT_EQ(15u, mt->wordBreaks[1].offset);
+    EXPECT_EQ(Range(8, 13), mt->wordBreaks[1].wordRange);
+    EXPECT_EQ(21u, mt->wordBreaks[2].offset);
+    EXPECT_EQ(Range(15, 20), mt->wordBreaks[2].wordRange);
+    for (const WordBreakPoint& wordBreak : mt->wordBreaks) {
+        EXPECT_EQ(0, wordBreak.badness);
+    }
+}
+
+TEST(MeasuredTextTest, wordBreaksTest_acrossReplacementRun) {
+    auto text = utf8ToUtf16("Hello World Hello World");
+    auto font = buildFontCollection("Ascii.ttf");
+    const uint32_t localeListId = registerLocaleList("en-US");
+
+    MeasuredTextBuilder builder;
+    MinikinPaint paint1(font);
+    paint1.size = 10.0f;
+    paint1.localeListId = localeListId;
+    builder.addStyleRun(0, 6, std::move(paint1), false /* is RTL */);
+    builder.addReplacementRun(6, 12, 50.0f, localeListId);
+    MinikinPaint paint2(font);
+    paint2.size = 10.0f;
+    paint2.localeListId = localeListId;
+    builder.addStyleRun(12, text.size(), std::move(paint2), false /* is RTL */);
+    auto mt = builder.build(text, true /* hyphenation */, false /* full layout */,
+                            nullptr /* no hint */);
+
+    // The word breaker keeps walking after the replacement run.
+    std::vector<uint32_t> offsets;
+    for (const WordBreakPoint& wordBreak : mt->wordBreaks) {
+        offsets.push_back(wordBreak.offset);
+    }
+    EXPECT_EQ(std::vector<uint32_t>({6, 12, 18, 23}), offsets);
+}
+
 TEST(MeasuredTextTest, getBoundsTest) {
     auto text = utf8ToUtf16("Hello, World!");
     auto font = buildFontCollection("Ascii.ttf");
@@ -143,6 +198,97 @@ TEST(MeasuredTextTest, getExtentTest_multiStyle) {
     EXPECT_EQ(MinikinExtent(-160.0f, 40.0f), mt->getExtent(text, Range(0, text.size())));
 }
 
+TEST(MeasuredTextTest, getExtentTest_allRanges) {
+    auto text = utf8ToUtf16("Hello World, Hello World, Hello World");
+    auto font = buildFontCollection("Ascii.ttf");
+    const std::vector<Range> runRanges = {Range(0, 8), Range(8, 20), Range(20, text.size())};
+    const std::vector<MinikinExtent> runExtents = {
+            MinikinExtent(-80.0f, 20.0f), MinikinExtent(-160.0f, 40.0f),
+            MinikinExtent(-80.0f, 20.0f)};
+
+    MeasuredTextBuilder builder;
+    for (uint32_t i = 0; i < runRanges.size(); ++i) {
+        MinikinPaint paint(font);
+        paint.size = 10.0f * (i % 2 + 1);
+        builder.addStyleRun(runRanges[i].getStart(), runRanges[i].getEnd(), std::move(paint),
+                            false /* is RTL */);
+    }
+    auto mt = builder.build(text, true /* hyphenation */, false /* full layout */,
+                            nullptr /* no hint */);
+    ASSERT_TRUE(mt->pieceExtents.isAvailable());
+
+    for (uint32_t start = 0; start < text.size(); ++start) {
+        for (uint32_t end = start + 1; end <= text.size(); ++end) {
+            const Range range(start, end);
+            MinikinExtent expected;
+            for (uint32_t i = 0; i < runRanges.size(); ++i) {
+                if (Range::intersects(range, runRanges[i])) {
+                    expected.extendBy(runExtents[i]);
+                }
+            }
+            EXPECT_EQ(expected, mt->getExtent(text, range)) << start << ", " << end;
+        }
+    }
+}
+
+// A run implementing only the getMetrics, without getMetricsWithExtents.
+class RunWithoutPieceExtents : public Run {
+public:
+    RunWithoutPieceExtents(const Range& range, const MinikinExtent& extent)
+            : Run(range), mExtent(extent) {}
+
+    bool isRtl() const override { return false; }
+    bool canBreak() const override { return false; }
+    uint32_t getLocaleListId() const override { return 0; }
+
+    void getMetrics(const U16StringPiece& /* text */, std::vector<float>* advances,
+                    LayoutPieces* /* precomputed */, LayoutPieces* /* outPieces */) const override {
+        std::fill(advances->begin() + mRange.getStart(), advances->begin() + mRange.getEnd(),
+                  CHAR_WIDTH);
+    }
+
+    std::pair<float, MinikinRect> getBounds(const U16StringPiece& /* text */, const Range& range,
+                                            const LayoutPieces& /* pieces */) const override {
+        return std::make_pair(CHAR_WIDTH * range.getLength(), MinikinRect());
+    }
+
+    MinikinExtent getExtent(const U16StringPiece& /* text */, const Range& /* range */,
+                            const LayoutPieces& /* pieces */) const override {
+        return mExtent;
+    }
+
+    void appendLayout(const U16StringPiece& /* text */, const Range& /* range */,
+                      const Range& /* contextRange */, const LayoutPieces& /* pieces */,
+                      const MinikinPaint& /* paint */, uint32_t /* outOrigin */,
+                      StartHyphenEdit /* startHyphen */, EndHyphenEdit /* endHyphen */,
+                      Layout* /* outLayout */) const override {}
+
+private:
+    const MinikinExtent mExtent;
+};
+
+TEST(MeasuredTextTest, getExtentTest_runWithoutPieceExtents) {
+    auto text = utf8ToUtf16("Hello, World!");
+    auto font = buildFontCollection("Ascii.ttf");
+    uint32_t helloLength = 7;  // length of "Hello, "
+
+    MeasuredTextBuilder builder;
+    builder.addCustomRun<RunWithoutPieceExtents>(Range(0, helloLength),
+                                                 MinikinExtent(-80.0f, 20.0f));
+    MinikinPaint paint(font);
+    paint.size = 20.0f;
+    builder.addStyleRun(helloLength, text.size(), std::move(paint), false /* is RTL */);
+    auto mt = builder.build(text, true /* hyphenation */, false /* full layout */,
+                            nullptr /* no hint */);
+
+    // The extents are still computed from the runs.
+    EXPECT_FALSE(mt->pieceExtents.isAvailable());
+    EXPECT_EQ(CHAR_WIDTH, mt->widths[0]);
+    EXPECT_EQ(MinikinExtent(-80.0f, 20.0f), mt->getExtent(text, Range(0, 2)));
+    EXPECT_EQ(MinikinExtent(-160.0f, 40.0f), mt->getExtent(text, Range(7, 9)));
+    EXPECT_EQ(MinikinExtent(-160.0f, 40.0f), mt->getExtent(text, Range(0, text.size())));
+}
+
 TEST(MeasuredTextTest, buildLayoutTest) {
     auto text = utf8ToUtf16("Hello, World!");
     auto font = buildFontCollection("Ascii.ttf");
@@ -463,4 +609,47 @@ TEST(MeasuredTextTest, buildLayoutTest_multiStyle_differentPaint) {
     EXPECT_EQ(MinikinRect(0.0f, 30.0f, 390.0f, 0.0f), layout.getBounds());
 }
 
+TEST(MeasuredTextTest, approximateHyphenPieceWidths) {
+    std::vector<uint8_t> patternData = readWholeFile("/system/usr/hyphen-data/hyph-en-us.hyb");
+    HyphenatorMap::clear();
+    HyphenatorMap::add("en-US", Hyphenator::loadBinary(patternData.data(), 2, 2, "en-US"));
+    auto font = buildFontCollection("Ascii.ttf");
+    const std::vector<uint16_t> text = utf8ToUtf16("hyphenation example hyphenation");
+    auto build = [&](bool approximate) {
+        MeasuredTextBuilder builder;
+        MinikinPaint paint(font);
+        paint.size = 10.0f;  // make 1em = 10px
+        paint.localeListId = registerLocaleList("en-US");
+        builder.addStyleRun(0, text.size(), std::move(paint), false /* is RTL */);
+        builder.setApproximateHyphenPieceWidths(approximate);
+        return builder.build(text, true /* hyphenation */, false /* full layout */,
+                             nullptr /* no hint */);
+    };
+    // The measured widths must come from the cache the second time.
+    Layout::purgeCaches();
+    auto measured = build(false);
+    auto cached = build(false);
+    auto approximated = build(true);
+    HyphenatorMap::clear();
+
+    // The font has no kerning, so the approximation is exact.
+    ASSERT_FALSE(measured->hyphenBreaks.empty());
+    ASSERT_EQ(measured->hyphenBreaks.size(), cached->hyphenBreaks.size());
+    ASSERT_EQ(measured->hyphenBreaks.size(), approximated->hyphenBreaks.size());
+    for (size_t i = 0; i < measured->hyphenBreaks.size(); ++i) {
+        const HyphenBreak& expected = measured->hyphenBreaks[i];
+        for (const HyphenBreak& actual :
+             {cached->hyphenBreaks[i], approximated->hyphenBreaks[i]}) {
+            EXPECT_EQ(expected.offset, actual.offset);
+            EXPECT_EQ(expected.type, actual.type);
+            EXPECT_EQ(expected.first, actual.first);
+            EXPECT_EQ(expected.second, actual.second);
+        }
+    }
+    // "hy-phen-ation ": the first piece has the hyphen, the second piece has the trailing space.
+    EXPECT_EQ(2u, measured->hyphenBreaks[0].offset);
+    EXPECT_EQ(3 * CHAR_WIDTH, measured->hyphenBreaks[0].first);
+    EXPECT_EQ(10 * CHAR_WIDTH, measured->hyphenBreaks[0].second);
+}
+
 }  // namespace minikin
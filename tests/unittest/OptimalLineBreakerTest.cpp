@@ -18,6 +18,7 @@
 
 #include <gtest/gtest.h>
 
+#include "minikin/AndroidLineBreakerHelper.h"
 #include "minikin/Hyphenator.h"
 
 #include "FileUtils.h"
@@ -33,6 +34,7 @@
 namespace minikin {
 namespace {
 
+using line_breaker_test_helper::ConstantLineWidth;
 using line_breaker_test_helper::ConstantRun;
 using line_breaker_test_helper::LineBreakExpectation;
 using line_breaker_test_helper::RectangleLineWidth;
@@ -47,6 +49,35 @@ constexpr float DESCENT = 20.0f;
 constexpr float CUSTOM_ASCENT = -160.0f;
 constexpr float CUSTOM_DESCENT = 40.0f;
 
+void expectSameResult(const std::vector<LineRecord>& expectLines,
+                      const std::vector<LineRecord>& actualLines, const std::string& message) {
+    const LineBreakResult expect(expectLines);
+    const LineBreakResult actual(actualLines);
+    EXPECT_EQ(expect.breakPoints, actual.breakPoints) << message;
+    EXPECT_EQ(expect.widths, actual.widths) << message;
+    EXPECT_EQ(expect.ascents, actual.ascents) << message;
+    EXPECT_EQ(expect.descents, actual.descents) << message;
+    EXPECT_EQ(expect.flags, actual.flags) << message;
+}
+
+// Breaks the text into the lines of the given width without justification, both with the general
+// algorithm and with the one for the constant line width, and returns the result after checking
+// that both are the same.
+std::vector<LineRecord> doLineBreakWithBothSolvers(const U16StringPiece& textBuf,
+                                                   const MeasuredText& measuredText, float width,
+                                                   BreakStrategy strategy,
+                                                   HyphenationFrequency frequency) {
+    RectangleLineWidth rectangleLineWidth(width);
+    std::vector<LineRecord> lines = breakLineOptimal(textBuf, measuredText, rectangleLineWidth,
+                                                     strategy, frequency, false /* justified */);
+    ConstantLineWidth constantLineWidth(width);
+    expectSameResult(lines,
+                     breakLineOptimal(textBuf, measuredText, constantLineWidth, strategy, frequency,
+                                      false /* justified */),
+                     "constant width=" + std::to_string(width));
+    return lines;
+}
+
 class OptimalLineBreakerTest : public testing::Test {
 public:
     OptimalLineBreakerTest() {}
@@ -64,14 +95,14 @@ public:
     virtual void TearDown() override { HyphenatorMap::clear(); }
 
 protected:
-    LineBreakResult doLineBreak(const U16StringPiece& textBuffer, BreakStrategy strategy,
-                                HyphenationFrequency frequency, float lineWidth) {
+    std::vector<LineRecord> doLineBreak(const U16StringPiece& textBuffer, BreakStrategy strategy,
+                                        HyphenationFrequency frequency, float lineWidth) {
         return doLineBreak(textBuffer, strategy, frequency, "en-US", lineWidth);
     }
 
-    LineBreakResult doLineBreak(const U16StringPiece& textBuffer, BreakStrategy strategy,
-                                HyphenationFrequency frequency, const std::string& lang,
-                                float lineWidth) {
+    std::vector<LineRecord> doLineBreak(const U16StringPiece& textBuffer, BreakStrategy strategy,
+                                        HyphenationFrequency frequency, const std::string& lang,
+                                        float lineWidth) {
         MeasuredTextBuilder builder;
         auto family1 = buildFontFamily("Ascii.ttf");
         auto family2 = buildFontFamily("CustomExtent.ttf");
@@ -87,12 +118,25 @@ protected:
         return doLineBreak(textBuffer, *measuredText, strategy, frequency, lineWidth);
     }
 
-    LineBreakResult doLineBreak(const U16StringPiece& textBuffer, const MeasuredText& measuredText,
-                                BreakStrategy strategy, HyphenationFrequency frequency,
-                                float lineWidth) {
-        RectangleLineWidth rectangleLineWidth(lineWidth);
-        return breakLineOptimal(textBuffer, measuredText, rectangleLineWidth, strategy, frequency,
-                                false /* justified */);
+    std::unique_ptr<MeasuredText> buildMeasuredText(const U16StringPiece& textBuffer) {
+        MeasuredTextBuilder builder;
+        auto family1 = buildFontFamily("Ascii.ttf");
+        auto family2 = buildFontFamily("CustomExtent.ttf");
+        std::vector<std::shared_ptr<FontFamily>> families = {family1, family2};
+        auto fc = std::make_shared<FontCollection>(families);
+        MinikinPaint paint(fc);
+        paint.size = 10.0f;  // Make 1em=1px
+        paint.localeListId = LocaleListCache::getId("en-US");
+        builder.addStyleRun(0, textBuffer.size(), std::move(paint), false);
+        return builder.build(textBuffer, true /* compute hyphenation */,
+                             false /* compute full layout */, nullptr /* no hint */);
+    }
+
+    std::vector<LineRecord> doLineBreak(const U16StringPiece& textBuffer,
+                                        const MeasuredText& measuredText, BreakStrategy strategy,
+                                        HyphenationFrequency frequency, float lineWidth) {
+        return doLineBreakWithBothSolvers(textBuffer, measuredText, lineWidth, strategy,
+                                          frequency);
     }
 
 private:
@@ -1334,11 +1378,9 @@ TEST_F(OptimalLineBreakerTest, testReplacementSpanNotBreakTest_SingleChar) {
         std::unique_ptr<MeasuredText> measuredText =
                 builder.build(textBuf, false /* compute hyphenation */,
                               false /* compute full layout */, nullptr /* no hint */);
-        RectangleLineWidth rectangleLineWidth(width);
         TabStops tabStops(nullptr, 0, 0);
-        return breakLineOptimal(textBuf, *measuredText, rectangleLineWidth,
-                                BreakStrategy::HighQuality, HyphenationFrequency::None,
-                                false /* justified */);
+        return doLineBreakWithBothSolvers(textBuf, *measuredText, width, BreakStrategy::HighQuality,
+                                          HyphenationFrequency::None);
     };
 
     {
@@ -1427,11 +1469,9 @@ TEST_F(OptimalLineBreakerTest, testReplacementSpanNotBreakTest_MultipleChars) {
         std::unique_ptr<MeasuredText> measuredText =
                 builder.build(textBuf, false /* compute hyphenation */,
                               false /* compute full layout */, nullptr /* no hint */);
-        RectangleLineWidth rectangleLineWidth(width);
         TabStops tabStops(nullptr, 0, 0);
-        return breakLineOptimal(textBuf, *measuredText, rectangleLineWidth,
-                                BreakStrategy::HighQuality, HyphenationFrequency::None,
-                                false /* justified */);
+        return doLineBreakWithBothSolvers(textBuf, *measuredText, width, BreakStrategy::HighQuality,
+                                          HyphenationFrequency::None);
     };
 
     {
@@ -1516,11 +1556,9 @@ TEST_F(OptimalLineBreakerTest, testReplacementSpanNotBreakTest_CJK) {
         std::unique_ptr<MeasuredText> measuredText =
                 builder.build(textBuf, false /* compute hyphenation */,
                               false /* compute full layout */, nullptr /* no hint */);
-        RectangleLineWidth rectangleLineWidth(width);
         TabStops tabStops(nullptr, 0, 0);
-        return breakLineOptimal(textBuf, *measuredText, rectangleLineWidth,
-                                BreakStrategy::HighQuality, HyphenationFrequency::None,
-                                false /* justified */);
+        return doLineBreakWithBothSolvers(textBuf, *measuredText, width, BreakStrategy::HighQuality,
+                                          HyphenationFrequency::None);
     };
 
     {
@@ -1673,11 +1711,9 @@ TEST_F(OptimalLineBreakerTest, testReplacementSpan_GraphemeLineBreakWithMultiple
         std::unique_ptr<MeasuredText> measuredText =
                 builder.build(textBuf, false /* compute hyphenation */,
                               false /* compute full layout */, nullptr /* no hint */);
-        RectangleLineWidth rectangleLineWidth(width);
         TabStops tabStops(nullptr, 0, 0);
-        return breakLineOptimal(textBuf, *measuredText, rectangleLineWidth,
-                                BreakStrategy::HighQuality, HyphenationFrequency::None,
-                                false /* justified */);
+        return doLineBreakWithBothSolvers(textBuf, *measuredText, width, BreakStrategy::HighQuality,
+                                          HyphenationFrequency::None);
     };
 
     {
@@ -1808,11 +1844,9 @@ TEST_F(OptimalLineBreakerTest, testReplacementSpanNotBreakTest_with_punctuation)
         std::unique_ptr<MeasuredText> measuredText =
                 builder.build(textBuf, false /* compute hyphenation */,
                               false /* compute full layout */, nullptr /* no hint */);
-        RectangleLineWidth rectangleLineWidth(width);
         TabStops tabStops(nullptr, 0, 0);
-        return breakLineOptimal(textBuf, *measuredText, rectangleLineWidth,
-                                BreakStrategy::HighQuality, HyphenationFrequency::Normal,
-                                false /* justified */);
+        return doLineBreakWithBothSolvers(textBuf, *measuredText, width, BreakStrategy::HighQuality,
+                                          HyphenationFrequency::Normal);
     };
 
     {
@@ -2005,5 +2039,186 @@ TEST_F(OptimalLineBreakerTest, testControllCharAfterSpace) {
                                                    << toString(textBuf, actual);
     }
 }
+
+TEST_F(OptimalLineBreakerTest, testConstantWidthSameAsVariableWidth) {
+    const std::vector<uint16_t> textBuf = utf8ToUtf16(
+            "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor "
+            "incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud "
+            "exercitation ullamco laboris nisi ut aliquip ex ea commodo consequat. Duis aute "
+            "irure dolor in reprehenderit in voluptate velit esse cillum dolore eu fugiat nulla "
+            "pariatur. Hyphenation is an unquestionably extraordinary characteristic of "
+            "typesetting.");
+    std::unique_ptr<MeasuredText> measuredText = buildMeasuredText(textBuf);
+
+    for (BreakStrategy strategy : {BreakStrategy::HighQuality, BreakStrategy::Balanced}) {
+        for (HyphenationFrequency frequency :
+             {HyphenationFrequency::None, HyphenationFrequency::Normal,
+              HyphenationFrequency::Full}) {
+            for (float width = 10; width <= 1000; width += 15) {
+                doLineBreakWithBothSolvers(textBuf, *measuredText, width, strategy, frequency);
+            }
+        }
+    }
+}
+
+TEST_F(OptimalLineBreakerTest, testConstantWidthSameAsVariableWidth_ties) {
+    // Repeated words of the same width make many ways of breaking with exactly the same score.
+    // Both algorithms must choose the same one.
+    constexpr float CHAR_WIDTH = 10.0;
+    for (const std::string& word : {"a", "aa", "aaa", "aa a"}) {
+        std::string text;
+        for (int i = 0; i < 40; ++i) {
+            text += word + " ";
+        }
+        text += word;
+        const std::vector<uint16_t> textBuf = utf8ToUtf16(text);
+        MeasuredTextBuilder builder;
+        builder.addCustomRun<ConstantRun>(Range(0, textBuf.size()), "en-US", CHAR_WIDTH, ASCENT,
+                                          DESCENT);
+        std::unique_ptr<MeasuredText> measuredText =
+                builder.build(textBuf, false /* compute hyphenation */,
+                              false /* compute full layout */, nullptr /* no hint */);
+
+        for (BreakStrategy strategy : {BreakStrategy::HighQuality, BreakStrategy::Balanced}) {
+            for (float width = 10; width <= 300; width += 5) {
+                SCOPED_TRACE(word);
+                doLineBreakWithBothSolvers(textBuf, *measuredText, width, strategy,
+                                           HyphenationFrequency::None);
+            }
+        }
+    }
+}
+
+TEST_F(OptimalLineBreakerTest, testScoreLanesSameAsScalar) {
+    // Lines of many candidates, so that the beginnings of the lines are scored several candidates
+    // at a time.
+    std::string text;
+    for (int i = 0; i < 8; ++i) {
+        text += "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor "
+                "incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis "
+                "nostrud exercitation ullamco laboris nisi ut aliquip ex ea commodo consequat. ";
+    }
+    const std::vector<uint16_t> textBuf = utf8ToUtf16(text);
+    std::unique_ptr<MeasuredText> measuredText = buildMeasuredText(textBuf);
+    const std::vector<float> indents = {0, 200, 0, 100, 300};
+
+    for (BreakStrategy strategy : {BreakStrategy::HighQuality, BreakStrategy::Balanced}) {
+        for (HyphenationFrequency frequency :
+             {HyphenationFrequency::None, HyphenationFrequency::Normal}) {
+            for (bool justified : {false, true}) {
+                for (float width : {400, 1000, 1700, 3000}) {
+                    const std::string message = "width=" + std::to_string(width);
+                    RectangleLineWidth rectangleWidth(width);
+                    android::AndroidLineWidth indentedWidth(width, 2, width + 500, indents, 0);
+                    for (const LineWidth* lineWidth :
+                         std::vector<const LineWidth*>{&rectangleWidth, &indentedWidth}) {
+                        const std::vector<LineRecord> actual = breakLineOptimal(
+                                textBuf, *measuredText, *lineWidth, strategy, frequency, justified);
+                        setScoreLanesEnabledForTesting(false);
+                        const std::vector<LineRecord> expect = breakLineOptimal(
+                                textBuf, *measuredText, *lineWidth, strategy, frequency, justified);
+                        setScoreLanesEnabledForTesting(true);
+                        expectSameResult(expect, actual, message);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_F(OptimalLineBreakerTest, testCacheSameAsNoCache_widthChange) {
+    const std::vector<uint16_t> textBuf = utf8ToUtf16(
+            "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor "
+            "incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud "
+            "exercitation ullamco laboris nisi ut aliquip ex ea commodo consequat. Duis aute "
+            "irure dolor in reprehenderit in voluptate velit esse cillum dolore eu fugiat nulla "
+            "pariatur. Hyphenation is an unquestionably extraordinary characteristic of "
+            "typesetting.");
+    std::unique_ptr<MeasuredText> measuredText = buildMeasuredText(textBuf);
+    const std::vector<float> indents = {0, 20, 0, 10};
+
+    for (BreakStrategy strategy : {BreakStrategy::HighQuality, BreakStrategy::Balanced}) {
+        for (HyphenationFrequency frequency :
+             {HyphenationFrequency::None, HyphenationFrequency::Normal,
+              HyphenationFrequency::Full}) {
+            for (bool justified : {false, true}) {
+                LineBreakerCache cache;
+                // Grow and shrink the width to make the cached candidates both valid and invalid.
+                for (float width : {10, 100, 130, 250, 1000, 250, 40, 100, 100}) {
+                    const std::string message = "width=" + std::to_string(width);
+                    ConstantLineWidth constantWidth(width);
+                    expectSameResult(breakLineOptimal(textBuf, *measuredText, constantWidth,
+                                                      strategy, frequency, justified),
+                                     breakLineOptimal(textBuf, *measuredText, constantWidth,
+                                                      strategy, frequency, justified, &cache),
+                                     message);
+                    RectangleLineWidth variableWidth(width);
+                    expectSameResult(breakLineOptimal(textBuf, *measuredText, variableWidth,
+                                                      strategy, frequency, justified),
+                                     breakLineOptimal(textBuf, *measuredText, variableWidth,
+                                                      strategy, frequency, justified, &cache),
+                                     message);
+                    android::AndroidLineWidth indentedWidth(width, 2, width + 30, indents, 0);
+                    expectSameResult(breakLineOptimal(textBuf, *measuredText, indentedWidth,
+                                                      strategy, frequency, justified),
+                                     breakLineOptimal(textBuf, *measuredText, indentedWidth,
+                                                      strategy, frequency, justified, &cache),
+                                     message);
+                }
+            }
+        }
+    }
+}
+
+TEST_F(OptimalLineBreakerTest, testCacheSameAsNoCache_textEdit) {
+    const std::string base =
+            "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor "
+            "incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud "
+            "exercitation ullamco laboris nisi ut aliquip ex ea commodo consequat.";
+    const std::vector<std::string> edits = {
+            base,
+            base + " Duis",                                      // Append a word.
+            base + " Duis aute",                                 // Append another word.
+            base + " Duis",                                      // Delete the last word.
+            "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor "
+            "incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud "
+            "exercitation ullamco laboris nisi ut aliquip ex ea commodo consequence. Duis",
+            "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor "
+            "incididunt ut labore et magna aliqua. Ut enim ad minim veniam, quis nostrud "
+            "exercitation ullamco laboris nisi ut aliquip ex ea commodo consequence. Duis",
+            "Lorem ipsum sit amet, consectetur adipiscing elit, sed do eiusmod tempor "
+            "incididunt ut labore et magna aliqua. Ut enim ad minim veniam, quis nostrud "
+            "exercitation ullamco laboris nisi ut aliquip ex ea commodo consequence. Duis",
+            base,
+    };
+    const std::vector<float> indents = {0, 20, 0, 10};
+
+    for (BreakStrategy strategy : {BreakStrategy::HighQuality, BreakStrategy::Balanced}) {
+        for (HyphenationFrequency frequency :
+             {HyphenationFrequency::None, HyphenationFrequency::Normal}) {
+            for (float width : {60, 150, 300}) {
+                LineBreakerCache variableCache;
+                LineBreakerCache indentedCache;
+                for (const std::string& text : edits) {
+                    const std::string message = "width=" + std::to_string(width) + ", " + text;
+                    const std::vector<uint16_t> textBuf = utf8ToUtf16(text);
+                    std::unique_ptr<MeasuredText> measuredText = buildMeasuredText(textBuf);
+                    RectangleLineWidth variableWidth(width);
+                    expectSameResult(breakLineOptimal(textBuf, *measuredText, variableWidth,
+                                                      strategy, frequency, false),
+                                     breakLineOptimal(textBuf, *measuredText, variableWidth,
+                                                      strategy, frequency, false, &variableCache),
+                                     message);
+                    android::AndroidLineWidth indentedWidth(width, 2, width + 30, indents, 0);
+                    expectSameResult(breakLineOptimal(textBuf, *measuredText, indentedWidth,
+                                                      strategy, frequency, true),
+                                     breakLineOptimal(textBuf, *measuredText, indentedWidth,
+                                                      strategy, frequency, true, &indentedCache),
+                                     message);
+                }
+            }
+        }
+    }
+}
 }  // namespace
 }  // namespace minikin
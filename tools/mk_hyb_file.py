@@ -22,6 +22,12 @@ Usage: mk_hyb_file.py [-v] hyph-foo.pat.txt hyph-foo.hyb
 
 Optional -v parameter turns on verbose debugging.
 
+Bundling mode packs already generated hyb files of multiple locales into a single file:
+
+    mk_hyb_file.py -b hyph-bundle.hyb [-a from:to ...] locale:min_prefix:min_suffix:hyph-foo.hyb ...
+
+Each -a parameter adds a locale alias, which must refer to one of the bundled locales.
+
 """
 
 from __future__ import print_function
@@ -422,6 +428,60 @@ def generate_hyb_file(hyph, ch_map, hyb_fn):
         f.write(pattern)
 
 
+def align4(data):
+    return data + b'\0' * (-len(data) % 4)
+
+
+def generate_bundle_file(entries, aliases, bundle_fn):
+    """Pack the hyb files into a bundle. Each entry is (locale, min_prefix, min_suffix, hyb_fn),
+    and each alias is (from_locale, to_locale)."""
+    locales = set(locale for locale, _, _, _ in entries)
+    for from_locale, to_locale in aliases:
+        assert to_locale in locales, 'alias target %s not bundled' % to_locale
+    strings = bytearray()
+    string_offsets = {}
+
+    def add_string(s):
+        if s not in string_offsets:
+            string_offsets[s] = len(strings)
+            strings.extend(s.encode('ascii') + b'\0')
+        return string_offsets[s]
+
+    locale_offsets = [add_string(locale) for locale, _, _, _ in entries]
+    alias_offsets = [(add_string(f), add_string(t)) for f, t in aliases]
+
+    string_off = 6 * 4 + len(entries) * 5 * 4 + len(aliases) * 2 * 4
+    body = align4(bytes(strings))
+    hyb_offset = string_off + len(body)
+    entry_data = []
+    for (locale, min_prefix, min_suffix, hyb_fn), locale_off in zip(entries, locale_offsets):
+        with open(hyb_fn, 'rb') as f:
+            hyb = f.read()
+        assert struct.unpack('<I', hyb[:4])[0] == 0x62ad7968, '%s is not a hyb file' % hyb_fn
+        entry_data.append(struct.pack('<5I', locale_off, hyb_offset, len(hyb), min_prefix,
+                                      min_suffix))
+        hyb = align4(hyb)
+        body += hyb
+        hyb_offset += len(hyb)
+    header = struct.pack('<6I', 0x62ad7962, 0, len(entries), len(aliases), string_off,
+                         hyb_offset)
+    alias_data = [struct.pack('<2I', f, t) for f, t in alias_offsets]
+
+    with open(bundle_fn, 'wb') as f:
+        f.write(header)
+        f.write(b''.join(entry_data))
+        f.write(b''.join(alias_data))
+        f.write(body)
+    if VERBOSE:
+        print('bundled %d locales, %d aliases, %d bytes' % (len(entries), len(aliases),
+                                                             hyb_offset))
+
+
+def parse_bundle_entry(arg):
+    locale, min_prefix, min_suffix, hyb_fn = arg.split(':', 3)
+    return (locale, int(min_prefix), int(min_suffix), hyb_fn)
+
+
 # Verify that the file contains the same lines as the lines argument, in arbitrary order
 def verify_file_sorted(lines, fn):
     file_lines = [l.strip() for l in io.open(fn, encoding='UTF-8')]
@@ -563,13 +623,22 @@ def verify_hyb_file(hyb_fn, pat_fn, chr_fn, hyp_fn):
 def main():
     global VERBOSE
     try:
-        opts, args = getopt.getopt(sys.argv[1:], 'v')
+        opts, args = getopt.getopt(sys.argv[1:], 'va:b:')
     except getopt.GetoptError as err:
         print(str(err))
         sys.exit(1)
-    for o, _ in opts:
+    bundle_fn = None
+    aliases = []
+    for o, a in opts:
         if o == '-v':
             VERBOSE = True
+        elif o == '-b':
+            bundle_fn = a
+        elif o == '-a':
+            aliases.append(tuple(a.split(':', 1)))
+    if bundle_fn is not None:
+        generate_bundle_file([parse_bundle_entry(arg) for arg in args], aliases, bundle_fn)
+        return
     pat_fn, out_fn = args
     hyph = load(pat_fn)
     if pat_fn.endswith('.pat.txt'):